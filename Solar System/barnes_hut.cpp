@@ -0,0 +1,492 @@
+﻿#include "barnes_hut.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include "direct_gravity.h"
+#include "parallel.h"
+
+static const int mortonBits = 21;      // Bity na oś, 63 bity kodu
+static const int topLevels = 3;        // Poziomy budowane jednym wątkiem, niżej do 512 poddrzew równolegle
+static const uint32_t groupSize = 64;  // Najwięcej cząstek ze wspólną listą oddziaływań: dłuższe listy, ale pełne rejestry SIMD
+
+// Rozsuwa 21 bitów tak, że między każdymi dwoma są dwa zera
+static uint64_t expandBits(uint32_t value) {
+    uint64_t x = value & 0x1fffff;
+    x = (x | x << 32) & 0x1f00000000ffffull;
+    x = (x | x << 16) & 0x1f0000ff0000ffull;
+    x = (x | x << 8) & 0x100f00f00f00f00full;
+    x = (x | x << 4) & 0x10c30c30c30c30c3ull;
+    x = (x | x << 2) & 0x1249249249249249ull;
+    return x;
+}
+
+// Uzupełnia masę i środek masy komórki na podstawie dzieci, przyjmuje parametry: komórka, jej dzieci i ich liczba
+template <typename Node>
+static void summarizeChildren(Node& node, const Node* children, uint32_t childCount) {
+    double mass = 0.0, x = 0.0, y = 0.0, z = 0.0;
+    for (uint32_t c = 0; c < childCount; ++c) {
+        mass += children[c].mass;
+        x += (double)children[c].mass * children[c].comX;
+        y += (double)children[c].mass * children[c].comY;
+        z += (double)children[c].mass * children[c].comZ;
+    }
+    node.mass = (float)mass;
+    if (mass > 0.0) {
+        node.comX = (float)(x / mass);
+        node.comY = (float)(y / mass);
+        node.comZ = (float)(z / mass);
+    }
+    else {
+        node.comX = children[0].comX;
+        node.comY = children[0].comY;
+        node.comZ = children[0].comZ;
+    }
+}
+
+// Sortowanie pozycyjne kodów Mortona po 8 bitów: histogramy i rozrzucanie w kawałkach na wielu wątkach
+void BarnesHutTree::sortByMorton(size_t count) {
+    scratchCodes.resize(count);
+    scratchOrder.resize(count);
+    size_t chunks = std::max<size_t>(1, std::min<size_t>(workerCount(), count / 16384));
+    std::vector<uint32_t> histograms(chunks * 256);
+
+    for (int pass = 0; pass < 8; ++pass) {
+        int shift = pass * 8;
+        parallelFor(chunks, 1, [&](size_t first, size_t last) {
+            for (size_t c = first; c < last; ++c) {
+                uint32_t* histogram = &histograms[c * 256];
+                std::fill(histogram, histogram + 256, 0u);
+                for (size_t i = count * c / chunks; i < count * (c + 1) / chunks; ++i) {
+                    ++histogram[(codes[i] >> shift) & 255];
+                }
+            }
+        });
+
+        // Przejście pomijamy, gdy wszystkie kody mają w nim tę samą cyfrę
+        bool trivial = false;
+        for (int digit = 0; digit < 256 && !trivial; ++digit) {
+            size_t total = 0;
+            for (size_t c = 0; c < chunks; ++c) {
+                total += histograms[c * 256 + digit];
+            }
+            if (total == count)
+                trivial = true;
+            else if (total != 0)
+                break;
+        }
+        if (trivial)
+            continue;
+
+        uint32_t running = 0;
+        for (int digit = 0; digit < 256; ++digit) {
+            for (size_t c = 0; c < chunks; ++c) {
+                uint32_t n = histograms[c * 256 + digit];
+                histograms[c * 256 + digit] = running;
+                running += n;
+            }
+        }
+
+        parallelFor(chunks, 1, [&](size_t first, size_t last) {
+            for (size_t c = first; c < last; ++c) {
+                uint32_t* offsets = &histograms[c * 256];
+                for (size_t i = count * c / chunks; i < count * (c + 1) / chunks; ++i) {
+                    uint32_t destination = offsets[(codes[i] >> shift) & 255]++;
+                    scratchCodes[destination] = codes[i];
+                    scratchOrder[destination] = order[i];
+                }
+            }
+        });
+        codes.swap(scratchCodes);
+        order.swap(scratchOrder);
+    }
+}
+
+// Dzieli zakres komórki na oktanty, zwraca liczbę niepustych, przyjmuje parametry: zakres, poziom i granice (9 wartości)
+uint32_t BarnesHutTree::splitNode(uint32_t begin, uint32_t end, int level, uint32_t bounds[9]) const {
+    int shift = 3 * (mortonBits - 1 - level);
+    bounds[0] = begin;
+    uint32_t nonEmpty = 0;
+    for (uint32_t octant = 0; octant < 8; ++octant) {
+        // Kody w komórce mają wspólne wyższe bity, więc cyfra oktantu rośnie wzdłuż zakresu
+        const uint64_t* split = std::partition_point(codes.data() + bounds[octant], codes.data() + end,
+            [&](uint64_t code) { return ((code >> shift) & 7) <= octant; });
+        bounds[octant + 1] = (uint32_t)(split - codes.data());
+        if (bounds[octant + 1] > bounds[octant])
+            ++nonEmpty;
+    }
+    return nonEmpty;
+}
+
+// Buduje komórkę i całe jej poddrzewo w tablicy out, przyjmuje parametry: tablica węzłów, indeks węzła, zakres cząstek,
+// poziom, krawędź komórki i rozmiar liścia
+void BarnesHutTree::buildNode(std::vector<Node>& out, uint32_t index, uint32_t begin, uint32_t end, int level, float size, unsigned int leafSize) const {
+    Node node = {};
+    node.begin = begin;
+    node.end = end;
+    node.size = size;
+
+    uint32_t bounds[9];
+    if (end - begin <= leafSize || level >= mortonBits || splitNode(begin, end, level, bounds) == 0) {
+        // Liść: masa i środek masy prosto z cząstek
+        double mass = 0.0, x = 0.0, y = 0.0, z = 0.0;
+        for (uint32_t i = begin; i < end; ++i) {
+            mass += sortedMass[i];
+            x += (double)sortedMass[i] * sortedX[i];
+            y += (double)sortedMass[i] * sortedY[i];
+            z += (double)sortedMass[i] * sortedZ[i];
+        }
+        node.mass = (float)mass;
+        if (mass > 0.0) {
+            node.comX = (float)(x / mass);
+            node.comY = (float)(y / mass);
+            node.comZ = (float)(z / mass);
+        }
+        else {
+            node.comX = sortedX[begin];
+            node.comY = sortedY[begin];
+            node.comZ = sortedZ[begin];
+        }
+        out[index] = node;
+        return;
+    }
+
+    uint32_t first = (uint32_t)out.size();
+    uint32_t childCount = 0;
+    for (int octant = 0; octant < 8; ++octant) {
+        childCount += bounds[octant + 1] > bounds[octant] ? 1 : 0;
+    }
+    out.resize(first + childCount);
+    node.firstChild = first;
+    node.childCount = childCount;
+
+    uint32_t child = first;
+    for (int octant = 0; octant < 8; ++octant) {
+        if (bounds[octant + 1] > bounds[octant])
+            buildNode(out, child++, bounds[octant], bounds[octant + 1], level + 1, size * 0.5f, leafSize);
+    }
+    summarizeChildren(node, &out[first], childCount);
+    out[index] = node;
+}
+
+// Buduje górne poziomy drzewa, a komórki na poziomie topLevels zostawia jako zadania dla wątków
+void BarnesHutTree::buildTop(uint32_t node, int level, std::vector<SubtreeTask>& tasks, unsigned int leafSize) {
+    uint32_t begin = nodes[node].begin;
+    uint32_t end = nodes[node].end;
+    float size = nodes[node].size;
+
+    uint32_t bounds[9];
+    if (level >= topLevels || end - begin <= leafSize || splitNode(begin, end, level, bounds) <= 1) {
+        tasks.push_back({ node, begin, end, level, size });
+        return;
+    }
+
+    uint32_t first = (uint32_t)nodes.size();
+    for (int octant = 0; octant < 8; ++octant) {
+        if (bounds[octant + 1] > bounds[octant]) {
+            Node childNode = {};
+            childNode.begin = bounds[octant];
+            childNode.end = bounds[octant + 1];
+            childNode.size = size * 0.5f;
+            nodes.push_back(childNode);
+        }
+    }
+    nodes[node].firstChild = first;
+    nodes[node].childCount = (uint32_t)nodes.size() - first;
+    uint32_t last = (uint32_t)nodes.size();
+    for (uint32_t child = first; child < last; ++child) {
+        buildTop(child, level + 1, tasks, leafSize);
+    }
+}
+
+// Funkcja budująca drzewo, przyjmuje parametry: tablice pozycji i mas, liczba cząstek i ustawienia
+void BarnesHutTree::build(const float* x, const float* y, const float* z, const float* mass, size_t count, const BarnesHutSettings& settings) {
+    auto start = std::chrono::steady_clock::now();
+    nodes.clear();
+    statistics.nodes = 0;
+    if (count == 0)
+        return;
+
+    // Sześcian obejmujący wszystkie cząstki, liczony w kawałkach na wielu wątkach
+    size_t chunks = std::max<size_t>(1, std::min<size_t>(workerCount(), count / 16384));
+    std::vector<float> bounds(chunks * 6);
+    parallelFor(chunks, 1, [&](size_t first, size_t last) {
+        for (size_t c = first; c < last; ++c) {
+            float* b = &bounds[c * 6];
+            b[0] = b[1] = b[2] = INFINITY;
+            b[3] = b[4] = b[5] = -INFINITY;
+            for (size_t i = count * c / chunks; i < count * (c + 1) / chunks; ++i) {
+                b[0] = std::min(b[0], x[i]); b[3] = std::max(b[3], x[i]);
+                b[1] = std::min(b[1], y[i]); b[4] = std::max(b[4], y[i]);
+                b[2] = std::min(b[2], z[i]); b[5] = std::max(b[5], z[i]);
+            }
+        }
+    });
+    float minimum[3] = { INFINITY, INFINITY, INFINITY };
+    float maximum[3] = { -INFINITY, -INFINITY, -INFINITY };
+    for (size_t c = 0; c < chunks; ++c) {
+        for (int axis = 0; axis < 3; ++axis) {
+            minimum[axis] = std::min(minimum[axis], bounds[c * 6 + axis]);
+            maximum[axis] = std::max(maximum[axis], bounds[c * 6 + 3 + axis]);
+        }
+    }
+    rootSize = std::max({ maximum[0] - minimum[0], maximum[1] - minimum[1], maximum[2] - minimum[2], 1e-6f }) * 1.0001f;
+    float scale = (float)(1 << mortonBits) / rootSize;
+
+    // Kody Mortona i sortowanie
+    codes.resize(count);
+    order.resize(count);
+    parallelFor(count, 16384, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            uint32_t cx = std::min((uint32_t)((x[i] - minimum[0]) * scale), (1u << mortonBits) - 1);
+            uint32_t cy = std::min((uint32_t)((y[i] - minimum[1]) * scale), (1u << mortonBits) - 1);
+            uint32_t cz = std::min((uint32_t)((z[i] - minimum[2]) * scale), (1u << mortonBits) - 1);
+            codes[i] = expandBits(cx) << 2 | expandBits(cy) << 1 | expandBits(cz);
+            order[i] = (uint32_t)i;
+        }
+    });
+    sortByMorton(count);
+
+    // Kopie pozycji i mas w kolejności Mortona, żeby sąsiednie komórki leżały obok siebie w pamięci
+    sortedX.resize(count);
+    sortedY.resize(count);
+    sortedZ.resize(count);
+    sortedMass.resize(count);
+    parallelFor(count, 16384, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            sortedX[i] = x[order[i]];
+            sortedY[i] = y[order[i]];
+            sortedZ[i] = z[order[i]];
+            sortedMass[i] = mass[order[i]];
+        }
+    });
+
+    // Górne poziomy jednym wątkiem, poddrzewa równolegle, każde do własnej tablicy
+    Node root = {};
+    root.begin = 0;
+    root.end = (uint32_t)count;
+    root.size = rootSize;
+    nodes.push_back(root);
+    std::vector<SubtreeTask> tasks;
+    buildTop(0, 0, tasks, settings.leafSize);
+    size_t topCount = nodes.size();
+
+    std::vector<std::vector<Node>> subtrees(tasks.size());
+    parallelFor(tasks.size(), 1, [&](size_t first, size_t last) {
+        for (size_t t = first; t < last; ++t) {
+            subtrees[t].resize(1);
+            buildNode(subtrees[t], 0, tasks[t].begin, tasks[t].end, tasks[t].level, tasks[t].size, settings.leafSize);
+        }
+    });
+
+    // Sklejenie poddrzew: korzeń poddrzewa zastępuje węzeł zadania, reszta trafia na koniec z przesuniętymi indeksami
+    for (size_t t = 0; t < tasks.size(); ++t) {
+        uint32_t offset = (uint32_t)nodes.size() - 1;
+        for (size_t i = 0; i < subtrees[t].size(); ++i) {
+            Node node = subtrees[t][i];
+            if (node.childCount > 0)
+                node.firstChild += offset;
+            if (i == 0)
+                nodes[tasks[t].node] = node;
+            else
+                nodes.push_back(node);
+        }
+    }
+
+    // Masy górnych poziomów od dołu; dzieci mają zawsze większe indeksy niż rodzic
+    for (size_t i = topCount; i-- > 0;) {
+        Node& node = nodes[i];
+        if (node.childCount > 0)
+            summarizeChildren(node, &nodes[node.firstChild], node.childCount);
+    }
+
+    statistics.nodes = nodes.size();
+    statistics.buildMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Funkcja licząca przyspieszenia, przyjmuje parametry: tablice wyjściowe (kolejność jak przy build) i ustawienia.
+// Drzewo przechodzone jest raz na grupę do groupSize sąsiednich cząstek, a nie raz na cząstkę: komórka trafia
+// na wspólną listę oddziaływań grupy, gdy kryterium otwarcia spełnia najbliższy punkt sfery obejmującej grupę,
+// inaczej jest otwierana, a liście trafiają na listę cząstka po cząstce (także liście samej grupy; cząstka sama ze
+// sobą ma dx = 0, więc nie daje siły). Listę dla wszystkich cząstek grupy naraz liczy jądro kafli sumowania
+// bezpośredniego (rsqrt z krokiem Newtona w rejestrach SIMD aktywnego wariantu)
+void BarnesHutTree::accelerations(float* ax, float* ay, float* az, const BarnesHutSettings& settings) {
+    auto start = std::chrono::steady_clock::now();
+    float theta = settings.openingAngle;
+    float theta2 = theta * theta;
+    float eps2 = settings.softening * settings.softening;
+    float G = settings.gravitationalConstant;
+    std::atomic<size_t> interactions{ 0 };
+
+    // Grupy: najwyższe komórki z najwyżej groupSize cząstkami (albo liście), w kolejności Mortona,
+    // więc sąsiednie grupy mają podobne listy
+    std::vector<uint32_t> groups;
+    if (!nodes.empty()) {
+        std::vector<uint32_t> pending(1, 0);
+        while (!pending.empty()) {
+            uint32_t n = pending.back();
+            pending.pop_back();
+            if (nodes[n].childCount == 0 || nodes[n].end - nodes[n].begin <= groupSize)
+                groups.push_back(n);
+            else {
+                for (uint32_t c = 0; c < nodes[n].childCount; ++c) {
+                    pending.push_back(nodes[n].firstChild + c);
+                }
+            }
+        }
+    }
+    std::sort(groups.begin(), groups.end(), [&](uint32_t a, uint32_t b) { return nodes[a].begin < nodes[b].begin; });
+
+    parallelFor(groups.size(), 16, [&](size_t first, size_t last) {
+        size_t localInteractions = 0;
+        uint32_t stack[256];
+        std::vector<float> listX, listY, listZ, listMass;
+        std::vector<float> targetX, targetY, targetZ, accX, accY, accZ;
+        for (size_t g = first; g < last; ++g) {
+            const Node& group = nodes[groups[g]];
+            uint32_t begin = group.begin, count = group.end - group.begin;
+
+            // Sfera obejmująca cząstki grupy: środek pudełka i połowa przekątnej
+            float low[3] = { INFINITY, INFINITY, INFINITY }, high[3] = { -INFINITY, -INFINITY, -INFINITY };
+            for (uint32_t i = begin; i < group.end; ++i) {
+                low[0] = std::min(low[0], sortedX[i]); high[0] = std::max(high[0], sortedX[i]);
+                low[1] = std::min(low[1], sortedY[i]); high[1] = std::max(high[1], sortedY[i]);
+                low[2] = std::min(low[2], sortedZ[i]); high[2] = std::max(high[2], sortedZ[i]);
+            }
+            float cx = 0.5f * (low[0] + high[0]), cy = 0.5f * (low[1] + high[1]), cz = 0.5f * (low[2] + high[2]);
+            float ex = high[0] - low[0], ey = high[1] - low[1], ez = high[2] - low[2];
+            float radius = 0.5f * sqrtf(ex * ex + ey * ey + ez * ez);
+
+            listX.clear();
+            listY.clear();
+            listZ.clear();
+            listMass.clear();
+            int top = 0;
+            stack[top++] = 0;
+            while (top > 0) {
+                const Node& node = nodes[stack[--top]];
+                float dx = node.comX - cx, dy = node.comY - cy, dz = node.comZ - cz;
+                float distance2 = dx * dx + dy * dy + dz * dz;
+                // size < theta * (d - radius) bez pierwiastka: obie strony są dodatnie
+                float reach = node.size + theta * radius;
+                if (reach * reach < theta2 * distance2) {
+                    // Komórka dość daleko od całej grupy: cała jej masa w środku masy
+                    listX.push_back(node.comX);
+                    listY.push_back(node.comY);
+                    listZ.push_back(node.comZ);
+                    listMass.push_back(node.mass);
+                }
+                else if (node.childCount == 0) {
+                    listX.insert(listX.end(), sortedX.begin() + node.begin, sortedX.begin() + node.end);
+                    listY.insert(listY.end(), sortedY.begin() + node.begin, sortedY.begin() + node.end);
+                    listZ.insert(listZ.end(), sortedZ.begin() + node.begin, sortedZ.begin() + node.end);
+                    listMass.insert(listMass.end(), sortedMass.begin() + node.begin, sortedMass.begin() + node.end);
+                }
+                else {
+                    for (uint32_t c = 0; c < node.childCount; ++c) {
+                        stack[top++] = node.firstChild + c;
+                    }
+                }
+            }
+
+            // Cząstki grupy dopełnione do 8 środkiem sfery; wyniki dopełnienia są pomijane
+            size_t padded = ((size_t)count + 7) & ~(size_t)7;
+            targetX.assign(padded, cx);
+            targetY.assign(padded, cy);
+            targetZ.assign(padded, cz);
+            std::copy(sortedX.begin() + begin, sortedX.begin() + group.end, targetX.begin());
+            std::copy(sortedY.begin() + begin, sortedY.begin() + group.end, targetY.begin());
+            std::copy(sortedZ.begin() + begin, sortedZ.begin() + group.end, targetZ.begin());
+            accX.assign(padded, 0.0f);
+            accY.assign(padded, 0.0f);
+            accZ.assign(padded, 0.0f);
+
+            size_t sources = listX.size();
+            GravityArrays arrays = { listX.data(), listY.data(), listZ.data(), listMass.data(), targetX.data(), targetY.data(),
+                targetZ.data(), accX.data(), accY.data(), accZ.data(), sources, padded, eps2 };
+            for (size_t tileBegin = 0; tileBegin < sources; tileBegin += gravityTileSize) {
+                gravityTile(arrays, 0, padded, tileBegin, std::min(sources, tileBegin + gravityTileSize));
+            }
+            for (uint32_t k = 0; k < count; ++k) {
+                uint32_t original = order[begin + k];
+                ax[original] = G * accX[k];
+                ay[original] = G * accY[k];
+                az[original] = G * accZ[k];
+            }
+            localInteractions += sources * count;
+        }
+        interactions += localInteractions;
+    });
+
+    statistics.interactions = interactions;
+    statistics.forceMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Funkcja mierząca wydajność i dokładność drzewa, przyjmuje parametr: liczba cząstek
+void benchmarkBarnesHut(size_t count) {
+    std::mt19937 random(1234);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    std::normal_distribution<float> normal(0.0f, 1.0f);
+
+    // Płaski dysk z gęstszym środkiem, podobny do pasa planetoid z rodzinami
+    std::vector<float> x(count), y(count), z(count), mass(count, 1.0f / count);
+    std::vector<float> ax(count), ay(count), az(count);
+    for (size_t i = 0; i < count; ++i) {
+        float r = 10.0f * unit(random) * unit(random);
+        float angle = 6.2831853f * unit(random);
+        x[i] = r * std::cos(angle);
+        y[i] = 0.05f * normal(random);
+        z[i] = r * std::sin(angle);
+    }
+
+    unsigned int previous = workerCount();
+    BarnesHutSettings settings;
+    BarnesHutTree tree;
+    for (unsigned int workers = 1; ; workers = std::min(workers * 2, previous)) {
+        setWorkerCount(workers);
+        tree.build(x.data(), y.data(), z.data(), mass.data(), count, settings);
+        tree.accelerations(ax.data(), ay.data(), az.data(), settings);
+        const BarnesHutStats& stats = tree.stats();
+        std::cout << count << " particles, " << workers << " threads: build " << stats.buildMilliseconds << " ms, forces "
+            << stats.forceMilliseconds << " ms, " << stats.nodes << " nodes, "
+            << (double)stats.interactions / count << " interactions per particle" << std::endl;
+        if (workers == previous)
+            break;
+    }
+
+    // Błąd względny przyspieszenia na próbce cząstek, w podwójnej precyzji
+    const size_t samples = std::min<size_t>(count, 256);
+    const float angles[] = { 0.3f, 0.5f, 0.7f, 1.0f };
+    for (float angle : angles) {
+        settings.openingAngle = angle;
+        tree.build(x.data(), y.data(), z.data(), mass.data(), count, settings);
+        tree.accelerations(ax.data(), ay.data(), az.data(), settings);
+
+        double sumError = 0.0, maxError = 0.0;
+        double eps2 = (double)settings.softening * settings.softening;
+        for (size_t s = 0; s < samples; ++s) {
+            size_t i = s * count / samples;
+            double exact[3] = { 0.0, 0.0, 0.0 };
+            for (size_t j = 0; j < count; ++j) {
+                if (j == i)
+                    continue;
+                double dx = x[j] - x[i], dy = y[j] - y[i], dz = z[j] - z[i];
+                double inv = 1.0 / std::sqrt(dx * dx + dy * dy + dz * dz + eps2);
+                double strength = mass[j] * inv * inv * inv;
+                exact[0] += dx * strength;
+                exact[1] += dy * strength;
+                exact[2] += dz * strength;
+            }
+            double ex = ax[i] - exact[0], ey = ay[i] - exact[1], ez = az[i] - exact[2];
+            double error = std::sqrt(ex * ex + ey * ey + ez * ez)
+                / std::sqrt(exact[0] * exact[0] + exact[1] * exact[1] + exact[2] * exact[2]);
+            sumError += error;
+            maxError = std::max(maxError, error);
+        }
+        std::cout << "theta " << angle << ": forces " << tree.stats().forceMilliseconds << " ms, mean error "
+            << sumError / samples << ", max error " << maxError << std::endl;
+    }
+    setWorkerCount(previous);
+}
@@ -0,0 +1,69 @@
+﻿#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Ustawienia przybliżenia Barnes–Hut
+struct BarnesHutSettings {
+    float openingAngle = 0.5f;          // theta: komórka o krawędzi s w odległości d jest jedną masą, gdy s < theta * d
+    float softening = 0.01f;            // Wygładzenie potencjału, chroni przed osobliwością przy zbliżeniach
+    float gravitationalConstant = 1.0f;
+    unsigned int leafSize = 8;          // Najwięcej cząstek w liściu
+};
+
+// Statystyki ostatniej budowy i liczenia sił
+struct BarnesHutStats {
+    double buildMilliseconds = 0.0;
+    double forceMilliseconds = 0.0;
+    size_t nodes = 0;
+    size_t interactions = 0;            // Oddziaływania cząstka-cząstka i cząstka-komórka
+};
+
+// Drzewo ósemkowe Barnes–Hut budowane co krok od nowa: cząstki są sortowane po kodach Mortona,
+// więc każda komórka to ciągły zakres posortowanej tablicy, a poddrzewa budowane są równolegle
+class BarnesHutTree {
+public:
+    // Buduje drzewo, przyjmuje parametry: tablice pozycji i mas cząstek oraz ich liczba
+    void build(const float* x, const float* y, const float* z, const float* mass, size_t count, const BarnesHutSettings& settings);
+
+    // Liczy przyspieszenia wszystkich cząstek drzewa i zapisuje je w oryginalnej kolejności
+    void accelerations(float* ax, float* ay, float* az, const BarnesHutSettings& settings);
+
+    const BarnesHutStats& stats() const { return statistics; }
+
+private:
+    struct Node {
+        float comX, comY, comZ;         // Środek masy
+        float mass;
+        float size;                     // Krawędź komórki
+        uint32_t begin, end;            // Zakres posortowanych cząstek
+        uint32_t firstChild;            // Dzieci leżą obok siebie, 0 dla liścia
+        uint32_t childCount;
+    };
+
+    // Zadanie budowy poddrzewa na jednym wątku
+    struct SubtreeTask {
+        uint32_t node;
+        uint32_t begin, end;
+        int level;
+        float size;
+    };
+
+    void sortByMorton(size_t count);
+    void buildTop(uint32_t node, int level, std::vector<SubtreeTask>& tasks, unsigned int leafSize);
+    void buildNode(std::vector<Node>& out, uint32_t index, uint32_t begin, uint32_t end, int level, float size, unsigned int leafSize) const;
+    uint32_t splitNode(uint32_t begin, uint32_t end, int level, uint32_t bounds[9]) const;
+
+    std::vector<Node> nodes;
+    std::vector<uint64_t> codes;        // Posortowane kody Mortona
+    std::vector<uint32_t> order;        // Oryginalny indeks cząstki dla pozycji w posortowanej tablicy
+    std::vector<uint64_t> scratchCodes;
+    std::vector<uint32_t> scratchOrder;
+    std::vector<float> sortedX, sortedY, sortedZ, sortedMass;
+    float rootSize = 0.0f;
+    BarnesHutStats statistics;
+};
+
+// Pomiar czasu budowy i sił dla rosnącej liczby wątków oraz błędu względem sumowania bezpośredniego
+// dla kilku kątów otwarcia, wypisywany na std::cout, przyjmuje parametr: liczba cząstek
+void benchmarkBarnesHut(size_t count);
@@ -0,0 +1,156 @@
+﻿#include "belt.h"
+#include <algorithm>
+#include <cmath>
+#include "orbit_kernel.h"
+#include "parallel.h"
+
+static const float degToRad = 0.0174532925199433f;
+static const double degToRadDouble = 0.0174532925199432957692;
+static const float angleStep = 6.28318530717958647692f / 65536.0f; // Radiany na jednostkę skwantowanego kąta
+static const double motionStep = 6.28318530717958647692 / 4294967296.0; // Radiany na sekundę na jednostkę ruchu średniego
+
+// Kwantyzuje wartość z zakresu minimum..maximum do 0..65535
+static uint16_t quantize(float value, float minimum, float maximum) {
+    float t = maximum > minimum ? (value - minimum) / (maximum - minimum) : 0.0f;
+    return (uint16_t)std::lround(std::clamp(t, 0.0f, 1.0f) * 65535.0f);
+}
+
+static float dequantize(uint16_t value, float minimum, float maximum) {
+    return minimum + (maximum - minimum) * (value / 65535.0f);
+}
+
+// Kwantyzuje kąt w stopniach na pełnym obrocie, 65536 odpowiada 360 stopniom
+static uint16_t quantizeAngle(float degrees) {
+    float turns = degrees / 360.0f;
+    turns -= std::floor(turns);
+    return (uint16_t)((long)std::lround(turns * 65536.0f) & 0xFFFF);
+}
+
+// Unormowana wartość 0..1 jako bajt
+static uint8_t quantizeByte(float value) {
+    return (uint8_t)std::lround(std::clamp(value, 0.0f, 1.0f) * 255.0f);
+}
+
+void Belt::clear() {
+    populations.clear();
+    particles.clear();
+}
+
+// Funkcja dodająca populację, przyjmuje parametr: opis populacji
+int Belt::addPopulation(const BeltPopulation& population) {
+    if ((int)populations.size() >= maxBeltPopulations)
+        return -1;
+    populations.push_back(population);
+    populations.back().first = particles.size();
+    populations.back().count = 0;
+    return (int)populations.size() - 1;
+}
+
+// Funkcja dodająca cząstkę, przyjmuje parametry: indeks populacji, elementy orbity, jasność i rozmiar 0..1
+void Belt::add(int population, const OrbitalElements& elements, float brightness, float size) {
+    BeltPopulation& p = populations[population];
+    BeltParticle particle;
+    particle.semiMajorAxis = quantize(elements.semiMajorAxis, p.minSemiMajorAxis, p.maxSemiMajorAxis);
+    particle.eccentricity = quantize(elements.eccentricity, 0.0f, p.maxEccentricity);
+    particle.inclination = quantize(elements.inclination, 0.0f, p.maxInclination);
+    particle.ascendingNode = quantizeAngle(elements.ascendingNode);
+    particle.periapsisArgument = quantizeAngle(elements.periapsisArgument);
+    particle.epochAnomaly = quantizeAngle(elements.meanAnomaly);
+
+    // Ruch średni z trzeciego prawa Keplera dla półosi po kwantyzacji
+    double ratio = dequantize(particle.semiMajorAxis, p.minSemiMajorAxis, p.maxSemiMajorAxis) / p.referenceSemiMajorAxis;
+    double referenceMotion = p.referenceMeanMotion * degToRadDouble;
+    double motion = p.coorbital ? referenceMotion : referenceMotion / (ratio * std::sqrt(ratio));
+    particle.meanMotion = (uint32_t)std::min(std::llround(motion / motionStep), 4294967295ll);
+    particle.population = (uint16_t)population;
+    particle.brightness = quantizeByte(brightness);
+    particle.size = quantizeByte(size);
+    particles.push_back(particle);
+    ++p.count;
+}
+
+// Funkcja zwracająca elementy po dekwantyzacji, przyjmuje parametr: indeks cząstki
+OrbitalElements Belt::elements(size_t index) const {
+    const BeltParticle& particle = particles[index];
+    const BeltPopulation& p = populations[particle.population];
+    OrbitalElements result;
+    result.semiMajorAxis = dequantize(particle.semiMajorAxis, p.minSemiMajorAxis, p.maxSemiMajorAxis);
+    result.eccentricity = dequantize(particle.eccentricity, 0.0f, p.maxEccentricity);
+    result.inclination = dequantize(particle.inclination, 0.0f, p.maxInclination);
+    result.ascendingNode = particle.ascendingNode * (360.0f / 65536.0f);
+    result.periapsisArgument = particle.periapsisArgument * (360.0f / 65536.0f);
+    result.meanAnomaly = particle.epochAnomaly * (360.0f / 65536.0f);
+    result.meanMotion = (float)(particle.meanMotion * (360.0 / 4294967296.0));
+    return result;
+}
+
+// Funkcja licząca pozycje, przyjmuje parametry: czas w sekundach i wyjście (trójki xyz)
+void Belt::evaluate(double time, float* positions) const {
+    // Zakresy kwantyzacji populacji
+    struct Law {
+        float minA, rangeA, maxE, maxI;
+    };
+    std::vector<Law> laws;
+    for (const BeltPopulation& p : populations) {
+        laws.push_back({ p.minSemiMajorAxis, p.maxSemiMajorAxis - p.minSemiMajorAxis, p.maxEccentricity, p.maxInclination * degToRad });
+    }
+
+    // Bloki po 1024 cząstki: dekwantyzacja do tablic jądra orbit, sinusy kątów wektorowo, potem jądro Keplera
+    parallelFor(size(), 16384, [&](size_t begin, size_t end) {
+        const size_t block = 1024;
+        std::vector<float> angle(3 * block), sine(3 * block), cosine(3 * block);
+        std::vector<double> epochAnomaly(block), meanMotion(block);
+        std::vector<float> eccentricity(block), meanAnomaly(block);
+        std::vector<float> periapsisX(block), periapsisY(block), periapsisZ(block);
+        std::vector<float> minorAxisX(block), minorAxisY(block), minorAxisZ(block);
+        std::vector<float> x(block), y(block), z(block);
+
+        for (size_t first = begin; first < end; first += block) {
+            size_t count = std::min(block, end - first);
+            const BeltParticle* particle = particles.data() + first;
+
+            // Nachylenie, węzeł i argument perycentrum jako trzy odcinki jednej tablicy
+            for (size_t j = 0; j < count; ++j) {
+                const Law& law = laws[particle[j].population];
+                angle[j] = particle[j].inclination * (law.maxI / 65535.0f);
+                angle[count + j] = particle[j].ascendingNode * angleStep;
+                angle[2 * count + j] = particle[j].periapsisArgument * angleStep;
+            }
+            sincosBatch(angle.data(), sine.data(), cosine.data(), 3 * count);
+
+            for (size_t j = 0; j < count; ++j) {
+                const Law& law = laws[particle[j].population];
+                float a = law.minA + law.rangeA * (particle[j].semiMajorAxis / 65535.0f);
+                float e = law.maxE * (particle[j].eccentricity / 65535.0f);
+                float b = a * std::sqrt(1.0f - e * e);
+                float sinIncl = sine[j], cosIncl = cosine[j];
+                float sinNode = sine[count + j], cosNode = cosine[count + j];
+                float sinArg = sine[2 * count + j], cosArg = cosine[2 * count + j];
+
+                // Kierunki P i Q jak w BodyStore::setOrbit, biegunem sceny jest oś y
+                periapsisX[j] = a * (cosNode * cosArg - sinNode * sinArg * cosIncl);
+                periapsisY[j] = a * (sinArg * sinIncl);
+                periapsisZ[j] = a * (sinNode * cosArg + cosNode * sinArg * cosIncl);
+                minorAxisX[j] = b * (-cosNode * sinArg - sinNode * cosArg * cosIncl);
+                minorAxisY[j] = b * (cosArg * sinIncl);
+                minorAxisZ[j] = b * (-sinNode * sinArg + cosNode * cosArg * cosIncl);
+                eccentricity[j] = e;
+                epochAnomaly[j] = particle[j].epochAnomaly * (double)angleStep;
+                meanMotion[j] = particle[j].meanMotion * motionStep;
+            }
+
+            OrbitArrays orbits = { epochAnomaly.data(), meanMotion.data(), eccentricity.data(),
+                periapsisX.data(), periapsisY.data(), periapsisZ.data(),
+                minorAxisX.data(), minorAxisY.data(), minorAxisZ.data(),
+                meanAnomaly.data(), x.data(), y.data(), z.data(), count };
+            evaluateOrbits(orbits, time);
+
+            float* out = positions + first * 3;
+            for (size_t j = 0; j < count; ++j) {
+                out[j * 3 + 0] = x[j];
+                out[j * 3 + 1] = y[j];
+                out[j * 3 + 2] = z[j];
+            }
+        }
+    });
+}
@@ -0,0 +1,68 @@
+﻿#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "body_store.h"
+
+// Największa liczba populacji, tyle kolorów przyjmuje shader pasów
+const int maxBeltPopulations = 8;
+
+// Populacja pasa (pas główny, trojańczycy, pas Kuipera): zakresy kwantyzacji elementów i prawo ruchu średniego
+struct BeltPopulation {
+    std::string name;
+    float minSemiMajorAxis = 1.0f;
+    float maxSemiMajorAxis = 2.0f;
+    float maxEccentricity = 0.5f;
+    float maxInclination = 90.0f;      // Stopnie
+    float referenceSemiMajorAxis = 1.0f;
+    float referenceMeanMotion = 1.0f;  // Stopnie na sekundę; n = n_ref * (a / a_ref)^-1.5
+    bool coorbital = false;            // Ruch średni zawsze n_ref, np. trojańczycy krążący razem z Jowiszem
+    float colorR = 1.0f, colorG = 1.0f, colorB = 1.0f;
+    size_t first = 0;                  // Zakres cząstek populacji w Belt::particles
+    size_t count = 0;
+};
+
+// Cząstka pasa: skwantowane elementy orbity, 20 bajtów. Kąty na pełnym obrocie 0..65536, półoś, mimośród
+// i nachylenie w zakresach populacji. Ruch średni jest liczony z półosi przy dodawaniu i zapisany jako liczba
+// stałoprzecinkowa, żeby CPU i vertex shader liczyły fazę z dokładnie tej samej wartości
+struct BeltParticle {
+    uint16_t semiMajorAxis;
+    uint16_t eccentricity;
+    uint16_t inclination;
+    uint16_t ascendingNode;
+    uint16_t periapsisArgument;
+    uint16_t epochAnomaly;
+    uint32_t meanMotion;   // Obroty na sekundę razy 2^32
+    uint16_t population;   // Indeks w Belt::populations
+    uint8_t brightness;    // Albedo, 0..255
+    uint8_t size;          // Względny rozmiar punktu, 0..255
+};
+static_assert(sizeof(BeltParticle) == 20, "BeltParticle must stay 20 bytes");
+
+// Pasy małych ciał na stałych orbitach keplerowskich wokół Słońca, bez wzajemnego przyciągania.
+// Pozycje są czystą funkcją czasu i liczą się wprost ze skwantowanych elementów
+class Belt {
+public:
+    std::vector<BeltPopulation> populations;
+    std::vector<BeltParticle> particles;
+
+    size_t size() const { return particles.size(); }
+    bool empty() const { return particles.empty(); }
+    size_t memoryBytes() const { return particles.size() * sizeof(BeltParticle); }
+    void clear();
+
+    // Dodaje populację, zwraca jej indeks albo -1, gdy jest ich już maxBeltPopulations
+    int addPopulation(const BeltPopulation& population);
+
+    // Dodaje cząstkę na końcu populacji, przyjmuje parametry: indeks populacji, elementy orbity
+    // (meanMotion jest pomijany), jasność i rozmiar 0..1. Populacje dodaje się po kolei, jedna po drugiej
+    void add(int population, const OrbitalElements& elements, float brightness, float size);
+
+    // Liczy pozycje w chwili time względem Słońca jako kolejne trójki xyz, kawałkami na puli wątków
+    // i wektorowo jądrem orbit, przyjmuje parametry: czas w sekundach i wyjście (3 * size() liczb)
+    void evaluate(double time, float* positions) const;
+
+    // Elementy orbity po dekwantyzacji, przyjmuje parametr: indeks cząstki
+    OrbitalElements elements(size_t index) const;
+};
@@ -0,0 +1,267 @@
+﻿#include "belt_renderer.h"
+#include <glad/glad.h>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include "shader.h"
+
+// Vertex shader - czworokąt wokół pozycji cząstki, przesunięty w przestrzeni ekranu, więc zawsze zwrócony do kamery
+static const char* beltVertexShaderSource = R"(
+    #version 330 core
+    layout (location = 0) in vec2 aCorner;
+    layout (location = 1) in vec3 aPosition;
+    layout (location = 2) in uint aPopulation;
+    layout (location = 3) in vec2 aAppearance; // Jasność i rozmiar, 0..1
+
+    layout (std140) uniform Frame {
+        mat4 view;
+        mat4 projection;
+        vec4 lightPos;
+        vec4 lightColor;
+    };
+
+    uniform vec3 center;
+    uniform vec2 pixelSize; // Rozmiar piksela w NDC
+    uniform float pointSize;
+    uniform vec3 populationColors[8];
+
+    out vec2 Corner;
+    out vec3 Color;
+
+    void main() {
+        gl_Position = projection * view * vec4(center + aPosition, 1.0);
+        float diameter = pointSize * (0.5 + 0.5 * aAppearance.y);
+        gl_Position.xy += aCorner * diameter * pixelSize * gl_Position.w;
+        Corner = aCorner * 2.0;
+        Color = populationColors[aPopulation] * aAppearance.x;
+    }
+)";
+
+// Fragment shader - okrągły punkt
+static const char* beltFragmentShaderSource = R"(
+    #version 330 core
+    in vec2 Corner;
+    in vec3 Color;
+
+    out vec4 FragColor;
+
+    void main() {
+        if (dot(Corner, Corner) > 1.0)
+            discard;
+        FragColor = vec4(Color, 1.0);
+    }
+)";
+
+// Vertex shader - orbita keplerowska ze skwantowanych elementów, jeden punkt na cząstkę
+static const char* beltOrbitVertexShaderSource = R"(
+    #version 330 core
+    layout (location = 0) in uvec4 aElements; // Półoś, mimośród, nachylenie, węzeł
+    layout (location = 1) in uvec2 aPhase;    // Argument perycentrum, anomalia średnia w chwili 0
+    layout (location = 2) in uint aPopulation;
+    layout (location = 3) in vec2 aAppearance;
+    layout (location = 4) in uint aMeanMotion; // Obroty na sekundę razy 2^32
+
+    layout (std140) uniform Frame {
+        mat4 view;
+        mat4 projection;
+        vec4 lightPos;
+        vec4 lightColor;
+    };
+
+    uniform vec3 center;
+    uniform float pointSize;
+    uniform vec3 populationColors[8];
+    uniform vec4 populationElements[8]; // Najmniejsza półoś, zakres półosi, największy mimośród i nachylenie (radiany)
+    uniform uint timeSeconds;           // Całe sekundy czasu symulacji modulo 2^32
+    uniform float timeFraction;         // Ułamek sekundy, 0..1
+
+    out vec3 Color;
+
+    const float TWO_PI = 6.28318530718;
+
+    void main() {
+        vec4 range = populationElements[aPopulation];
+        float a = range.x + range.y * (float(aElements.x) / 65535.0);
+        float e = range.z * (float(aElements.y) / 65535.0);
+        float incl = range.w * (float(aElements.z) / 65535.0);
+        float node = float(aElements.w) * (TWO_PI / 65536.0);
+        float arg = float(aPhase.x) * (TWO_PI / 65536.0);
+
+        // Faza w obrotach jako liczba stałoprzecinkowa 0.32: mnożenie całkowite zawija się modulo 2^32, więc
+        // n * t jest dokładne dla dowolnie dużego t, a do float trafia tylko ułamek obrotu
+        uint phase = (aPhase.y << 16) + aMeanMotion * timeSeconds;
+        float turns = float(phase) * (1.0 / 4294967296.0) + float(aMeanMotion) * (1.0 / 4294967296.0) * timeFraction;
+        float M = (turns - floor(turns + 0.5)) * TWO_PI;
+
+        // Równanie Keplera jak w orbit_kernel.cpp: start z M + e sin M (1 + e cos M) i stała liczba iteracji Newtona
+        float E = M + e * sin(M) * (1.0 + e * cos(M));
+        for (int i = 0; i < 4; ++i)
+            E -= (E - e * sin(E) - M) / (1.0 - e * cos(E));
+
+        // Kierunki P i Q jak w BodyStore::setOrbit, biegunem sceny jest oś y
+        float ci = cos(incl), si = sin(incl), cn = cos(node), sn = sin(node), ca = cos(arg), sa = sin(arg);
+        vec3 P = vec3(cn * ca - sn * sa * ci, sa * si, sn * ca + cn * sa * ci);
+        vec3 Q = vec3(-cn * sa - sn * ca * ci, ca * si, -sn * sa + cn * ca * ci);
+        vec3 position = a * (cos(E) - e) * P + a * sqrt(1.0 - e * e) * sin(E) * Q;
+
+        gl_Position = projection * view * vec4(center + position, 1.0);
+        gl_PointSize = pointSize * (0.5 + 0.5 * aAppearance.y);
+        Color = populationColors[aPopulation] * aAppearance.x;
+    }
+)";
+
+// Fragment shader - okrągły punkt z gl_PointCoord
+static const char* beltOrbitFragmentShaderSource = R"(
+    #version 330 core
+    in vec3 Color;
+
+    out vec4 FragColor;
+
+    void main() {
+        vec2 corner = gl_PointCoord * 2.0 - 1.0;
+        if (dot(corner, corner) > 1.0)
+            discard;
+        FragColor = vec4(Color, 1.0);
+    }
+)";
+
+bool BeltRenderer::initialize() {
+    std::vector<unsigned int> programs = createPrograms({
+        { beltVertexShaderSource, beltFragmentShaderSource },
+        { beltOrbitVertexShaderSource, beltOrbitFragmentShaderSource }
+    });
+    program = programs[0];
+    orbitProgram = programs[1];
+    bindFrameUniforms(program);
+    bindFrameUniforms(orbitProgram);
+
+    // Wspólny czworokąt wszystkich instancji, rysowany jako pas trójkątów
+    const float corners[] = { -0.5f, -0.5f, 0.5f, -0.5f, -0.5f, 0.5f, 0.5f, 0.5f };
+    glGenVertexArrays(1, &vao);
+    glGenBuffers(1, &cornerVBO);
+    glGenBuffers(1, &particleVBO);
+    glGenBuffers(1, &positionVBO);
+
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, cornerVBO);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(corners), corners, GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+
+    // Pozycje, co klatkę, jedna na instancję
+    glBindBuffer(GL_ARRAY_BUFFER, positionVBO);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+    glVertexAttribDivisor(1, 1);
+    glEnableVertexAttribArray(1);
+
+    // Populacja, jasność i rozmiar wprost z tablicy BeltParticle
+    glBindBuffer(GL_ARRAY_BUFFER, particleVBO);
+    glVertexAttribIPointer(2, 1, GL_UNSIGNED_SHORT, sizeof(BeltParticle), (void*)offsetof(BeltParticle, population));
+    glVertexAttribDivisor(2, 1);
+    glEnableVertexAttribArray(2);
+    glVertexAttribPointer(3, 2, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(BeltParticle), (void*)offsetof(BeltParticle, brightness));
+    glVertexAttribDivisor(3, 1);
+    glEnableVertexAttribArray(3);
+
+    // Orbity na GPU: wszystkie atrybuty z tej samej tablicy BeltParticle, jeden wierzchołek na cząstkę
+    glGenVertexArrays(1, &orbitVAO);
+    glBindVertexArray(orbitVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, particleVBO);
+    glVertexAttribIPointer(0, 4, GL_UNSIGNED_SHORT, sizeof(BeltParticle), (void*)offsetof(BeltParticle, semiMajorAxis));
+    glEnableVertexAttribArray(0);
+    glVertexAttribIPointer(1, 2, GL_UNSIGNED_SHORT, sizeof(BeltParticle), (void*)offsetof(BeltParticle, periapsisArgument));
+    glEnableVertexAttribArray(1);
+    glVertexAttribIPointer(2, 1, GL_UNSIGNED_SHORT, sizeof(BeltParticle), (void*)offsetof(BeltParticle, population));
+    glEnableVertexAttribArray(2);
+    glVertexAttribPointer(3, 2, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(BeltParticle), (void*)offsetof(BeltParticle, brightness));
+    glEnableVertexAttribArray(3);
+    glVertexAttribIPointer(4, 1, GL_UNSIGNED_INT, sizeof(BeltParticle), (void*)offsetof(BeltParticle, meanMotion));
+    glEnableVertexAttribArray(4);
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    return program != 0 && orbitProgram != 0;
+}
+
+void BeltRenderer::release() {
+    glDeleteProgram(program);
+    glDeleteProgram(orbitProgram);
+    glDeleteVertexArrays(1, &vao);
+    glDeleteVertexArrays(1, &orbitVAO);
+    glDeleteBuffers(1, &cornerVBO);
+    glDeleteBuffers(1, &particleVBO);
+    glDeleteBuffers(1, &positionVBO);
+    program = vao = cornerVBO = particleVBO = positionVBO = orbitProgram = orbitVAO = 0;
+    count = 0;
+}
+
+// Funkcja wysyłająca stałe dane cząstek, przyjmuje parametr: pasy
+void BeltRenderer::upload(const Belt& belt) {
+    count = belt.size();
+    glBindBuffer(GL_ARRAY_BUFFER, particleVBO);
+    glBufferData(GL_ARRAY_BUFFER, belt.memoryBytes(), belt.particles.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    float colors[maxBeltPopulations * 3] = {};
+    for (size_t i = 0; i < belt.populations.size(); ++i) {
+        colors[i * 3 + 0] = belt.populations[i].colorR;
+        colors[i * 3 + 1] = belt.populations[i].colorG;
+        colors[i * 3 + 2] = belt.populations[i].colorB;
+    }
+    glUseProgram(program);
+    glUniform3fv(glGetUniformLocation(program, "populationColors"), maxBeltPopulations, colors);
+
+    // Zakresy kwantyzacji populacji dla orbit na GPU
+    float elements[maxBeltPopulations * 4] = {};
+    for (size_t i = 0; i < belt.populations.size(); ++i) {
+        const BeltPopulation& p = belt.populations[i];
+        elements[i * 4 + 0] = p.minSemiMajorAxis;
+        elements[i * 4 + 1] = p.maxSemiMajorAxis - p.minSemiMajorAxis;
+        elements[i * 4 + 2] = p.maxEccentricity;
+        elements[i * 4 + 3] = p.maxInclination * 0.0174532925199433f;
+    }
+    glUseProgram(orbitProgram);
+    glUniform3fv(glGetUniformLocation(orbitProgram, "populationColors"), maxBeltPopulations, colors);
+    glUniform4fv(glGetUniformLocation(orbitProgram, "populationElements"), maxBeltPopulations, elements);
+}
+
+// Funkcja rysująca pasy, przyjmuje parametry: pozycje względem Słońca, pozycja Słońca, szerokość i wysokość okna
+void BeltRenderer::draw(const std::vector<float>& positions, const glm::vec3& center, int width, int height) {
+    if (count == 0 || positions.size() < count * 3)
+        return;
+
+    // Nowy bufor co klatkę, żeby nie czekać na GPU rysujące jeszcze poprzednią klatkę
+    glBindBuffer(GL_ARRAY_BUFFER, positionVBO);
+    glBufferData(GL_ARRAY_BUFFER, count * 3 * sizeof(float), NULL, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, count * 3 * sizeof(float), positions.data());
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    glUseProgram(program);
+    glUniform3f(glGetUniformLocation(program, "center"), center.x, center.y, center.z);
+    glUniform2f(glGetUniformLocation(program, "pixelSize"), 2.0f / width, 2.0f / height);
+    glUniform1f(glGetUniformLocation(program, "pointSize"), pointSize);
+
+    glBindVertexArray(vao);
+    glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, (GLsizei)count);
+    glBindVertexArray(0);
+}
+
+// Funkcja rysująca pasy z orbitami na GPU, przyjmuje parametry: czas symulacji i pozycja Słońca
+void BeltRenderer::drawOrbits(double time, const glm::vec3& center) {
+    if (count == 0)
+        return;
+
+    // Czas jako całe sekundy modulo 2^32 (także ujemne, w kodzie uzupełnień do dwóch) i ułamek sekundy
+    double seconds = std::floor(time);
+    glUseProgram(orbitProgram);
+    glUniform1ui(glGetUniformLocation(orbitProgram, "timeSeconds"), (uint32_t)(int64_t)seconds);
+    glUniform1f(glGetUniformLocation(orbitProgram, "timeFraction"), (float)(time - seconds));
+    glUniform3f(glGetUniformLocation(orbitProgram, "center"), center.x, center.y, center.z);
+    glUniform1f(glGetUniformLocation(orbitProgram, "pointSize"), pointSize);
+
+    glEnable(GL_PROGRAM_POINT_SIZE);
+    glBindVertexArray(orbitVAO);
+    glDrawArrays(GL_POINTS, 0, (GLsizei)count);
+    glBindVertexArray(0);
+    glDisable(GL_PROGRAM_POINT_SIZE);
+}
@@ -0,0 +1,35 @@
+﻿#pragma once
+#include <glm/glm.hpp>
+#include <vector>
+#include "belt.h"
+
+// Rysowanie pasów w dwóch trybach. W draw jako instancjonowane punkty: jeden czworokąt na cząstkę, zwrócony
+// do kamery, o stałej średnicy w pikselach; stałe dane cząstek są wysyłane raz, co klatkę pozycje z CPU.
+// W drawOrbits pozycje liczy vertex shader ze skwantowanych elementów wysłanych raz, co klatkę zmienia się
+// tylko uniform czasu
+class BeltRenderer {
+public:
+    bool initialize();
+    void release();
+
+    // Wysyła stałe dane cząstek i kolory populacji, przyjmuje parametr: pasy
+    void upload(const Belt& belt);
+
+    // Rysuje cząstki, przyjmuje parametry: pozycje xyz względem Słońca, pozycja Słońca i rozmiar okna w pikselach
+    void draw(const std::vector<float>& positions, const glm::vec3& center, int width, int height);
+
+    // Rysuje cząstki z orbitami liczonymi na GPU, przyjmuje parametry: czas symulacji w sekundach i pozycja Słońca
+    void drawOrbits(double time, const glm::vec3& center);
+
+    float pointSize = 2.0f; // Średnica największych cząstek w pikselach
+
+private:
+    unsigned int program = 0;
+    unsigned int vao = 0;
+    unsigned int cornerVBO = 0;
+    unsigned int particleVBO = 0;
+    unsigned int positionVBO = 0;
+    unsigned int orbitProgram = 0;
+    unsigned int orbitVAO = 0;
+    size_t count = 0;
+};
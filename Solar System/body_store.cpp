@@ -0,0 +1,248 @@
+﻿#include "body_store.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include "parallel.h"
+
+static const float degToRad = 0.0174532925199433f;
+static const double degToRadDouble = 0.0174532925199432957692; // Dla faz, które mnożone są przez duże czasy
+
+void BodyStore::reserve(size_t count) {
+    parent.reserve(count);
+    semiMajorAxis.reserve(count);
+    eccentricity.reserve(count);
+    inclination.reserve(count);
+    ascendingNode.reserve(count);
+    periapsisArgument.reserve(count);
+    epochAnomaly.reserve(count);
+    meanMotion.reserve(count);
+    meanAnomaly.reserve(count);
+    periapsisX.reserve(count);
+    periapsisY.reserve(count);
+    periapsisZ.reserve(count);
+    minorAxisX.reserve(count);
+    minorAxisY.reserve(count);
+    minorAxisZ.reserve(count);
+    localX.reserve(count);
+    localY.reserve(count);
+    localZ.reserve(count);
+    positionX.reserve(count);
+    positionY.reserve(count);
+    positionZ.reserve(count);
+    localDirty.reserve(count);
+    moved.reserve(count);
+    worldSpace.reserve(count);
+    mass.reserve(count);
+    radius.reserve(count);
+    colorR.reserve(count);
+    colorG.reserve(count);
+    colorB.reserve(count);
+    textureID.reserve(count);
+    virtualTexture.reserve(count);
+}
+
+// Funkcja dodająca ciało, przyjmuje parametry: indeks rodzica, promień, kolor i elementy orbity
+int BodyStore::add(int parentIndex, float bodyRadius, float r, float g, float b, const OrbitalElements& orbit) {
+    parent.push_back(parentIndex);
+    semiMajorAxis.push_back(0.0f);
+    eccentricity.push_back(0.0f);
+    inclination.push_back(0.0f);
+    ascendingNode.push_back(0.0f);
+    periapsisArgument.push_back(0.0f);
+    epochAnomaly.push_back(0.0);
+    meanMotion.push_back(0.0);
+    meanAnomaly.push_back(0.0f);
+    periapsisX.push_back(0.0f);
+    periapsisY.push_back(0.0f);
+    periapsisZ.push_back(0.0f);
+    minorAxisX.push_back(0.0f);
+    minorAxisY.push_back(0.0f);
+    minorAxisZ.push_back(0.0f);
+    localX.push_back(0.0f);
+    localY.push_back(0.0f);
+    localZ.push_back(0.0f);
+    positionX.push_back(0.0f);
+    positionY.push_back(0.0f);
+    positionZ.push_back(0.0f);
+    localDirty.push_back(1);
+    moved.push_back(0);
+    worldSpace.push_back(0);
+    mass.push_back(0.0f);
+    radius.push_back(bodyRadius);
+    colorR.push_back(r);
+    colorG.push_back(g);
+    colorB.push_back(b);
+    textureID.push_back(0);
+    virtualTexture.push_back(0);
+
+    levelOffsets.clear(); // Nowe ciało na końcu psuje podział na poziomy
+
+    int index = (int)size() - 1;
+    setOrbit(index, orbit);
+    return index;
+}
+
+// Funkcja ustawiająca orbitę, przyjmuje parametry: indeks ciała i elementy orbity w stopniach
+void BodyStore::setOrbit(int index, const OrbitalElements& orbit) {
+    semiMajorAxis[index] = orbit.semiMajorAxis;
+    eccentricity[index] = orbit.eccentricity;
+    inclination[index] = orbit.inclination * degToRad;
+    ascendingNode[index] = orbit.ascendingNode * degToRad;
+    periapsisArgument[index] = orbit.periapsisArgument * degToRad;
+    epochAnomaly[index] = orbit.meanAnomaly * degToRadDouble;
+    meanMotion[index] = orbit.meanMotion * degToRadDouble;
+    meanAnomaly[index] = (float)epochAnomaly[index];
+
+    // Kierunki P i Q w układzie ekliptyki (X, Y, Z), gdzie Z jest biegunem
+    double cosNode = cos(ascendingNode[index]), sinNode = sin(ascendingNode[index]);
+    double cosArg = cos(periapsisArgument[index]), sinArg = sin(periapsisArgument[index]);
+    double cosIncl = cos(inclination[index]), sinIncl = sin(inclination[index]);
+    double pX = cosNode * cosArg - sinNode * sinArg * cosIncl;
+    double pY = sinNode * cosArg + cosNode * sinArg * cosIncl;
+    double pZ = sinArg * sinIncl;
+    double qX = -cosNode * sinArg - sinNode * cosArg * cosIncl;
+    double qY = -sinNode * sinArg + cosNode * cosArg * cosIncl;
+    double qZ = cosArg * sinIncl;
+
+    // W scenie biegunem jest oś y, a płaszczyzną odniesienia x-z, jak dla dotychczasowych orbit kołowych
+    double a = orbit.semiMajorAxis;
+    double b = a * sqrt(1.0 - (double)orbit.eccentricity * orbit.eccentricity);
+    periapsisX[index] = (float)(a * pX);
+    periapsisY[index] = (float)(a * pZ);
+    periapsisZ[index] = (float)(a * pY);
+    minorAxisX[index] = (float)(b * qX);
+    minorAxisY[index] = (float)(b * qZ);
+    minorAxisZ[index] = (float)(b * qY);
+}
+
+size_t BodyStore::updateHierarchy() {
+    if (levelOffsets.empty())
+        return updateRange(0, size());
+
+    std::atomic<size_t> updated{ 0 };
+    for (size_t level = 0; level + 1 < levelOffsets.size(); ++level) {
+        size_t first = levelOffsets[level];
+        parallelFor(levelOffsets[level + 1] - first, 4096, [&](size_t begin, size_t end) {
+            updated += updateRange(first + begin, first + end);
+        });
+    }
+    return updated;
+}
+
+// Funkcja składająca pozycje, przyjmuje parametry: początek i koniec zakresu ciał
+size_t BodyStore::updateRange(size_t begin, size_t end) {
+    size_t updated = 0;
+    for (size_t i = begin; i < end; ++i) {
+        int p = worldSpace[i] ? -1 : parent[i];
+        moved[i] = localDirty[i] || (p >= 0 && moved[p]);
+        localDirty[i] = 0;
+        if (!moved[i])
+            continue;
+
+        ++updated;
+        positionX[i] = localX[i];
+        positionY[i] = localY[i];
+        positionZ[i] = localZ[i];
+        if (p >= 0) {
+            positionX[i] += positionX[p];
+            positionY[i] += positionY[p];
+            positionZ[i] += positionZ[p];
+        }
+    }
+    return updated;
+}
+
+// Przestawia elementy tablicy według kolejności, przyjmuje parametry: tablica i stare indeksy w nowej kolejności
+template <typename T>
+static void permute(std::vector<T>& values, const std::vector<int>& order) {
+    std::vector<T> sorted(values.size());
+    for (size_t i = 0; i < order.size(); ++i) {
+        sorted[i] = values[order[i]];
+    }
+    values.swap(sorted);
+}
+
+std::vector<int> BodyStore::sortByParent() {
+    size_t count = size();
+
+    // Głębokość w hierarchii, rodzic jest dodawany przed dzieckiem
+    std::vector<int> depth(count, 0);
+    int maxDepth = 0;
+    for (size_t i = 0; i < count; ++i) {
+        if (parent[i] >= 0)
+            depth[i] = depth[parent[i]] + 1;
+        maxDepth = std::max(maxDepth, depth[i]);
+    }
+
+    // Poziom po poziomie; rodzice z poprzedniego poziomu mają już nowe indeksy
+    std::vector<int> order;
+    std::vector<int> remap(count, -1);
+    order.reserve(count);
+    levelOffsets.clear();
+    for (int level = 0; level <= maxDepth; ++level) {
+        size_t first = order.size();
+        levelOffsets.push_back(first);
+        for (size_t i = 0; i < count; ++i) {
+            if (depth[i] == level)
+                order.push_back((int)i);
+        }
+        std::stable_sort(order.begin() + first, order.end(), [&](int a, int b) {
+            int parentA = parent[a] >= 0 ? remap[parent[a]] : -1;
+            int parentB = parent[b] >= 0 ? remap[parent[b]] : -1;
+            return parentA < parentB;
+        });
+        for (size_t i = first; i < order.size(); ++i) {
+            remap[order[i]] = (int)i;
+        }
+    }
+
+    levelOffsets.push_back(count);
+
+    for (auto& index : parent) {
+        if (index >= 0)
+            index = remap[index];
+    }
+    permute(parent, order);
+    permute(semiMajorAxis, order);
+    permute(eccentricity, order);
+    permute(inclination, order);
+    permute(ascendingNode, order);
+    permute(periapsisArgument, order);
+    permute(epochAnomaly, order);
+    permute(meanMotion, order);
+    permute(meanAnomaly, order);
+    permute(periapsisX, order);
+    permute(periapsisY, order);
+    permute(periapsisZ, order);
+    permute(minorAxisX, order);
+    permute(minorAxisY, order);
+    permute(minorAxisZ, order);
+    permute(localX, order);
+    permute(localY, order);
+    permute(localZ, order);
+    permute(positionX, order);
+    permute(positionY, order);
+    permute(positionZ, order);
+    permute(localDirty, order);
+    permute(moved, order);
+    permute(worldSpace, order);
+    permute(mass, order);
+    permute(radius, order);
+    permute(colorR, order);
+    permute(colorG, order);
+    permute(colorB, order);
+    permute(textureID, order);
+    permute(virtualTexture, order);
+    return remap;
+}
+
+// Funkcja licząca zasięgi poddrzew, przyjmuje parametr: wyjście
+void BodyStore::subtreeExtents(std::vector<float>& out) const {
+    // Rodzic ma mniejszy indeks niż dziecko, więc przejście od końca przenosi gotowe zasięgi dzieci do rodziców
+    out.assign(radius.begin(), radius.end());
+    for (size_t i = size(); i-- > 0;) {
+        int p = parent[i];
+        if (p >= 0)
+            out[p] = std::max(out[p], semiMajorAxis[i] * (1.0f + eccentricity[i]) + out[i]);
+    }
+}
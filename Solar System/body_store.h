@@ -0,0 +1,99 @@
+﻿#pragma once
+#include <cstddef>
+#include <vector>
+
+// Sześć elementów orbity keplerowskiej, kąty w stopniach. Płaszczyzną odniesienia jest płaszczyzna y = 0 sceny
+struct OrbitalElements {
+    float semiMajorAxis = 0.0f;     // a
+    float eccentricity = 0.0f;      // e, 0..0.9 (patrz keplerIterations w orbit_kernel.h)
+    float inclination = 0.0f;       // i, powyżej 90 stopni orbita jest wsteczna
+    float ascendingNode = 0.0f;     // Omega, długość węzła wstępującego
+    float periapsisArgument = 0.0f; // omega, argument perycentrum
+    float meanAnomaly = 0.0f;       // M0, anomalia średnia w chwili 0
+    float meanMotion = 0.0f;        // n, stopnie na sekundę
+};
+
+// Magazyn ciał w układzie struktury tablic: każda właściwość leży w osobnej, ciągłej tablicy,
+// a indeks ciała jest wspólny dla wszystkich tablic. Księżyce leżą w tych samych tablicach co planety,
+// hierarchia może mieć dowolną głębokość (księżyce księżyców, barycentra par jak Pluton i Charon)
+class BodyStore {
+public:
+    // Hierarchia
+    std::vector<int> parent;          // Indeks ciała, wokół którego krąży, -1 dla Słońca
+
+    // Elementy orbit, kąty w radianach
+    std::vector<float> semiMajorAxis;
+    std::vector<float> eccentricity;
+    std::vector<float> inclination;
+    std::vector<float> ascendingNode;
+    std::vector<float> periapsisArgument;
+    std::vector<double> epochAnomaly; // M0, anomalia średnia w chwili 0
+    std::vector<double> meanMotion;   // Radiany na sekundę
+    std::vector<float> meanAnomaly;   // Anomalia średnia w bieżącej chwili, -pi..pi, wyliczana z M0 + n * t
+
+    // Wektory wyliczone z elementów przez setOrbit: a * P (kierunek perycentrum) i b * Q (prostopadły w płaszczyźnie orbity)
+    std::vector<float> periapsisX;
+    std::vector<float> periapsisY;
+    std::vector<float> periapsisZ;
+    std::vector<float> minorAxisX;
+    std::vector<float> minorAxisY;
+    std::vector<float> minorAxisZ;
+
+    // Pozycje względem rodzica, z których updateHierarchy składa pozycje w układzie świata
+    std::vector<float> localX;
+    std::vector<float> localY;
+    std::vector<float> localZ;
+
+    // Pozycje w układzie świata
+    std::vector<float> positionX;
+    std::vector<float> positionY;
+    std::vector<float> positionZ;
+
+    // Flagi hierarchii: localDirty - pozycja lokalna zmieniła się od ostatniego składania, moved - pozycja
+    // w układzie świata zmieniła się przy ostatnim składaniu, worldSpace - pozycja lokalna jest już w układzie
+    // świata (ciała całkowane w trybie grawitacyjnym), więc ruch rodzica jej nie przesuwa
+    std::vector<unsigned char> localDirty;
+    std::vector<unsigned char> moved;
+    std::vector<unsigned char> worldSpace;
+
+    // Początki kolejnych poziomów hierarchii po sortByParent, na końcu liczba ciał; pusta przed sortowaniem
+    std::vector<size_t> levelOffsets;
+
+    // Masa jako GM w jednostkach sceny, 0 dla ciał, które nie przyciągają cząstek
+    std::vector<float> mass;
+
+    // Wygląd
+    std::vector<float> radius;
+    std::vector<float> colorR;
+    std::vector<float> colorG;
+    std::vector<float> colorB;
+    std::vector<unsigned int> textureID;
+    std::vector<int> virtualTexture;  // Identyfikator tekstury wirtualnej, 0 gdy brak
+
+    size_t size() const { return parent.size(); }
+    void reserve(size_t count);
+
+    // Dodaje ciało, zwraca jego indeks, przyjmuje parametry: indeks rodzica (już dodanego), promień, kolor i orbita
+    int add(int parentIndex, float bodyRadius, float r, float g, float b, const OrbitalElements& orbit = OrbitalElements());
+
+    // Ustawia elementy orbity ciała i przelicza wektory aP i bQ, przyjmuje parametry: indeks ciała i elementy
+    void setOrbit(int index, const OrbitalElements& orbit);
+
+    // Składa pozycje w układzie świata jednym liniowym przejściem: rodzic ma mniejszy indeks niż dziecko,
+    // więc jest już gotowy. Ciała bez zmienionej pozycji lokalnej, których przodkowie się nie ruszyli,
+    // są pomijane. Po sortByParent ciała jednego poziomu są od siebie niezależne i dzielone między wątki.
+    // Zwraca liczbę przeliczonych ciał
+    size_t updateHierarchy();
+
+    // Układa ciała poziomami hierarchii, a w poziomie po rodzicu, tak że rodzic zawsze ma mniejszy indeks
+    // niż dziecko, a rodzeństwo leży obok siebie. Zwraca nowy indeks dla każdego starego
+    std::vector<int> sortByParent();
+
+    // Promień sfery wokół ciała obejmującej je i orbity wszystkich jego potomków (apocentra a (1 + e) złożone wzdłuż
+    // hierarchii), np. do sprawdzenia, czy układ planety z księżycami jest w widoku, przyjmuje parametr: wyjście
+    void subtreeExtents(std::vector<float>& out) const;
+
+private:
+    // Składa pozycje ciał z zakresu, których rodzice są już gotowi, zwraca liczbę przeliczonych
+    size_t updateRange(size_t begin, size_t end);
+};
@@ -0,0 +1,323 @@
+﻿#include "checkpoint.h"
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <type_traits>
+#include <vector>
+#include "mapped_file.h"
+
+static const uint32_t checkpointVersion = 1;
+static const uint32_t byteOrderTag = 0x01020304;
+static const uint64_t arrayAlignment = 64;
+
+// Identyfikatory tablic w spisie; nowe dopisujemy na końcu, zmiana znaczenia istniejącej wymaga nowej wersji
+enum CheckpointArrayId : uint32_t {
+    arrayBodyParent, arrayBodySemiMajorAxis, arrayBodyEccentricity, arrayBodyInclination, arrayBodyAscendingNode,
+    arrayBodyPeriapsisArgument, arrayBodyEpochAnomaly, arrayBodyMeanMotion, arrayBodyMeanAnomaly,
+    arrayBodyPeriapsisX, arrayBodyPeriapsisY, arrayBodyPeriapsisZ, arrayBodyMinorAxisX, arrayBodyMinorAxisY, arrayBodyMinorAxisZ,
+    arrayBodyLocalX, arrayBodyLocalY, arrayBodyLocalZ, arrayBodyPositionX, arrayBodyPositionY, arrayBodyPositionZ,
+    arrayBodyWorldSpace, arrayBodyMass, arrayBodyRadius, arrayBodyColorR, arrayBodyColorG, arrayBodyColorB,
+    arrayParticlePositionX, arrayParticlePositionY, arrayParticlePositionZ,
+    arrayParticleVelocityX, arrayParticleVelocityY, arrayParticleVelocityZ,
+    arrayParticleAccelerationX, arrayParticleAccelerationY, arrayParticleAccelerationZ, arrayParticleMass,
+    arrayMassivePositionX, arrayMassivePositionY, arrayMassivePositionZ,
+    arrayMassiveVelocityX, arrayMassiveVelocityY, arrayMassiveVelocityZ,
+    arrayMassiveAccelerationX, arrayMassiveAccelerationY, arrayMassiveAccelerationZ,
+    arrayMassiveMass, arrayMassivePrimary, arrayMassiveStepLevel, arrayIntegratedBody,
+    checkpointArrayCount
+};
+
+// Rodzaj liczności tablicy: liczba ciał, cząstek albo ciał całkowanych
+enum class ArrayGroup { Bodies, Particles, Massive };
+
+// Dostęp do prywatnych tablic symulacji i stanu integratora, przyjaciel Simulation i NBodySystem
+struct CheckpointAccess {
+    template <typename Visit>
+    static void visitArrays(Simulation& simulation, Visit visit);
+    static bool save(const Simulation& simulation, const char* path);
+    static bool load(Simulation& simulation, const char* path);
+};
+
+// Przechodzi po wszystkich tablicach stanu w kolejności identyfikatorów, ta sama lista służy do zapisu i odczytu,
+// przyjmuje parametry: symulacja i funkcja (identyfikator, grupa, tablica)
+template <typename Visit>
+void CheckpointAccess::visitArrays(Simulation& simulation, Visit visit) {
+    BodyStore& b = simulation.store;
+    ParticleStore& p = simulation.debris.particles;
+    NBodySystem& n = simulation.planets;
+    visit(arrayBodyParent, ArrayGroup::Bodies, b.parent);
+    visit(arrayBodySemiMajorAxis, ArrayGroup::Bodies, b.semiMajorAxis);
+    visit(arrayBodyEccentricity, ArrayGroup::Bodies, b.eccentricity);
+    visit(arrayBodyInclination, ArrayGroup::Bodies, b.inclination);
+    visit(arrayBodyAscendingNode, ArrayGroup::Bodies, b.ascendingNode);
+    visit(arrayBodyPeriapsisArgument, ArrayGroup::Bodies, b.periapsisArgument);
+    visit(arrayBodyEpochAnomaly, ArrayGroup::Bodies, b.epochAnomaly);
+    visit(arrayBodyMeanMotion, ArrayGroup::Bodies, b.meanMotion);
+    visit(arrayBodyMeanAnomaly, ArrayGroup::Bodies, b.meanAnomaly);
+    visit(arrayBodyPeriapsisX, ArrayGroup::Bodies, b.periapsisX);
+    visit(arrayBodyPeriapsisY, ArrayGroup::Bodies, b.periapsisY);
+    visit(arrayBodyPeriapsisZ, ArrayGroup::Bodies, b.periapsisZ);
+    visit(arrayBodyMinorAxisX, ArrayGroup::Bodies, b.minorAxisX);
+    visit(arrayBodyMinorAxisY, ArrayGroup::Bodies, b.minorAxisY);
+    visit(arrayBodyMinorAxisZ, ArrayGroup::Bodies, b.minorAxisZ);
+    visit(arrayBodyLocalX, ArrayGroup::Bodies, b.localX);
+    visit(arrayBodyLocalY, ArrayGroup::Bodies, b.localY);
+    visit(arrayBodyLocalZ, ArrayGroup::Bodies, b.localZ);
+    visit(arrayBodyPositionX, ArrayGroup::Bodies, b.positionX);
+    visit(arrayBodyPositionY, ArrayGroup::Bodies, b.positionY);
+    visit(arrayBodyPositionZ, ArrayGroup::Bodies, b.positionZ);
+    visit(arrayBodyWorldSpace, ArrayGroup::Bodies, b.worldSpace);
+    visit(arrayBodyMass, ArrayGroup::Bodies, b.mass);
+    visit(arrayBodyRadius, ArrayGroup::Bodies, b.radius);
+    visit(arrayBodyColorR, ArrayGroup::Bodies, b.colorR);
+    visit(arrayBodyColorG, ArrayGroup::Bodies, b.colorG);
+    visit(arrayBodyColorB, ArrayGroup::Bodies, b.colorB);
+    visit(arrayParticlePositionX, ArrayGroup::Particles, p.positionX);
+    visit(arrayParticlePositionY, ArrayGroup::Particles, p.positionY);
+    visit(arrayParticlePositionZ, ArrayGroup::Particles, p.positionZ);
+    visit(arrayParticleVelocityX, ArrayGroup::Particles, p.velocityX);
+    visit(arrayParticleVelocityY, ArrayGroup::Particles, p.velocityY);
+    visit(arrayParticleVelocityZ, ArrayGroup::Particles, p.velocityZ);
+    visit(arrayParticleAccelerationX, ArrayGroup::Particles, p.accelerationX);
+    visit(arrayParticleAccelerationY, ArrayGroup::Particles, p.accelerationY);
+    visit(arrayParticleAccelerationZ, ArrayGroup::Particles, p.accelerationZ);
+    visit(arrayParticleMass, ArrayGroup::Particles, p.mass);
+    visit(arrayMassivePositionX, ArrayGroup::Massive, n.positionX);
+    visit(arrayMassivePositionY, ArrayGroup::Massive, n.positionY);
+    visit(arrayMassivePositionZ, ArrayGroup::Massive, n.positionZ);
+    visit(arrayMassiveVelocityX, ArrayGroup::Massive, n.velocityX);
+    visit(arrayMassiveVelocityY, ArrayGroup::Massive, n.velocityY);
+    visit(arrayMassiveVelocityZ, ArrayGroup::Massive, n.velocityZ);
+    visit(arrayMassiveAccelerationX, ArrayGroup::Massive, n.accelerationX);
+    visit(arrayMassiveAccelerationY, ArrayGroup::Massive, n.accelerationY);
+    visit(arrayMassiveAccelerationZ, ArrayGroup::Massive, n.accelerationZ);
+    visit(arrayMassiveMass, ArrayGroup::Massive, n.mass);
+    visit(arrayMassivePrimary, ArrayGroup::Massive, n.primary);
+    visit(arrayMassiveStepLevel, ArrayGroup::Massive, n.stepLevel);
+    // Indeks w ciałach całkowanych dla każdego ciała, pusta poza trybem grawitacyjnym
+    visit(arrayIntegratedBody, ArrayGroup::Bodies, simulation.integratedBody);
+}
+
+bool CheckpointAccess::save(const Simulation& simulation, const char* path) {
+    auto start = std::chrono::steady_clock::now();
+    // Lista tablic przyjmuje magazyny do zapisu i do odczytu, przy zapisie tablice są tylko czytane
+    Simulation& state = const_cast<Simulation&>(simulation);
+    const NBodySystem& planets = simulation.planets;
+
+    CheckpointHeader header = {};
+    memcpy(header.magic, "SSCK", 4);
+    header.version = checkpointVersion;
+    header.byteOrder = byteOrderTag;
+    header.arrayCount = checkpointArrayCount;
+    header.bodyCount = simulation.store.size();
+    header.particleCount = simulation.debris.particles.size();
+    header.massiveCount = planets.size();
+    header.time = simulation.currentTime;
+    header.flags = (simulation.deterministicMode ? checkpointDeterministic : 0) | (simulation.detectContacts ? checkpointContacts : 0);
+    header.integrator = (uint32_t)planets.integrator;
+    header.integratorFlags = (planets.accelerationsValid ? checkpointAccelerationsValid : 0)
+        | (planets.scheduleValid ? checkpointScheduleValid : 0) | (planets.initialValid ? checkpointInitialValid : 0)
+        | (planets.trackInvariants ? checkpointTrackInvariants : 0);
+    header.blockMaxLevel = planets.blockSettings.maxLevel;
+    header.tick = planets.tick;
+    header.blockDt = planets.blockDt;
+    header.blockStepsPerOrbit = planets.blockSettings.stepsPerOrbit;
+    header.gravitySoftening = planets.gravity.softening;
+    header.initialEnergy = planets.initial.energy;
+    header.initialAngularMomentum[0] = planets.initial.angularMomentumX;
+    header.initialAngularMomentum[1] = planets.initial.angularMomentumY;
+    header.initialAngularMomentum[2] = planets.initial.angularMomentumZ;
+    header.lastEnergy = planets.lastEnergy;
+    const BarnesHutSettings& tree = simulation.debris.settings;
+    header.openingAngle = tree.openingAngle;
+    header.particleSoftening = tree.softening;
+    header.gravitationalConstant = tree.gravitationalConstant;
+    header.leafSize = tree.leafSize;
+    const ContactSettings& contacts = simulation.contactDetector.settings;
+    header.approachFactor = contacts.approachFactor;
+    header.particleRadius = contacts.particleRadius;
+    header.cellSize = contacts.cellSize;
+
+    // Spis: tablice jedna za drugą za spisem, każda od granicy 64 bajtów
+    std::vector<CheckpointArray> arrays;
+    std::vector<const void*> sources;
+    uint64_t offset = sizeof(CheckpointHeader) + (uint64_t)checkpointArrayCount * sizeof(CheckpointArray);
+    visitArrays(state, [&](uint32_t id, ArrayGroup, auto& values) {
+        offset = (offset + arrayAlignment - 1) / arrayAlignment * arrayAlignment;
+        CheckpointArray entry = { id, (uint32_t)sizeof(values[0]), values.size(), offset };
+        arrays.push_back(entry);
+        sources.push_back(values.data());
+        offset += entry.count * entry.elementSize;
+    });
+    header.fileSize = offset;
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        std::cout << "Failed to create checkpoint: " << path << std::endl;
+        return false;
+    }
+    file.write((const char*)&header, sizeof(header));
+    file.write((const char*)arrays.data(), arrays.size() * sizeof(CheckpointArray));
+    uint64_t written = sizeof(header) + arrays.size() * sizeof(CheckpointArray);
+    const char padding[arrayAlignment] = {};
+    for (size_t i = 0; i < arrays.size(); ++i) {
+        file.write(padding, arrays[i].offset - written);
+        file.write((const char*)sources[i], arrays[i].count * arrays[i].elementSize);
+        written = arrays[i].offset + arrays[i].count * arrays[i].elementSize;
+    }
+    if (!file) {
+        std::cout << "Failed to write checkpoint: " << path << std::endl;
+        return false;
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "Checkpoint: t = " << header.time << " s, " << header.bodyCount << " bodies, " << header.particleCount
+        << " particles, " << header.fileSize / (1024.0 * 1024.0) << " MB written to " << path << " in " << seconds << " s" << std::endl;
+    return true;
+}
+
+bool CheckpointAccess::load(Simulation& simulation, const char* path) {
+    auto start = std::chrono::steady_clock::now();
+    MappedFile file;
+    if (!file.open(path)) {
+        std::cout << "Failed to open checkpoint: " << path << std::endl;
+        return false;
+    }
+
+    // Nagłówek: wersja, kolejność bajtów, rozmiar pliku i scena o tej samej liczbie ciał
+    const CheckpointHeader* header = (const CheckpointHeader*)file.data();
+    bool valid = file.size() >= sizeof(CheckpointHeader) && memcmp(header->magic, "SSCK", 4) == 0
+        && header->version == checkpointVersion && header->byteOrder == byteOrderTag && header->fileSize == file.size()
+        && header->arrayCount == checkpointArrayCount && header->bodyCount == simulation.store.size()
+        && header->integrator <= (uint32_t)Integrator::BlockLeapfrog && header->blockMaxLevel >= 0 && header->blockMaxLevel < 62
+        && header->leafSize > 0
+        && (!(header->integratorFlags & checkpointScheduleValid)
+            || (header->tick >= 0 && std::isfinite(header->blockDt) && header->blockDt != 0.0))
+        && sizeof(CheckpointHeader) + (uint64_t)header->arrayCount * sizeof(CheckpointArray) <= file.size();
+    if (!valid) {
+        std::cout << "Invalid checkpoint: " << path << std::endl;
+        return false;
+    }
+
+    // Spis: każda tablica na swoim miejscu, o rozmiarze elementu jak w pamięci, z liczbą elementów jej grupy
+    // i w całości w pliku. Tablica ciał całkowanych jest pusta poza trybem grawitacyjnym. Całe sprawdzenie
+    // odbywa się na zmapowanym pliku, zanim cokolwiek zostanie skopiowane, więc przy błędzie symulacja się nie zmienia
+    const CheckpointArray* arrays = (const CheckpointArray*)(file.data() + sizeof(CheckpointHeader));
+    auto arrayData = [&](uint32_t id) { return file.data() + arrays[id].offset; };
+    visitArrays(simulation, [&](uint32_t id, ArrayGroup group, auto& values) {
+        const CheckpointArray& entry = arrays[id];
+        uint64_t expected = group == ArrayGroup::Bodies ? header->bodyCount
+            : group == ArrayGroup::Particles ? header->particleCount : header->massiveCount;
+        if (id == arrayIntegratedBody && header->massiveCount == 0)
+            expected = 0;
+        valid = valid && entry.id == id && entry.elementSize == sizeof(values[0]) && entry.count == expected
+            && entry.offset % arrayAlignment == 0 && entry.offset <= file.size()
+            && entry.count <= (file.size() - entry.offset) / entry.elementSize;
+    });
+
+    // Hierarchia posortowana wszerz jak po sortByParent: rodzic przed dzieckiem, poziomy rosnąco.
+    // Indeksy ciał całkowanych i ich ciał głównych w zakresie, poziomy kroków blokowych w [0, blockMaxLevel],
+    // bo całkowanie przesuwa 1 o stepLevel
+    size_t bodyCount = (size_t)header->bodyCount;
+    std::vector<int> depth(bodyCount, 0);
+    if (valid) {
+        const int* parent = (const int*)arrayData(arrayBodyParent);
+        for (size_t i = 0; i < bodyCount && valid; ++i) {
+            valid = parent[i] < (int)i && (parent[i] >= 0 || i == 0);
+            if (valid && parent[i] >= 0) {
+                depth[i] = depth[parent[i]] + 1;
+                valid = depth[i] >= depth[i - 1];
+            }
+        }
+        const int* integrated = (const int*)arrayData(arrayIntegratedBody);
+        for (size_t i = 0; i < arrays[arrayIntegratedBody].count && valid; ++i) {
+            valid = integrated[i] >= -1 && integrated[i] < (int)header->massiveCount;
+        }
+        const int* primary = (const int*)arrayData(arrayMassivePrimary);
+        for (size_t i = 0; i < header->massiveCount && valid; ++i) {
+            valid = primary[i] >= -1 && primary[i] < (int)header->massiveCount;
+        }
+        const int* stepLevel = (const int*)arrayData(arrayMassiveStepLevel);
+        for (size_t i = 0; i < header->massiveCount && valid; ++i) {
+            valid = stepLevel[i] >= 0 && stepLevel[i] <= header->blockMaxLevel;
+        }
+    }
+    if (!valid) {
+        std::cout << "Invalid checkpoint: " << path << std::endl;
+        return false;
+    }
+
+    // Odtworzenie: jedno kopiowanie bloku na tablicę, strony pliku system wczytuje przy pierwszym dostępie
+    simulation.planets = NBodySystem();
+    visitArrays(simulation, [&](uint32_t id, ArrayGroup, auto& values) {
+        typedef typename std::remove_reference<decltype(values)>::type::value_type Element;
+        const Element* data = (const Element*)arrayData(id);
+        values.assign(data, data + arrays[id].count);
+    });
+
+    BodyStore& bodies = simulation.store;
+    bodies.levelOffsets.clear();
+    for (size_t i = 0; i < bodies.size(); ++i) {
+        if (i == 0 || depth[i] != depth[i - 1])
+            bodies.levelOffsets.push_back(i);
+    }
+    bodies.levelOffsets.push_back(bodies.size());
+    bodies.localDirty.assign(bodies.size(), 1);
+    bodies.moved.assign(bodies.size(), 1);
+
+    NBodySystem& planets = simulation.planets;
+    planets.integrator = (Integrator)header->integrator;
+    planets.accelerationsValid = (header->integratorFlags & checkpointAccelerationsValid) != 0;
+    planets.scheduleValid = (header->integratorFlags & checkpointScheduleValid) != 0;
+    planets.initialValid = (header->integratorFlags & checkpointInitialValid) != 0;
+    planets.trackInvariants = (header->integratorFlags & checkpointTrackInvariants) != 0;
+    planets.blockSettings.maxLevel = header->blockMaxLevel;
+    planets.blockSettings.stepsPerOrbit = header->blockStepsPerOrbit;
+    planets.tick = header->tick;
+    planets.blockDt = header->blockDt;
+    planets.gravity.softening = (float)header->gravitySoftening;
+    planets.initial.energy = header->initialEnergy;
+    planets.initial.angularMomentumX = header->initialAngularMomentum[0];
+    planets.initial.angularMomentumY = header->initialAngularMomentum[1];
+    planets.initial.angularMomentumZ = header->initialAngularMomentum[2];
+    planets.lastEnergy = header->lastEnergy;
+
+    BarnesHutSettings& tree = simulation.debris.settings;
+    tree.openingAngle = header->openingAngle;
+    tree.softening = header->particleSoftening;
+    tree.gravitationalConstant = header->gravitationalConstant;
+    tree.leafSize = header->leafSize;
+
+    // Pozycje lokalne z pliku są aktualne dla zapisanego czasu, zostają policzone od nowa tylko po kroku
+    simulation.currentTime = header->time;
+    simulation.evaluatedTime = header->time;
+    simulation.particleLag = 0.0;
+    simulation.lod.particleLag = 0.0;
+    simulation.deterministicMode = (header->flags & checkpointDeterministic) != 0;
+    simulation.detectContacts = false;
+    simulation.contactDetector = ContactDetector();
+    simulation.contactEvents.clear();
+    if (header->flags & checkpointContacts) {
+        ContactSettings contacts;
+        contacts.approachFactor = header->approachFactor;
+        contacts.particleRadius = header->particleRadius;
+        contacts.cellSize = header->cellSize;
+        simulation.enableContacts(contacts);
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "Checkpoint: t = " << header->time << " s, " << header->bodyCount << " bodies, " << header->particleCount
+        << " particles, " << file.size() / (1024.0 * 1024.0) << " MB restored from " << path << " in " << seconds << " s" << std::endl;
+    return true;
+}
+
+// Funkcja zapisująca stan symulacji, przyjmuje parametry: symulacja i ścieżka pliku
+bool saveCheckpoint(const Simulation& simulation, const char* path) {
+    return CheckpointAccess::save(simulation, path);
+}
+
+// Funkcja odtwarzająca stan symulacji, przyjmuje parametry: symulacja i ścieżka pliku
+bool loadCheckpoint(Simulation& simulation, const char* path) {
+    return CheckpointAccess::load(simulation, path);
+}
@@ -0,0 +1,67 @@
+﻿#pragma once
+#include <cstddef>
+#include <cstdint>
+#include "simulation.h"
+
+// Nagłówek pliku stanu symulacji (.ssck). Po nagłówku leży spis tablic, a po nim same tablice w układzie
+// z pamięci (struktura tablic magazynów), każda wyrównana do 64 bajtów, więc odtworzenie to zmapowanie pliku,
+// sprawdzenie nagłówka i spisu oraz jedno kopiowanie bloku na tablicę, bez czytania pól po kolei
+struct CheckpointHeader {
+    char magic[4];           // "SSCK"
+    uint32_t version;
+    uint32_t byteOrder;      // 0x01020304 zapisane w kolejności bajtów maszyny, która zapisała plik
+    uint32_t arrayCount;     // Liczba wpisów CheckpointArray zaraz po nagłówku
+    uint64_t fileSize;
+    uint64_t bodyCount;
+    uint64_t particleCount;
+    uint64_t massiveCount;   // Ciała całkowane w trybie grawitacyjnym, 0 poza nim
+    double time;             // Czas symulacji
+    uint32_t flags;          // checkpointDeterministic, checkpointContacts
+    uint32_t integrator;     // Integrator ciał z masą
+
+    // Stan całkowania ciał z masą w trakcie kroków blokowych i odniesienie dryfu
+    uint32_t integratorFlags; // checkpointAccelerationsValid, checkpointScheduleValid, checkpointInitialValid, checkpointTrackInvariants
+    int32_t blockMaxLevel;
+    int64_t tick;
+    double blockDt;
+    double blockStepsPerOrbit;
+    double gravitySoftening;
+    double initialEnergy;
+    double initialAngularMomentum[3];
+    double lastEnergy;
+
+    // Ustawienia cząstek i wykrywania zbliżeń
+    float openingAngle;
+    float particleSoftening;
+    float gravitationalConstant;
+    uint32_t leafSize;
+    float approachFactor;
+    float particleRadius;
+    float cellSize;
+    uint32_t reserved;
+};
+
+// Wpis spisu: jedna tablica magazynu
+struct CheckpointArray {
+    uint32_t id;          // Identyfikator tablicy, zob. checkpoint.cpp
+    uint32_t elementSize; // Rozmiar elementu w bajtach, sprawdzany przy odtwarzaniu
+    uint64_t count;
+    uint64_t offset;      // Przesunięcie w pliku, wielokrotność 64
+};
+
+const uint32_t checkpointDeterministic = 1;
+const uint32_t checkpointContacts = 2;
+const uint32_t checkpointAccelerationsValid = 1;
+const uint32_t checkpointScheduleValid = 2;
+const uint32_t checkpointInitialValid = 4;
+const uint32_t checkpointTrackInvariants = 8;
+
+// Zapisuje pełny stan symulacji: elementy orbit i wektory stanu ciał, hierarchię, cząstki, ciała całkowane
+// ze stanem integratora i czas. Efemerydy nie są zapisywane, plik trzeba podać ponownie.
+// Zwraca false przy błędzie zapisu, przyjmuje parametry: symulacja i ścieżka
+bool saveCheckpoint(const Simulation& simulation, const char* path);
+
+// Odtwarza stan z pliku do symulacji zbudowanej z tej samej sceny (ta sama liczba ciał, tekstury zostają z niej).
+// Przy błędzie symulacja się nie zmienia. Zwraca false, gdy pliku nie ma albo nie przechodzi sprawdzenia,
+// przyjmuje parametry: symulacja i ścieżka
+bool loadCheckpoint(Simulation& simulation, const char* path);
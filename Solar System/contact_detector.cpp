@@ -0,0 +1,218 @@
+﻿#include "contact_detector.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <mutex>
+#include "parallel.h"
+
+static const int maxLevels = 16;             // Poziom zapisany na 4 bitach klucza
+static const uint64_t noCell = ~0ull;        // Obiekt poza siatką
+static const uint64_t coordinateMask = 0xFFFFF; // 20 bitów na współrzędną komórki
+static const size_t directLevelSize = 27;    // Poziom z tyloma obiektami jest tańszy do przejrzenia niż 27 komórek
+
+void ContactDetector::reset() {
+    bodyCount = 0;
+    particleCount = 0;
+    cells.clear();
+    activePairs.clear();
+    nearPairs.clear();
+    level.clear();
+}
+
+// Przelicza zasięgi i poziomy obiektów i czyści siatkę, przyjmuje parametry: ciała i liczba cząstek
+void ContactDetector::rebuild(const BodyStore& bodies, size_t particles) {
+    reset();
+    bodyCount = bodies.size();
+    particleCount = particles;
+    size_t count = bodyCount + particleCount;
+
+    radius.assign(count, settings.particleRadius);
+    for (size_t i = 0; i < bodyCount; ++i) {
+        radius[i] = bodies.radius[i];
+    }
+    reach.resize(count);
+    float smallest = 0.0f;
+    for (size_t i = 0; i < count; ++i) {
+        reach[i] = radius[i] * settings.approachFactor;
+        if (reach[i] > 0.0f && (smallest == 0.0f || reach[i] < smallest))
+            smallest = reach[i];
+    }
+
+    // Najmniejsza komórka mieści dwa zasięgi najmniejszego obiektu, każdy kolejny poziom jest dwa razy większy
+    baseCell = settings.cellSize > 0.0f ? settings.cellSize : std::max(2.0f * smallest, 1.0e-6f);
+    level.assign(count, -1);
+    levelMask = 0;
+    levelObjects.assign(maxLevels, std::vector<int>());
+    for (size_t i = 0; i < count; ++i) {
+        if (reach[i] <= 0.0f)
+            continue;
+        int k = 0;
+        while (k < maxLevels - 1 && baseCell * (float)(1 << k) < 2.0f * reach[i]) {
+            ++k;
+        }
+        level[i] = k;
+        levelMask |= 1u << k;
+        if (levelObjects[k].size() <= directLevelSize)
+            levelObjects[k].push_back((int)i);
+    }
+    for (std::vector<int>& objects : levelObjects) {
+        if (objects.size() > directLevelSize)
+            objects.clear();
+    }
+
+    positionX.resize(count);
+    positionY.resize(count);
+    positionZ.resize(count);
+    objectCell.assign(count, noCell);
+    objectSlot.assign(count, -1);
+}
+
+// Klucz komórki: poziom na 4 bitach i współrzędne komórki na 20 bitach każda (zawijane, więc odległe komórki
+// mogą dzielić klucz, co kosztuje tylko dodatkowe sprawdzenia), przyjmuje parametry: poziom, pozycja i przesunięcie
+uint64_t ContactDetector::cellKey(int cellLevel, float x, float y, float z, int dx, int dy, int dz) const {
+    float inverse = 1.0f / (baseCell * (float)(1 << cellLevel));
+    uint64_t ix = (uint64_t)((int64_t)std::floor(x * inverse) + dx) & coordinateMask;
+    uint64_t iy = (uint64_t)((int64_t)std::floor(y * inverse) + dy) & coordinateMask;
+    uint64_t iz = (uint64_t)((int64_t)std::floor(z * inverse) + dz) & coordinateMask;
+    return ((uint64_t)cellLevel << 60) | (ix << 40) | (iy << 20) | iz;
+}
+
+void ContactDetector::insert(int object, uint64_t key) {
+    std::vector<int>& objects = cells[key];
+    objectSlot[object] = (int)objects.size();
+    objects.push_back(object);
+    objectCell[object] = key;
+}
+
+// Usuwa obiekt z komórki, zamieniając go z ostatnim
+void ContactDetector::remove(int object) {
+    auto it = cells.find(objectCell[object]);
+    std::vector<int>& objects = it->second;
+    int last = objects.back();
+    objects[objectSlot[object]] = last;
+    objectSlot[last] = objectSlot[object];
+    objects.pop_back();
+    if (objects.empty())
+        cells.erase(it);
+    objectCell[object] = noCell;
+}
+
+// Czy para ciał jest stale związana: ciało i jego satelita albo dwa ciała krążące wokół barycentrum
+bool ContactDetector::bound(const BodyStore& bodies, int a, int b) const {
+    int parentA = bodies.parent[a];
+    int parentB = bodies.parent[b];
+    if (parentA == b || parentB == a)
+        return true;
+    return parentA == parentB && parentA >= 0 && bodies.radius[parentA] <= 0.0f;
+}
+
+// Funkcja szukająca zdarzeń, przyjmuje parametry: ciała, cząstki, czas symulacji i wyjście
+void ContactDetector::update(const BodyStore& bodies, const ParticleStore& particles, double time, std::vector<ContactEvent>& events) {
+    auto start = std::chrono::steady_clock::now();
+    if (level.empty() || bodies.size() != bodyCount || particles.size() != particleCount)
+        rebuild(bodies, particles.size());
+    size_t count = bodyCount + particleCount;
+
+    std::copy(bodies.positionX.begin(), bodies.positionX.end(), positionX.begin());
+    std::copy(bodies.positionY.begin(), bodies.positionY.end(), positionY.begin());
+    std::copy(bodies.positionZ.begin(), bodies.positionZ.end(), positionZ.begin());
+    std::copy(particles.positionX.begin(), particles.positionX.end(), positionX.begin() + bodyCount);
+    std::copy(particles.positionY.begin(), particles.positionY.end(), positionY.begin() + bodyCount);
+    std::copy(particles.positionZ.begin(), particles.positionZ.end(), positionZ.begin() + bodyCount);
+
+    // Przyrostowo: przenoszone są tylko obiekty, które opuściły swoją komórkę
+    size_t moves = 0;
+    for (size_t i = 0; i < count; ++i) {
+        if (level[i] < 0)
+            continue;
+        uint64_t key = cellKey(level[i], positionX[i], positionY[i], positionZ[i], 0, 0, 0);
+        if (key == objectCell[i])
+            continue;
+        if (objectCell[i] != noCell)
+            remove((int)i);
+        insert((int)i, key);
+        ++moves;
+    }
+
+    // Pary z 27 sąsiednich komórek na poziomie obiektu i wyższych. Na własnym poziomie para jest sprawdzana
+    // tylko od strony mniejszego indeksu, obiekt z wyższego poziomu znajduje zawsze mniejszy z pary
+    nearPairs.clear();
+    size_t candidates = 0;
+    std::mutex mutex;
+    parallelFor(count, 4096, [&](size_t begin, size_t end) {
+        std::vector<NearPair> found;
+        size_t checked = 0;
+        for (size_t i = begin; i < end; ++i) {
+            if (level[i] < 0)
+                continue;
+            float x = positionX[i], y = positionY[i], z = positionZ[i];
+            auto test = [&](int j, int k) {
+                if (k == level[i] && j <= (int)i)
+                    return;
+                ++checked;
+                float ex = positionX[j] - x, ey = positionY[j] - y, ez = positionZ[j] - z;
+                float distanceSquared = ex * ex + ey * ey + ez * ez;
+                float limit = reach[i] + reach[j];
+                if (distanceSquared >= limit * limit)
+                    return;
+                if (i < bodyCount && (size_t)j < bodyCount && bound(bodies, (int)i, j))
+                    return;
+                float distance = std::sqrt(distanceSquared);
+                uint64_t a = std::min((uint64_t)i, (uint64_t)j), b = std::max((uint64_t)i, (uint64_t)j);
+                found.push_back({ (a << 32) | b, distance, (unsigned char)(distance < radius[i] + radius[j] ? 2 : 1) });
+            };
+            for (int k = level[i]; k < maxLevels; ++k) {
+                if (!(levelMask & (1u << k)))
+                    continue;
+                if (!levelObjects[k].empty()) {
+                    for (int j : levelObjects[k]) {
+                        test(j, k);
+                    }
+                    continue;
+                }
+                for (int dz = -1; dz <= 1; ++dz)
+                for (int dy = -1; dy <= 1; ++dy)
+                for (int dx = -1; dx <= 1; ++dx) {
+                    auto it = cells.find(cellKey(k, x, y, z, dx, dy, dz));
+                    if (it == cells.end())
+                        continue;
+                    for (int j : it->second) {
+                        test(j, k);
+                    }
+                }
+            }
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        nearPairs.insert(nearPairs.end(), found.begin(), found.end());
+        candidates += checked;
+    });
+
+    // Kolejność zdarzeń niezależna od podziału pracy między wątki
+    std::sort(nearPairs.begin(), nearPairs.end(), [](const NearPair& a, const NearPair& b) { return a.key < b.key; });
+
+    // Zdarzenie tylko przy wejściu pary do strefy, para w strefie od poprzedniego kroku nie jest zgłaszana ponownie
+    std::unordered_map<uint64_t, unsigned char> current;
+    current.reserve(nearPairs.size());
+    size_t colliding = 0;
+    size_t firstEvent = events.size();
+    for (const NearPair& pair : nearPairs) {
+        auto previous = activePairs.find(pair.key);
+        unsigned char before = previous == activePairs.end() ? 0 : previous->second;
+        int a = (int)(pair.key >> 32), b = (int)(pair.key & 0xFFFFFFFFu);
+        if (before == 0)
+            events.push_back({ ContactType::CloseApproach, a, b, time, pair.distance });
+        if (pair.state == 2 && before < 2)
+            events.push_back({ ContactType::Collision, a, b, time, pair.distance });
+        colliding += pair.state == 2;
+        current[pair.key] = pair.state;
+    }
+    activePairs.swap(current);
+
+    statistics.objects = count;
+    statistics.cellMoves = moves;
+    statistics.candidatePairs = candidates;
+    statistics.nearPairs = nearPairs.size();
+    statistics.collidingPairs = colliding;
+    statistics.events += events.size() - firstEvent;
+    statistics.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
@@ -0,0 +1,88 @@
+﻿#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include "body_store.h"
+#include "particle_system.h"
+
+// Rodzaj zdarzenia między dwoma obiektami
+enum class ContactType {
+    CloseApproach, // Środki bliżej niż approachFactor razy suma promieni
+    Collision      // Sfery się przecinają
+};
+
+// Zdarzenie zgłaszane raz, gdy para wchodzi w strefę zbliżenia albo zderzenia
+struct ContactEvent {
+    ContactType type;
+    int first;        // Indeksy obiektów, first < second: ciała 0..liczba ciał - 1, dalej cząstki
+    int second;
+    double time;      // Czas symulacji
+    float distance;   // Odległość środków
+};
+
+struct ContactSettings {
+    float approachFactor = 3.0f;   // Zbliżenie, gdy odległość środków < approachFactor * (r1 + r2)
+    float particleRadius = 0.002f; // Promień cząstek, które nie mają własnego
+    float cellSize = 0.0f;         // Najmniejsza komórka siatki, 0 - dwa zasięgi najmniejszego obiektu
+};
+
+struct ContactStats {
+    size_t objects = 0;        // Obiekty w siatce
+    size_t cellMoves = 0;      // Obiekty, które w ostatnim kroku zmieniły komórkę
+    size_t candidatePairs = 0; // Pary z sąsiednich komórek sprawdzone dokładnie
+    size_t nearPairs = 0;      // Pary w strefie zbliżenia
+    size_t collidingPairs = 0; // Pary w kontakcie
+    size_t events = 0;         // Zdarzenia zgłoszone od startu
+    double milliseconds = 0.0; // Czas ostatniej aktualizacji
+};
+
+// Wykrywanie zbliżeń i zderzeń: hierarchiczna siatka haszowana (poziomy o komórkach 2^k razy większych),
+// każdy obiekt leży w jednej komórce poziomu, na którym komórka jest nie mniejsza niż dwa jego zasięgi.
+// Siatka jest aktualizowana przyrostowo, przenoszone są tylko obiekty, które zmieniły komórkę, a pary
+// szukane są w 27 sąsiednich komórkach na poziomie obiektu i poziomach wyższych, więc koszt rośnie
+// z liczbą bliskich par, a nie z kwadratem liczby obiektów. Pary stale związane (ciało i jego księżyc,
+// składniki pary wokół barycentrum) i ciała bez promienia są pomijane. Poziomy z kilkoma obiektami (Słońce,
+// planety) są przeglądane wprost, bez 27 zapytań do tablicy haszującej
+class ContactDetector {
+public:
+    ContactSettings settings;
+
+    // Aktualizuje siatkę i dopisuje nowe zdarzenia, przyjmuje parametry: ciała, cząstki, czas symulacji i wyjście
+    void update(const BodyStore& bodies, const ParticleStore& particles, double time, std::vector<ContactEvent>& events);
+
+    // Zapomina siatkę i aktywne pary, np. po skoku w czasie
+    void reset();
+
+    const ContactStats& stats() const { return statistics; }
+
+private:
+    // Para w strefie zbliżenia znaleziona w bieżącym kroku
+    struct NearPair {
+        uint64_t key;     // Mniejszy indeks w starszych 32 bitach
+        float distance;
+        unsigned char state; // 1 - zbliżenie, 2 - zderzenie
+    };
+
+    void rebuild(const BodyStore& bodies, size_t particleCount);
+    uint64_t cellKey(int level, float x, float y, float z, int dx, int dy, int dz) const;
+    void insert(int object, uint64_t key);
+    void remove(int object);
+    bool bound(const BodyStore& bodies, int a, int b) const;
+
+    size_t bodyCount = 0;
+    size_t particleCount = 0;
+    float baseCell = 1.0f;
+    unsigned int levelMask = 0; // Poziomy, na których leży choć jeden obiekt
+
+    std::vector<float> positionX, positionY, positionZ;
+    std::vector<float> radius, reach; // Promień i zasięg zbliżenia (approachFactor * promień)
+    std::vector<int> level;           // -1 - obiekt pominięty
+    std::vector<std::vector<int>> levelObjects; // Obiekty poziomów, które przegląda się wprost zamiast przez siatkę
+    std::vector<uint64_t> objectCell;
+    std::vector<int> objectSlot;      // Miejsce obiektu w wektorze jego komórki
+    std::unordered_map<uint64_t, std::vector<int>> cells;
+    std::unordered_map<uint64_t, unsigned char> activePairs; // Pary ze strefy w poprzednim kroku
+    std::vector<NearPair> nearPairs;
+    ContactStats statistics;
+};
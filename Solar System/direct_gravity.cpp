@@ -0,0 +1,198 @@
+﻿#include "direct_gravity.h"
+#include <algorithm>
+#include <cmath>
+#include "orbit_kernel.h"
+#include "parallel.h"
+#include "simd.h"
+
+// Jeden kafel ciał przyciągających dla ciał begin..end, po jednym ciele, przyjmuje parametry: tablice, zakres ciał i kafel
+static void tileScalar(const GravityArrays& g, size_t begin, size_t end, size_t tileBegin, size_t tileEnd) {
+    for (size_t i = begin; i < end; ++i) {
+        float xi = g.targetX[i], yi = g.targetY[i], zi = g.targetZ[i];
+        float ax = 0.0f, ay = 0.0f, az = 0.0f;
+        for (size_t j = tileBegin; j < tileEnd; ++j) {
+            float dx = g.x[j] - xi, dy = g.y[j] - yi, dz = g.z[j] - zi;
+            float r2 = dx * dx + dy * dy + dz * dz + g.softening2;
+            if (r2 <= 0.0f)
+                continue;
+            float inv = 1.0f / sqrtf(r2);
+            float strength = g.mass[j] * inv * inv * inv;
+            ax += dx * strength;
+            ay += dy * strength;
+            az += dz * strength;
+        }
+        g.ax[i] += ax;
+        g.ay[i] += ay;
+        g.az[i] += az;
+    }
+}
+
+#ifdef SIMD_X86
+// 4 ciała naraz; rsqrt ma 12 bitów, krok Newtona y * (1.5 - 0.5 * r2 * y * y) daje prawie pełną precyzję float
+static void tileSSE2(const GravityArrays& g, size_t begin, size_t end, size_t tileBegin, size_t tileEnd) {
+    const __m128 half = _mm_set1_ps(0.5f);
+    const __m128 threeHalves = _mm_set1_ps(1.5f);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 softening2 = _mm_set1_ps(g.softening2);
+    for (size_t i = begin; i < end; i += 4) {
+        __m128 xi = _mm_loadu_ps(g.targetX + i), yi = _mm_loadu_ps(g.targetY + i), zi = _mm_loadu_ps(g.targetZ + i);
+        __m128 ax = zero, ay = zero, az = zero;
+        for (size_t j = tileBegin; j < tileEnd; ++j) {
+            __m128 dx = _mm_sub_ps(_mm_set1_ps(g.x[j]), xi);
+            __m128 dy = _mm_sub_ps(_mm_set1_ps(g.y[j]), yi);
+            __m128 dz = _mm_sub_ps(_mm_set1_ps(g.z[j]), zi);
+            __m128 r2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_add_ps(_mm_mul_ps(dz, dz), softening2));
+            __m128 inv = _mm_rsqrt_ps(r2);
+            inv = _mm_mul_ps(inv, _mm_sub_ps(threeHalves, _mm_mul_ps(_mm_mul_ps(half, r2), _mm_mul_ps(inv, inv))));
+            inv = _mm_and_ps(inv, _mm_cmpgt_ps(r2, zero)); // To samo ciało bez wygładzenia
+            __m128 strength = _mm_mul_ps(_mm_set1_ps(g.mass[j]), _mm_mul_ps(inv, _mm_mul_ps(inv, inv)));
+            ax = _mm_add_ps(ax, _mm_mul_ps(dx, strength));
+            ay = _mm_add_ps(ay, _mm_mul_ps(dy, strength));
+            az = _mm_add_ps(az, _mm_mul_ps(dz, strength));
+        }
+        _mm_storeu_ps(g.ax + i, _mm_add_ps(_mm_loadu_ps(g.ax + i), ax));
+        _mm_storeu_ps(g.ay + i, _mm_add_ps(_mm_loadu_ps(g.ay + i), ay));
+        _mm_storeu_ps(g.az + i, _mm_add_ps(_mm_loadu_ps(g.az + i), az));
+    }
+}
+
+// 8 ciał naraz z FMA
+TARGET_AVX2 static void tileAVX2(const GravityArrays& g, size_t begin, size_t end, size_t tileBegin, size_t tileEnd) {
+    const __m256 half = _mm256_set1_ps(0.5f);
+    const __m256 threeHalves = _mm256_set1_ps(1.5f);
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 softening2 = _mm256_set1_ps(g.softening2);
+    for (size_t i = begin; i < end; i += 8) {
+        __m256 xi = _mm256_loadu_ps(g.targetX + i), yi = _mm256_loadu_ps(g.targetY + i), zi = _mm256_loadu_ps(g.targetZ + i);
+        __m256 ax = zero, ay = zero, az = zero;
+        for (size_t j = tileBegin; j < tileEnd; ++j) {
+            __m256 dx = _mm256_sub_ps(_mm256_broadcast_ss(g.x + j), xi);
+            __m256 dy = _mm256_sub_ps(_mm256_broadcast_ss(g.y + j), yi);
+            __m256 dz = _mm256_sub_ps(_mm256_broadcast_ss(g.z + j), zi);
+            __m256 r2 = _mm256_fmadd_ps(dx, dx, _mm256_fmadd_ps(dy, dy, _mm256_fmadd_ps(dz, dz, softening2)));
+            __m256 inv = _mm256_rsqrt_ps(r2);
+            inv = _mm256_mul_ps(inv, _mm256_fnmadd_ps(_mm256_mul_ps(half, r2), _mm256_mul_ps(inv, inv), threeHalves));
+            inv = _mm256_and_ps(inv, _mm256_cmp_ps(r2, zero, _CMP_GT_OQ));
+            __m256 strength = _mm256_mul_ps(_mm256_broadcast_ss(g.mass + j), _mm256_mul_ps(inv, _mm256_mul_ps(inv, inv)));
+            ax = _mm256_fmadd_ps(dx, strength, ax);
+            ay = _mm256_fmadd_ps(dy, strength, ay);
+            az = _mm256_fmadd_ps(dz, strength, az);
+        }
+        _mm256_storeu_ps(g.ax + i, _mm256_add_ps(_mm256_loadu_ps(g.ax + i), ax));
+        _mm256_storeu_ps(g.ay + i, _mm256_add_ps(_mm256_loadu_ps(g.ay + i), ay));
+        _mm256_storeu_ps(g.az + i, _mm256_add_ps(_mm256_loadu_ps(g.az + i), az));
+    }
+}
+#endif
+
+#ifdef SIMD_NEON
+// 4 ciała naraz; estymata vrsqrteq ma tylko 8 bitów, więc dwa kroki Newtona
+static void tileNEON(const GravityArrays& g, size_t begin, size_t end, size_t tileBegin, size_t tileEnd) {
+    const float32x4_t zero = vdupq_n_f32(0.0f);
+    const float32x4_t softening2 = vdupq_n_f32(g.softening2);
+    for (size_t i = begin; i < end; i += 4) {
+        float32x4_t xi = vld1q_f32(g.targetX + i), yi = vld1q_f32(g.targetY + i), zi = vld1q_f32(g.targetZ + i);
+        float32x4_t ax = zero, ay = zero, az = zero;
+        for (size_t j = tileBegin; j < tileEnd; ++j) {
+            float32x4_t dx = vsubq_f32(vdupq_n_f32(g.x[j]), xi);
+            float32x4_t dy = vsubq_f32(vdupq_n_f32(g.y[j]), yi);
+            float32x4_t dz = vsubq_f32(vdupq_n_f32(g.z[j]), zi);
+            float32x4_t r2 = vmlaq_f32(vmlaq_f32(vmlaq_f32(softening2, dz, dz), dy, dy), dx, dx);
+            float32x4_t inv = vrsqrteq_f32(r2);
+            inv = vmulq_f32(inv, vrsqrtsq_f32(vmulq_f32(r2, inv), inv));
+            inv = vmulq_f32(inv, vrsqrtsq_f32(vmulq_f32(r2, inv), inv));
+            inv = vreinterpretq_f32_u32(vandq_u32(vreinterpretq_u32_f32(inv), vcgtq_f32(r2, zero)));
+            float32x4_t strength = vmulq_n_f32(vmulq_f32(inv, vmulq_f32(inv, inv)), g.mass[j]);
+            ax = vmlaq_f32(ax, dx, strength);
+            ay = vmlaq_f32(ay, dy, strength);
+            az = vmlaq_f32(az, dz, strength);
+        }
+        vst1q_f32(g.ax + i, vaddq_f32(vld1q_f32(g.ax + i), ax));
+        vst1q_f32(g.ay + i, vaddq_f32(vld1q_f32(g.ay + i), ay));
+        vst1q_f32(g.az + i, vaddq_f32(vld1q_f32(g.az + i), az));
+    }
+}
+#endif
+
+// Kafel aktywnym wariantem, przyjmuje parametry: tablice, zakres ciał (wielokrotności 8) i kafel
+void gravityTile(const GravityArrays& g, size_t begin, size_t end, size_t tileBegin, size_t tileEnd) {
+    switch (orbitKernel()) {
+#ifdef SIMD_X86
+    case OrbitKernel::AVX2:
+        tileAVX2(g, begin, end, tileBegin, tileEnd);
+        return;
+    case OrbitKernel::SSE2:
+        tileSSE2(g, begin, end, tileBegin, tileEnd);
+        return;
+#endif
+#ifdef SIMD_NEON
+    case OrbitKernel::NEON:
+        tileNEON(g, begin, end, tileBegin, tileEnd);
+        return;
+#endif
+    default:
+        tileScalar(g, begin, end, tileBegin, tileEnd);
+    }
+}
+
+// Funkcja licząca przyspieszenia, przyjmuje parametry: pozycje, masy (GM), liczba ciał i tablice wyjściowe
+void DirectGravity::accelerations(const double* x, const double* y, const double* z, const double* bodyMass, size_t count,
+    double* ax, double* ay, double* az) {
+    accelerations(x, y, z, bodyMass, count, nullptr, count, ax, ay, az);
+}
+
+// Funkcja licząca przyspieszenia wybranych ciał, przyjmuje parametry: pozycje, masy (GM), liczba ciał,
+// indeksy ciał przyciąganych (nullptr - wszystkie), ich liczba i tablice wyjściowe
+void DirectGravity::accelerations(const double* x, const double* y, const double* z, const double* bodyMass, size_t count,
+    const int* targets, size_t targetCount, double* ax, double* ay, double* az) {
+    size_t padded = (count + 7) & ~(size_t)7;
+    positionX.assign(padded, 0.0f);
+    positionY.assign(padded, 0.0f);
+    positionZ.assign(padded, 0.0f);
+    mass.assign(padded, 0.0f);
+    for (size_t i = 0; i < count; ++i) {
+        positionX[i] = (float)x[i];
+        positionY[i] = (float)y[i];
+        positionZ[i] = (float)z[i];
+        mass[i] = (float)bodyMass[i];
+    }
+
+    // Ciała przyciągane: wszystkie (te same tablice) albo kopia wybranych
+    size_t paddedTargets = (targetCount + 7) & ~(size_t)7;
+    const float* tx = positionX.data();
+    const float* ty = positionY.data();
+    const float* tz = positionZ.data();
+    if (targets) {
+        targetX.assign(paddedTargets, 0.0f);
+        targetY.assign(paddedTargets, 0.0f);
+        targetZ.assign(paddedTargets, 0.0f);
+        for (size_t k = 0; k < targetCount; ++k) {
+            targetX[k] = positionX[targets[k]];
+            targetY[k] = positionY[targets[k]];
+            targetZ[k] = positionZ[targets[k]];
+        }
+        tx = targetX.data();
+        ty = targetY.data();
+        tz = targetZ.data();
+    }
+    accelerationX.assign(paddedTargets, 0.0f);
+    accelerationY.assign(paddedTargets, 0.0f);
+    accelerationZ.assign(paddedTargets, 0.0f);
+
+    GravityArrays g = { positionX.data(), positionY.data(), positionZ.data(), mass.data(), tx, ty, tz,
+        accelerationX.data(), accelerationY.data(), accelerationZ.data(), padded, paddedTargets, softening * softening };
+
+    // Wątki dzielą się ciałami przyciąganymi (bloki po 8), każdy przechodzi przez wszystkie kafle
+    parallelFor(paddedTargets / 8, 16, [&](size_t first, size_t last) {
+        for (size_t tileBegin = 0; tileBegin < padded; tileBegin += gravityTileSize) {
+            gravityTile(g, first * 8, last * 8, tileBegin, std::min(padded, tileBegin + gravityTileSize));
+        }
+    });
+
+    for (size_t k = 0; k < targetCount; ++k) {
+        size_t i = targets ? (size_t)targets[k] : k;
+        ax[i] = accelerationX[k];
+        ay[i] = accelerationY[k];
+        az[i] = accelerationZ[k];
+    }
+}
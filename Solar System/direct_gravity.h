@@ -0,0 +1,53 @@
+﻿#pragma once
+#include <cstddef>
+#include <vector>
+
+// Dokładna grawitacja O(N^2) dla kilku tysięcy ciał z masą. Ciała są dzielone na kafle mieszczące się
+// w pamięci podręcznej L1, każdy wątek liczy swój zakres ciał przyciąganych, po kilka naraz w rejestrach SIMD.
+// Wariant wektorowy (AVX2, SSE2, NEON, skalarny) jest ten sam co aktywne jądro orbit (orbitKernel())
+class DirectGravity {
+public:
+    float softening = 0.0f; // Wygładzenie potencjału; przy 0 pary w tym samym punkcie są pomijane
+
+    // Liczy przyspieszenia wszystkich ciał, przyjmuje parametry: pozycje, masy (GM), liczba ciał i tablice wyjściowe.
+    // Pary liczone są w pojedynczej precyzji (rsqrt z krokiem Newtona), błąd względny siły około 1e-6
+    void accelerations(const double* x, const double* y, const double* z, const double* mass, size_t count,
+        double* ax, double* ay, double* az);
+
+    // Jak wyżej, ale tylko dla wybranych ciał (przy krokach blokowych liczone są tylko ciała w końcu kroku);
+    // przyspieszenie ciała targets[k] trafia do ax[targets[k]], pozostałe elementy tablic wyjściowych się nie zmieniają
+    void accelerations(const double* x, const double* y, const double* z, const double* mass, size_t count,
+        const int* targets, size_t targetCount, double* ax, double* ay, double* az);
+
+private:
+    // Kopie w pojedynczej precyzji, długość zaokrąglona w górę do 8, dopełnienie ma masę 0
+    std::vector<float> positionX, positionY, positionZ, mass;
+    std::vector<float> targetX, targetY, targetZ;
+    std::vector<float> accelerationX, accelerationY, accelerationZ;
+};
+
+// Liczba par ciał na kafel: pozycje i masy kafla (16 bajtów na ciało) mieszczą się w 16 KB
+const size_t gravityTileSize = 1024;
+
+// Wejście i wyjście jąder: ciała przyciągające (x, y, z, mass) i przyciągane (targetX/Y/Z);
+// ax/ay/az są sumowane kafel po kaflu
+struct GravityArrays {
+    const float* x;
+    const float* y;
+    const float* z;
+    const float* mass;
+    const float* targetX;
+    const float* targetY;
+    const float* targetZ;
+    float* ax;
+    float* ay;
+    float* az;
+    size_t count;       // Ciała przyciągające
+    size_t targetCount; // Ciała przyciągane, wielokrotność 8
+    float softening2;
+};
+
+// Dodaje do ax/ay/az przyciąganie ciał tileBegin..tileEnd dla ciał przyciąganych begin..end aktywnym wariantem
+// jądra orbit; tablice ciał przyciąganych muszą mieć długość zaokrągloną w górę do 8. Używa go też drzewo
+// Barnes–Hut dla list oddziaływań. Przyjmuje parametry: tablice, zakres ciał przyciąganych (od wielokrotności 8) i kafel
+void gravityTile(const GravityArrays& g, size_t begin, size_t end, size_t tileBegin, size_t tileEnd);
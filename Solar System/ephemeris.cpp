@@ -0,0 +1,355 @@
+﻿#include "ephemeris.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include "orbit_kernel.h"
+#include "simd.h"
+
+static const double pi = 3.14159265358979323846;
+
+// Schemat Clenshawa dla osi x, y, z (i pustej czwartej) naraz: b_k = c_k + 2 tau b_k+1 - b_k+2,
+// wynik c_0 + tau b_1 - b_2. Przyjmuje parametry: współczynniki [k][4], ich liczba, tau w -1..1 i wyjście [4]
+typedef void (*ClenshawFunc)(const double* c, int n, double tau, double* out);
+
+static void clenshawScalar(const double* c, int n, double tau, double* out) {
+    double b1[4] = {}, b2[4] = {};
+    double twoTau = 2.0 * tau;
+    for (int k = n - 1; k >= 1; --k) {
+        for (int axis = 0; axis < 4; ++axis) {
+            double b = c[k * 4 + axis] + twoTau * b1[axis] - b2[axis];
+            b2[axis] = b1[axis];
+            b1[axis] = b;
+        }
+    }
+    for (int axis = 0; axis < 4; ++axis) {
+        out[axis] = c[axis] + tau * b1[axis] - b2[axis];
+    }
+}
+
+#ifdef SIMD_X86
+static void clenshawSSE2(const double* c, int n, double tau, double* out) {
+    const __m128d twoTau = _mm_set1_pd(2.0 * tau);
+    __m128d b1xy = _mm_setzero_pd(), b1z = _mm_setzero_pd(), b2xy = _mm_setzero_pd(), b2z = _mm_setzero_pd();
+    for (int k = n - 1; k >= 1; --k) {
+        __m128d bxy = _mm_sub_pd(_mm_add_pd(_mm_loadu_pd(c + k * 4), _mm_mul_pd(twoTau, b1xy)), b2xy);
+        __m128d bz = _mm_sub_pd(_mm_add_pd(_mm_loadu_pd(c + k * 4 + 2), _mm_mul_pd(twoTau, b1z)), b2z);
+        b2xy = b1xy;
+        b2z = b1z;
+        b1xy = bxy;
+        b1z = bz;
+    }
+    const __m128d t = _mm_set1_pd(tau);
+    _mm_storeu_pd(out, _mm_sub_pd(_mm_add_pd(_mm_loadu_pd(c), _mm_mul_pd(t, b1xy)), b2xy));
+    _mm_storeu_pd(out + 2, _mm_sub_pd(_mm_add_pd(_mm_loadu_pd(c + 2), _mm_mul_pd(t, b1z)), b2z));
+}
+
+TARGET_AVX2 static void clenshawAVX2(const double* c, int n, double tau, double* out) {
+    const __m256d twoTau = _mm256_set1_pd(2.0 * tau);
+    __m256d b1 = _mm256_setzero_pd(), b2 = _mm256_setzero_pd();
+    for (int k = n - 1; k >= 1; --k) {
+        __m256d b = _mm256_sub_pd(_mm256_fmadd_pd(twoTau, b1, _mm256_loadu_pd(c + k * 4)), b2);
+        b2 = b1;
+        b1 = b;
+    }
+    _mm256_storeu_pd(out, _mm256_sub_pd(_mm256_fmadd_pd(_mm256_set1_pd(tau), b1, _mm256_loadu_pd(c)), b2));
+}
+#endif
+
+#ifdef SIMD_NEON
+static void clenshawNEON(const double* c, int n, double tau, double* out) {
+    const float64x2_t twoTau = vdupq_n_f64(2.0 * tau);
+    float64x2_t b1xy = vdupq_n_f64(0.0), b1z = vdupq_n_f64(0.0), b2xy = vdupq_n_f64(0.0), b2z = vdupq_n_f64(0.0);
+    for (int k = n - 1; k >= 1; --k) {
+        float64x2_t bxy = vsubq_f64(vfmaq_f64(vld1q_f64(c + k * 4), twoTau, b1xy), b2xy);
+        float64x2_t bz = vsubq_f64(vfmaq_f64(vld1q_f64(c + k * 4 + 2), twoTau, b1z), b2z);
+        b2xy = b1xy;
+        b2z = b1z;
+        b1xy = bxy;
+        b1z = bz;
+    }
+    vst1q_f64(out, vsubq_f64(vfmaq_n_f64(vld1q_f64(c), b1xy, tau), b2xy));
+    vst1q_f64(out + 2, vsubq_f64(vfmaq_n_f64(vld1q_f64(c + 2), b1z, tau), b2z));
+}
+#endif
+
+// Wariant schematu Clenshawa zgodny z aktywnym jądrem orbit
+static ClenshawFunc clenshawKernel() {
+    switch (orbitKernel()) {
+#ifdef SIMD_X86
+    case OrbitKernel::AVX2:
+        return clenshawAVX2;
+    case OrbitKernel::SSE2:
+        return clenshawSSE2;
+#endif
+#ifdef SIMD_NEON
+    case OrbitKernel::NEON:
+        return clenshawNEON;
+#endif
+    default:
+        return clenshawScalar;
+    }
+}
+
+// Pozycja na elipsie względem rodzica w podwójnej precyzji, z równaniem Keplera rozwiązanym do zbieżności,
+// przyjmuje parametry: magazyn, indeks ciała, czas i wyjście xyz
+static void keplerPosition(const BodyStore& bodies, size_t i, double time, double* out) {
+    double e = bodies.eccentricity[i];
+    double M = std::remainder(bodies.epochAnomaly[i] + bodies.meanMotion[i] * time, 2.0 * pi);
+    double E = M + e * std::sin(M);
+    for (int k = 0; k < 50; ++k) {
+        double delta = (E - e * std::sin(E) - M) / (1.0 - e * std::cos(E));
+        E -= delta;
+        if (std::fabs(delta) < 1e-15)
+            break;
+    }
+    double c = std::cos(E) - e, s = std::sin(E);
+    out[0] = c * bodies.periapsisX[i] + s * bodies.minorAxisX[i];
+    out[1] = c * bodies.periapsisY[i] + s * bodies.minorAxisY[i];
+    out[2] = c * bodies.periapsisZ[i] + s * bodies.minorAxisZ[i];
+}
+
+// Funkcja otwierająca efemerydy, przyjmuje parametry: ścieżka do pliku .eph i liczba ciał magazynu
+bool Ephemeris::open(const char* path, size_t storeSize) {
+    header = nullptr;
+    if (!file.open(path))
+        return false;
+
+    const EphemerisHeader* candidate = (const EphemerisHeader*)file.data();
+    bool valid = file.size() >= sizeof(EphemerisHeader) && memcmp(candidate->magic, "SSEP", 4) == 0
+        && candidate->version == 1 && candidate->storeSize == storeSize
+        && candidate->recordCount > 0 && candidate->recordLength > 0.0 && candidate->recordOffset % 8 == 0
+        && candidate->recordOffset >= sizeof(EphemerisHeader) + (uint64_t)candidate->bodyCount * sizeof(EphemerisBody)
+        && candidate->recordOffset + (uint64_t)candidate->recordCount * candidate->recordDoubles * sizeof(double) <= file.size();
+    if (valid) {
+        // Wpisy ciał muszą mieścić się w rekordzie i w buforze segmentów
+        const EphemerisBody* candidateEntries = (const EphemerisBody*)(file.data() + sizeof(EphemerisHeader));
+        for (uint32_t i = 0; i < candidate->bodyCount && valid; ++i) {
+            const EphemerisBody& entry = candidateEntries[i];
+            valid = entry.body < storeSize && entry.coefficientCount >= 1
+                && entry.coefficientCount <= (uint32_t)maxChebyshevCoefficients && entry.subintervals >= 1
+                && entry.offset + (uint64_t)entry.subintervals * 3 * entry.coefficientCount <= candidate->recordDoubles;
+        }
+    }
+    if (!valid) {
+        std::cout << "Invalid ephemeris: " << path << std::endl;
+        file.close();
+        return false;
+    }
+
+    header = candidate;
+    entries = (const EphemerisBody*)(file.data() + sizeof(EphemerisHeader));
+    records = (const double*)(file.data() + header->recordOffset);
+    return true;
+}
+
+bool Ephemeris::covers(double time) const {
+    return header && time >= startTime() && time <= endTime();
+}
+
+void Ephemeris::loadSegment(const EphemerisBody& entry, size_t slot, long long record, long long subinterval,
+    EphemerisCache& cache) const {
+    const double* source = records + (size_t)record * header->recordDoubles + entry.offset
+        + (size_t)subinterval * 3 * entry.coefficientCount;
+    double* target = &cache.coefficients[slot * 4 * maxChebyshevCoefficients];
+    for (uint32_t k = 0; k < entry.coefficientCount; ++k) {
+        target[k * 4 + 0] = source[k];
+        target[k * 4 + 1] = source[entry.coefficientCount + k];
+        target[k * 4 + 2] = source[2 * entry.coefficientCount + k];
+        target[k * 4 + 3] = 0.0;
+    }
+
+    double length = header->recordLength / entry.subintervals;
+    cache.segment[slot] = record * entry.subintervals + subinterval;
+    cache.segmentStart[slot] = header->startTime + header->recordLength * (double)record + length * (double)subinterval;
+    cache.segmentScale[slot] = 2.0 / length;
+}
+
+// Funkcja licząca pozycje z efemeryd, przyjmuje parametry: czas, bufor segmentów i wyjścia pozycji względem rodziców
+bool Ephemeris::evaluate(double time, EphemerisCache& cache, float* x, float* y, float* z) const {
+    if (!covers(time))
+        return false;
+
+    size_t count = header->bodyCount;
+    if (cache.segment.size() != count) {
+        cache.segment.assign(count, -1);
+        cache.segmentStart.assign(count, 0.0);
+        cache.segmentScale.assign(count, 0.0);
+        cache.coefficients.assign(count * 4 * maxChebyshevCoefficients, 0.0);
+    }
+
+    // Wszystkie ciała leżą w tym samym rekordzie, różnią się tylko podziałem na podprzedziały
+    double position = (time - header->startTime) / header->recordLength;
+    long long record = std::min((long long)position, (long long)header->recordCount - 1);
+    double phase = position - (double)record;
+
+    ClenshawFunc clenshaw = clenshawKernel();
+    double result[4];
+    for (size_t i = 0; i < count; ++i) {
+        const EphemerisBody& entry = entries[i];
+        long long subinterval = std::min((long long)(phase * entry.subintervals), (long long)entry.subintervals - 1);
+        if (cache.segment[i] != record * entry.subintervals + subinterval) {
+            loadSegment(entry, i, record, subinterval, cache);
+            ++cache.misses;
+        }
+        else {
+            ++cache.hits;
+        }
+
+        double tau = std::clamp((time - cache.segmentStart[i]) * cache.segmentScale[i] - 1.0, -1.0, 1.0);
+        clenshaw(&cache.coefficients[i * 4 * maxChebyshevCoefficients], (int)entry.coefficientCount, tau, result);
+        x[entry.body] = (float)result[0];
+        y[entry.body] = (float)result[1];
+        z[entry.body] = (float)result[2];
+    }
+    return true;
+}
+
+// Funkcja budująca plik efemeryd, przyjmuje parametry: magazyn, ścieżka, początek i długość zakresu,
+// długość rekordu i liczba współczynników na oś
+bool buildEphemeris(const BodyStore& bodies, const char* path, double startTime, double duration,
+    double recordLength, int coefficientCount) {
+    if (duration <= 0.0 || recordLength <= 0.0 || coefficientCount < 2 || coefficientCount > maxChebyshevCoefficients) {
+        std::cout << "Invalid ephemeris parameters" << std::endl;
+        return false;
+    }
+
+    // Co najmniej 4 podprzedziały na obieg: 12 współczynników daje wtedy błąd poniżej precyzji float
+    std::vector<EphemerisBody> entries;
+    uint32_t recordDoubles = 0;
+    for (size_t i = 0; i < bodies.size(); ++i) {
+        if (bodies.parent[i] < 0)
+            continue;
+        double motion = std::fabs(bodies.meanMotion[i]);
+        double subintervals = motion > 0.0 ? std::ceil(recordLength * 4.0 * motion / (2.0 * pi)) : 1.0;
+        EphemerisBody entry = { (uint32_t)i, recordDoubles, (uint32_t)coefficientCount, (uint32_t)std::max(1.0, subintervals) };
+        entries.push_back(entry);
+        recordDoubles += entry.subintervals * 3 * entry.coefficientCount;
+    }
+
+    EphemerisHeader header = {};
+    memcpy(header.magic, "SSEP", 4);
+    header.version = 1;
+    header.bodyCount = (uint32_t)entries.size();
+    header.recordCount = (uint32_t)std::ceil(duration / recordLength);
+    header.startTime = startTime;
+    header.recordLength = recordLength;
+    header.recordOffset = (sizeof(EphemerisHeader) + entries.size() * sizeof(EphemerisBody) + 7) / 8 * 8;
+    header.recordDoubles = recordDoubles;
+    header.storeSize = (uint32_t)bodies.size();
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        std::cout << "Failed to create ephemeris: " << path << std::endl;
+        return false;
+    }
+    file.write((const char*)&header, sizeof(header));
+    file.write((const char*)entries.data(), entries.size() * sizeof(EphemerisBody));
+    const char padding[8] = {};
+    file.write(padding, header.recordOffset - sizeof(header) - entries.size() * sizeof(EphemerisBody));
+
+    // Węzły Czebyszewa tau_j = cos(pi (j + 0.5) / N) i tablica cos(pi k (j + 0.5) / N) dla transformaty
+    int n = coefficientCount;
+    std::vector<double> basis((size_t)n * n);
+    for (int k = 0; k < n; ++k) {
+        for (int j = 0; j < n; ++j) {
+            basis[k * n + j] = std::cos(pi * k * (j + 0.5) / n);
+        }
+    }
+
+    std::vector<double> record(recordDoubles);
+    std::vector<double> samples((size_t)n * 3);
+    for (uint32_t r = 0; r < header.recordCount; ++r) {
+        double recordStart = startTime + recordLength * r;
+        for (const EphemerisBody& entry : entries) {
+            double length = recordLength / entry.subintervals;
+            for (uint32_t s = 0; s < entry.subintervals; ++s) {
+                double segmentStart = recordStart + length * s;
+                for (int j = 0; j < n; ++j) {
+                    double tau = basis[n + j];
+                    keplerPosition(bodies, entry.body, segmentStart + 0.5 * (tau + 1.0) * length, &samples[j * 3]);
+                }
+
+                double* target = &record[entry.offset + (size_t)s * 3 * n];
+                for (int axis = 0; axis < 3; ++axis) {
+                    for (int k = 0; k < n; ++k) {
+                        double sum = 0.0;
+                        for (int j = 0; j < n; ++j) {
+                            sum += samples[j * 3 + axis] * basis[k * n + j];
+                        }
+                        target[axis * n + k] = (k == 0 ? 1.0 : 2.0) * sum / n;
+                    }
+                }
+            }
+        }
+        file.write((const char*)record.data(), record.size() * sizeof(double));
+    }
+
+    if (!file) {
+        std::cout << "Failed to write ephemeris: " << path << std::endl;
+        return false;
+    }
+    std::cout << "Ephemeris: " << entries.size() << " bodies, " << header.recordCount << " records of "
+        << recordLength << " s, " << (header.recordOffset + (double)header.recordCount * recordDoubles * sizeof(double)) / (1024.0 * 1024.0)
+        << " MB written to " << path << std::endl;
+    return true;
+}
+
+// Funkcja porównująca efemerydy z orbitami keplerowskimi, przyjmuje parametry: magazyn i efemerydy
+void benchmarkEphemeris(const BodyStore& bodies, const Ephemeris& ephemeris) {
+    size_t count = bodies.size();
+    std::vector<float> x(count), y(count), z(count), meanAnomaly(count);
+    std::mt19937 random(7);
+    std::uniform_real_distribution<double> moment(ephemeris.startTime(), ephemeris.endTime());
+
+    // Błąd względem dokładnego rozwiązania w losowych chwilach
+    double maxError = 0.0;
+    EphemerisCache cache;
+    for (int sample = 0; sample < 10000; ++sample) {
+        double time = moment(random);
+        ephemeris.evaluate(time, cache, x.data(), y.data(), z.data());
+        for (size_t i = 0; i < ephemeris.bodyCount(); ++i) {
+            size_t body = ephemeris.body(i).body;
+            double exact[3];
+            keplerPosition(bodies, body, time, exact);
+            double dx = x[body] - exact[0], dy = y[body] - exact[1], dz = z[body] - exact[2];
+            maxError = std::max(maxError, std::sqrt(dx * dx + dy * dy + dz * dz));
+        }
+    }
+
+    // Czas: kolejne klatki (prawie same trafienia w bufor), losowe skoki i jądro orbit dla tych samych ciał
+    const int frames = 20000;
+    double start = ephemeris.startTime();
+    double span = ephemeris.endTime() - start;
+    cache = EphemerisCache();
+    auto begin = std::chrono::steady_clock::now();
+    for (int frame = 0; frame < frames; ++frame) {
+        ephemeris.evaluate(start + std::fmod(frame / 60.0, span), cache, x.data(), y.data(), z.data());
+    }
+    double sequential = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - begin).count();
+    double hitRate = (double)cache.hits / (cache.hits + cache.misses);
+
+    begin = std::chrono::steady_clock::now();
+    for (int frame = 0; frame < frames; ++frame) {
+        ephemeris.evaluate(moment(random), cache, x.data(), y.data(), z.data());
+    }
+    double seeking = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - begin).count();
+
+    OrbitArrays orbits = { bodies.epochAnomaly.data(), bodies.meanMotion.data(), bodies.eccentricity.data(),
+        bodies.periapsisX.data(), bodies.periapsisY.data(), bodies.periapsisZ.data(),
+        bodies.minorAxisX.data(), bodies.minorAxisY.data(), bodies.minorAxisZ.data(),
+        meanAnomaly.data(), x.data(), y.data(), z.data(), count };
+    begin = std::chrono::steady_clock::now();
+    for (int frame = 0; frame < frames; ++frame) {
+        evaluateOrbits(orbits, start + frame / 60.0);
+    }
+    double kepler = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - begin).count();
+
+    double perBody = (double)frames * ephemeris.bodyCount();
+    std::cout << "Ephemeris " << orbitKernelName(orbitKernel()) << ": max position error " << maxError
+        << ", sequential " << sequential / perBody << " ns/body (" << hitRate * 100.0 << "% segment hits), random seek "
+        << seeking / perBody << " ns/body, Kepler kernel " << kepler / ((double)frames * count) << " ns/body" << std::endl;
+}
@@ -0,0 +1,81 @@
+﻿#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "body_store.h"
+#include "mapped_file.h"
+
+// Nagłówek pliku efemeryd (.eph) w układzie plików JPL DE: rekordy o stałej długości, każdy obejmuje
+// ten sam odcinek czasu dla wszystkich ciał i zawiera współczynniki wielomianów Czebyszewa
+struct EphemerisHeader {
+    char magic[4];          // "SSEP"
+    uint32_t version;
+    uint32_t bodyCount;     // Liczba wpisów EphemerisBody zaraz po nagłówku
+    uint32_t recordCount;
+    double startTime;       // Czas symulacji początku pierwszego rekordu, w sekundach
+    double recordLength;    // Odcinek czasu jednego rekordu
+    uint64_t recordOffset;  // Przesunięcie pierwszego rekordu w pliku, wielokrotność 8
+    uint32_t recordDoubles; // Długość rekordu w liczbach double
+    uint32_t storeSize;     // Liczba ciał magazynu, dla którego zbudowano plik
+};
+
+// Wpis ciała: gdzie w każdym rekordzie leżą jego współczynniki. Podprzedział zawiera kolejno
+// coefficientCount współczynników osi x, y i z pozycji względem rodzica
+struct EphemerisBody {
+    uint32_t body;             // Indeks ciała w magazynie posortowanym po rodzicu
+    uint32_t offset;           // Przesunięcie pierwszego współczynnika w rekordzie, w liczbach double
+    uint32_t coefficientCount; // Współczynniki na oś w jednym podprzedziale
+    uint32_t subintervals;     // Podprzedziały rekordu, szybkie ciała (księżyce) mają ich więcej
+};
+
+// Największa liczba współczynników na oś, jaką przyjmuje bufor segmentów
+const int maxChebyshevCoefficients = 32;
+
+// Bufor segmentów jednej symulacji: współczynniki bieżącego podprzedziału każdego ciała przestawione
+// do układu [współczynnik][x, y, z, 0], w którym jeden rejestr wektorowy liczy wszystkie trzy osie naraz.
+// Przestawienie odbywa się raz na podprzedział, kolejne chwile w nim kosztują tylko schemat Clenshawa
+struct EphemerisCache {
+    std::vector<long long> segment;    // Numer bieżącego podprzedziału ciała, -1 gdy pusty
+    std::vector<double> segmentStart;  // Początek podprzedziału w czasie symulacji
+    std::vector<double> segmentScale;  // 2 / długość podprzedziału
+    std::vector<double> coefficients;  // 4 * maxChebyshevCoefficients liczb na ciało
+    size_t hits = 0;
+    size_t misses = 0;
+};
+
+// Efemerydy z pliku zmapowanego w pamięci, pozycje ciał jako funkcja czasu w zakresie pliku
+class Ephemeris {
+public:
+    // Otwiera plik .eph, zwraca false, gdy go nie ma albo nie pasuje do magazynu,
+    // przyjmuje parametry: ścieżka i liczba ciał magazynu
+    bool open(const char* path, size_t storeSize);
+
+    bool covers(double time) const;
+    double startTime() const { return header->startTime; }
+    double endTime() const { return header->startTime + header->recordLength * header->recordCount; }
+    size_t bodyCount() const { return header ? header->bodyCount : 0; }
+    const EphemerisBody& body(size_t i) const { return entries[i]; }
+
+    // Wpisuje pozycje ciał z efemeryd względem rodziców w chwili time (tablice indeksowane jak magazyn),
+    // pozostałych ciał nie zmienia. Zwraca false poza zakresem pliku, przyjmuje parametry: czas, bufor segmentów i wyjścia
+    bool evaluate(double time, EphemerisCache& cache, float* x, float* y, float* z) const;
+
+private:
+    // Wczytuje do bufora podprzedział ciała, przyjmuje parametry: wpis ciała, jego pozycja w buforze, rekord i podprzedział
+    void loadSegment(const EphemerisBody& entry, size_t slot, long long record, long long subinterval, EphemerisCache& cache) const;
+
+    MappedFile file;
+    const EphemerisHeader* header = nullptr;
+    const EphemerisBody* entries = nullptr;
+    const double* records = nullptr;
+};
+
+// Buduje plik efemeryd z orbit keplerowskich magazynu: współczynniki z wartości w węzłach Czebyszewa,
+// liczba podprzedziałów dobrana do okresu ciała. Przyjmuje parametry: magazyn, ścieżka, początek i długość
+// zakresu, długość rekordu w sekundach i liczba współczynników na oś
+bool buildEphemeris(const BodyStore& bodies, const char* path, double startTime, double duration,
+    double recordLength = 32.0, int coefficientCount = 12);
+
+// Porównuje efemerydy z orbitami keplerowskimi magazynu: błąd pozycji i czas liczenia wszystkich ciał
+// względem evaluateOrbits, przyjmuje parametry: magazyn i efemerydy
+void benchmarkEphemeris(const BodyStore& bodies, const Ephemeris& ephemeris);
@@ -0,0 +1,344 @@
+﻿#include "event_finder.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <mutex>
+#include "parallel.h"
+#include "simulation.h"
+
+static const double radiansToDegrees = 180.0 / 3.14159265358979323846;
+static const double goldenRatio = 0.61803398874989484820; // (sqrt(5) - 1) / 2
+
+// Para ciał śledzona z jednego obserwatora
+struct TrackedPair {
+    int observer;
+    int a, b;
+    bool conjunction; // Oba ciała z masą, szukamy też koniunkcji
+};
+
+// Znacznik z próbkowania: wejście tarcz w kontakt, wyjście albo minimum koniunkcji
+struct EventMark {
+    enum Kind { Enter, Exit, Conjunction };
+    size_t pair;
+    double time;
+    Kind kind;
+    bool clipped; // Wejście na początku okna, bez znanego zetknięcia
+};
+
+// Zjawisko złożone ze znaczników, przed policzeniem chwili peak i geometrii
+struct RawEvent {
+    size_t pair;
+    double begin, end;
+    bool conjunction;
+    bool clipped;
+};
+
+// Kierunki do ciał z jednego obserwatora: wektory względne, odległości i promienie kątowe
+struct ObserverView {
+    std::vector<double> x, y, z, distance, angularRadius;
+
+    // Przelicza widok dla bieżących pozycji, przyjmuje parametry: ciała i indeks obserwatora
+    void update(const BodyStore& bodies, int observer) {
+        size_t count = bodies.size();
+        x.resize(count);
+        y.resize(count);
+        z.resize(count);
+        distance.resize(count);
+        angularRadius.resize(count);
+        double ox = bodies.positionX[observer], oy = bodies.positionY[observer], oz = bodies.positionZ[observer];
+        for (size_t i = 0; i < count; ++i) {
+            x[i] = bodies.positionX[i] - ox;
+            y[i] = bodies.positionY[i] - oy;
+            z[i] = bodies.positionZ[i] - oz;
+            distance[i] = std::sqrt(x[i] * x[i] + y[i] * y[i] + z[i] * z[i]);
+            angularRadius[i] = distance[i] > bodies.radius[i] ? std::asin(bodies.radius[i] / distance[i]) : 1.5707963267948966;
+        }
+    }
+
+    // Odległość kątowa środków dwóch ciał w radianach
+    double separation(int a, int b) const {
+        double cosine = (x[a] * x[b] + y[a] * y[b] + z[a] * z[b]) / (distance[a] * distance[b]);
+        return std::acos(std::max(-1.0, std::min(1.0, cosine)));
+    }
+
+    // Odstęp tarcz: ujemny, gdy tarcze na siebie nachodzą
+    double gap(int a, int b) const { return separation(a, b) - angularRadius[a] - angularRadius[b]; }
+};
+
+// Scena ustawiana na dowolną chwilę; każdy kawałek pracy ma własną kopię. Ciała całkowane wracają na elipsy,
+// bo stan trybu grawitacyjnego nie jest funkcją czasu
+class SceneEvaluator {
+public:
+    SceneEvaluator(const BodyStore& bodies, const std::shared_ptr<const Ephemeris>& ephemeris) : simulation(kinematic(bodies)) {
+        if (ephemeris)
+            simulation.setEphemeris(ephemeris);
+    }
+
+    // Ustawia scenę na chwilę t i przelicza widok obserwatora, przyjmuje parametry: czas i obserwator
+    const ObserverView& view(double t, int observer) {
+        if (t != time) {
+            simulation.setTime(t);
+            time = t;
+            viewObserver = -1;
+            ++evaluations;
+        }
+        if (observer != viewObserver) {
+            observerView.update(simulation.bodies(), observer);
+            viewObserver = observer;
+        }
+        return observerView;
+    }
+
+    double gap(double t, const TrackedPair& pair) { return view(t, pair.observer).gap(pair.a, pair.b); }
+
+    size_t evaluations = 0;
+
+private:
+    static BodyStore kinematic(const BodyStore& bodies) {
+        BodyStore copy = bodies;
+        std::fill(copy.worldSpace.begin(), copy.worldSpace.end(), (unsigned char)0);
+        return copy;
+    }
+
+    Simulation simulation;
+    ObserverView observerView;
+    double time = std::nan("");
+    int viewObserver = -1;
+};
+
+// Bisekcja zmiany znaku odstępu tarcz, przyjmuje parametry: scena, para, przedział (znaki na końcach różne) i dokładność
+static double refineContact(SceneEvaluator& scene, const TrackedPair& pair, double low, double high, double tolerance) {
+    bool lowInside = scene.gap(low, pair) < 0.0;
+    while (high - low > tolerance) {
+        double middle = 0.5 * (low + high);
+        if ((scene.gap(middle, pair) < 0.0) == lowInside)
+            low = middle;
+        else
+            high = middle;
+    }
+    return 0.5 * (low + high);
+}
+
+// Minimum odstępu tarcz metodą złotego podziału, przyjmuje parametry: scena, para, przedział i dokładność
+static double refineMinimum(SceneEvaluator& scene, const TrackedPair& pair, double low, double high, double tolerance) {
+    double left = high - goldenRatio * (high - low);
+    double right = low + goldenRatio * (high - low);
+    double leftValue = scene.gap(left, pair);
+    double rightValue = scene.gap(right, pair);
+    while (high - low > tolerance) {
+        if (leftValue < rightValue) {
+            high = right;
+            right = left;
+            rightValue = leftValue;
+            left = high - goldenRatio * (high - low);
+            leftValue = scene.gap(left, pair);
+        }
+        else {
+            low = left;
+            left = right;
+            leftValue = rightValue;
+            right = low + goldenRatio * (high - low);
+            rightValue = scene.gap(right, pair);
+        }
+    }
+    return 0.5 * (low + high);
+}
+
+// Funkcja szukająca zjawisk, przyjmuje parametry: ciała, efemerydy, okno, ustawienia i statystyki
+std::vector<SkyEvent> findSkyEvents(const BodyStore& bodies, std::shared_ptr<const Ephemeris> ephemeris,
+    double begin, double end, const EventSearchSettings& settings, EventSearchStats* stats) {
+    auto start = std::chrono::steady_clock::now();
+    std::vector<SkyEvent> events;
+    if (!(end > begin) || !(settings.step > 0.0))
+        return events;
+
+    // Pary ciał z promieniem z każdego obserwatora; koniunkcje tylko dla ciał z masą (Słońce i planety)
+    double conjunctionAngle = settings.conjunctionAngle / radiansToDegrees;
+    std::vector<TrackedPair> pairs;
+    for (int observer : settings.observers) {
+        for (int a = 0; a < (int)bodies.size(); ++a) {
+            for (int b = a + 1; b < (int)bodies.size(); ++b) {
+                if (a == observer || b == observer || bodies.radius[a] <= 0.0f || bodies.radius[b] <= 0.0f)
+                    continue;
+                bool conjunction = conjunctionAngle > 0.0 && observer != settings.lightSource
+                    && bodies.mass[a] > 0.0f && bodies.mass[b] > 0.0f;
+                pairs.push_back({ observer, a, b, conjunction });
+            }
+        }
+    }
+
+    // Próbki co step, ostatnia dokładnie na końcu okna
+    size_t sampleCount = (size_t)std::ceil((end - begin) / settings.step) + 1;
+    auto sampleTime = [&](size_t i) { return i + 1 == sampleCount ? end : begin + (double)i * settings.step; };
+
+    // Kawałki okna równolegle; kawałek ocenia też próbkę przed sobą i po sobie, żeby złapać zmiany znaku
+    // i minima na granicach. Przedział między próbkami i oraz i + 1 i minimum w i należą do kawałka z próbką i
+    std::vector<EventMark> marks;
+    std::mutex mutex;
+    std::atomic<size_t> evaluations(0);
+    parallelFor(sampleCount, 1024, [&](size_t first, size_t last) {
+        SceneEvaluator scene(bodies, ephemeris);
+        std::vector<EventMark> found;
+        size_t pairCount = pairs.size();
+        // Odstępy tarcz w trzech kolejnych próbkach: i - 1, i, i + 1
+        std::vector<double> gaps[3];
+        for (int k = 0; k < 3; ++k) {
+            gaps[k].resize(pairCount);
+        }
+        size_t from = first > 0 ? first - 1 : 0;
+        size_t to = std::min(last, sampleCount - 1);
+        for (size_t k = from; k <= to; ++k) {
+            std::vector<double>& gap = gaps[k % 3];
+            double t = sampleTime(k);
+            for (size_t p = 0; p < pairCount; ++p) {
+                const ObserverView& view = scene.view(t, pairs[p].observer);
+                gap[p] = view.gap(pairs[p].a, pairs[p].b);
+                if (k == 0 && first == 0 && gap[p] < 0.0)
+                    found.push_back({ p, begin, EventMark::Enter, true });
+            }
+            if (k == from)
+                continue;
+
+            // Zmiana znaku między k - 1 i k
+            size_t i = k - 1;
+            if (i >= first) {
+                const std::vector<double>& previous = gaps[i % 3];
+                for (size_t p = 0; p < pairCount; ++p) {
+                    bool wasInside = previous[p] < 0.0, inside = gap[p] < 0.0;
+                    if (wasInside == inside)
+                        continue;
+                    double contact = refineContact(scene, pairs[p], sampleTime(i), t, settings.tolerance);
+                    found.push_back({ p, contact, inside ? EventMark::Enter : EventMark::Exit, false });
+                }
+            }
+
+            // Minimum w próbce k - 1 przy wszystkich trzech próbkach rozłącznych: odstęp może spaść poniżej zera
+            // albo poniżej progu koniunkcji tylko, jeśli pozwala na to nachylenie z sąsiednich próbek
+            if (i < first || i == 0)
+                continue;
+            const std::vector<double>& before = gaps[(i - 1) % 3];
+            const std::vector<double>& middle = gaps[i % 3];
+            for (size_t p = 0; p < pairCount; ++p) {
+                if (!(before[p] > middle[p] && middle[p] <= gap[p]) || middle[p] < 0.0 || gap[p] < 0.0)
+                    continue;
+                double slope = std::max(before[p] - middle[p], gap[p] - middle[p]);
+                bool mayTouch = middle[p] - slope < 0.0;
+                bool mayConjoin = pairs[p].conjunction && middle[p] - slope < conjunctionAngle;
+                if (!mayTouch && !mayConjoin)
+                    continue;
+                double low = sampleTime(i - 1), high = t;
+                double peak = refineMinimum(scene, pairs[p], low, high, settings.tolerance);
+                double closest = scene.gap(peak, pairs[p]);
+                if (closest < 0.0) {
+                    found.push_back({ p, refineContact(scene, pairs[p], low, peak, settings.tolerance), EventMark::Enter, false });
+                    found.push_back({ p, refineContact(scene, pairs[p], peak, high, settings.tolerance), EventMark::Exit, false });
+                }
+                else if (pairs[p].conjunction && closest < conjunctionAngle) {
+                    found.push_back({ p, peak, EventMark::Conjunction, false });
+                }
+            }
+        }
+        evaluations += scene.evaluations;
+        std::lock_guard<std::mutex> lock(mutex);
+        marks.insert(marks.end(), found.begin(), found.end());
+    });
+
+    // Znaczniki każdej pary po czasie składają się w zjawiska; niezamknięte na końcu okna są przycięte
+    std::sort(marks.begin(), marks.end(), [](const EventMark& a, const EventMark& b) {
+        return a.pair != b.pair ? a.pair < b.pair : a.time != b.time ? a.time < b.time : a.kind < b.kind;
+    });
+    std::vector<RawEvent> raw;
+    for (size_t m = 0; m < marks.size();) {
+        size_t pair = marks[m].pair;
+        bool open = false;
+        RawEvent current = { pair, begin, end, false, false };
+        for (; m < marks.size() && marks[m].pair == pair; ++m) {
+            const EventMark& mark = marks[m];
+            if (mark.kind == EventMark::Conjunction) {
+                raw.push_back({ pair, mark.time, mark.time, true, false });
+            }
+            else if (mark.kind == EventMark::Enter) {
+                open = true;
+                current.begin = mark.time;
+                current.clipped = mark.clipped;
+            }
+            else {
+                if (!open) {
+                    current.begin = begin;
+                    current.clipped = true;
+                }
+                current.end = mark.time;
+                raw.push_back(current);
+                open = false;
+                current.clipped = false;
+            }
+        }
+        if (open) {
+            current.end = end;
+            current.clipped = true;
+            raw.push_back(current);
+        }
+    }
+
+    // Chwila największego zbliżenia i geometria zjawisk
+    events.resize(raw.size());
+    parallelFor(raw.size(), 64, [&](size_t first, size_t last) {
+        SceneEvaluator scene(bodies, ephemeris);
+        for (size_t e = first; e < last; ++e) {
+            const RawEvent& r = raw[e];
+            const TrackedPair& pair = pairs[r.pair];
+            double peak = r.conjunction ? r.begin : refineMinimum(scene, pair, r.begin, r.end, settings.tolerance);
+            const ObserverView& view = scene.view(peak, pair.observer);
+            bool aFront = view.distance[pair.a] < view.distance[pair.b];
+            SkyEvent& event = events[e];
+            event.observer = pair.observer;
+            event.front = aFront ? pair.a : pair.b;
+            event.back = aFront ? pair.b : pair.a;
+            event.begin = r.begin;
+            event.peak = peak;
+            event.end = r.end;
+            event.separation = (float)(view.separation(pair.a, pair.b) * radiansToDegrees);
+            event.frontRadius = (float)(view.angularRadius[event.front] * radiansToDegrees);
+            event.backRadius = (float)(view.angularRadius[event.back] * radiansToDegrees);
+            event.central = !r.conjunction && event.separation <= std::fabs(event.frontRadius - event.backRadius);
+            event.clipped = r.clipped;
+            if (r.conjunction)
+                event.type = SkyEventType::Conjunction;
+            else if (pair.observer == settings.lightSource)
+                event.type = SkyEventType::Shadow;
+            else if (event.back == settings.lightSource)
+                event.type = SkyEventType::Eclipse;
+            else
+                event.type = event.frontRadius < event.backRadius ? SkyEventType::Transit : SkyEventType::Occultation;
+        }
+        evaluations += scene.evaluations;
+    });
+
+    std::sort(events.begin(), events.end(), [](const SkyEvent& a, const SkyEvent& b) {
+        if (a.peak != b.peak)
+            return a.peak < b.peak;
+        if (a.observer != b.observer)
+            return a.observer < b.observer;
+        return a.front != b.front ? a.front < b.front : a.back < b.back;
+    });
+
+    if (stats) {
+        stats->samples = sampleCount;
+        stats->pairs = pairs.size();
+        stats->evaluations = evaluations;
+        stats->milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+    return events;
+}
+
+const char* skyEventName(SkyEventType type) {
+    switch (type) {
+    case SkyEventType::Eclipse: return "eclipse";
+    case SkyEventType::Shadow: return "shadow";
+    case SkyEventType::Transit: return "transit";
+    case SkyEventType::Occultation: return "occultation";
+    case SkyEventType::Conjunction: return "conjunction";
+    }
+    return "";
+}
@@ -0,0 +1,59 @@
+﻿#pragma once
+#include <cstddef>
+#include <memory>
+#include <vector>
+#include "body_store.h"
+#include "ephemeris.h"
+
+// Rodzaj zjawiska widzianego z ciała obserwatora
+enum class SkyEventType {
+    Eclipse,     // Ciało zasłania źródło światła (Księżyc przed Słońcem widziany z Ziemi)
+    Shadow,      // Obserwatorem jest źródło światła: ciało bliższe rzuca cień na dalsze (zaćmienie Księżyca, cień Io na Jowiszu)
+    Transit,     // Mniejsza tarcza przechodzi na tle większej (księżyc galileuszowy przed Jowiszem)
+    Occultation, // Większa tarcza zakrywa mniejszą
+    Conjunction  // Tarcze dwóch ciał z masą mijają się w odstępie mniejszym niż próg, bez zakrycia
+};
+
+// Zjawisko z tabeli wyników; kąty w stopniach, czasy w sekundach symulacji
+struct SkyEvent {
+    SkyEventType type;
+    int observer;
+    int front;          // Ciało bliższe obserwatorowi w chwili peak
+    int back;
+    double begin;       // Zetknięcie tarcz, dla koniunkcji równe peak
+    double peak;        // Najmniejsza odległość kątowa
+    double end;         // Rozejście się tarcz
+    float separation;   // Odległość kątowa środków w chwili peak
+    float frontRadius;  // Promienie kątowe tarcz w chwili peak
+    float backRadius;
+    bool central;       // Tarcza mniejsza cała na tle większej (zaćmienie całkowite lub obrączkowe, pełny tranzyt)
+    bool clipped;       // Zjawisko trwało już na początku okna albo jeszcze trwa na jego końcu
+};
+
+struct EventSearchSettings {
+    std::vector<int> observers;    // Ciała, z których patrzymy, np. Ziemia i Słońce
+    int lightSource = 0;           // Źródło światła, zwykle Słońce
+    double step = 1.0 / 60.0;      // Krok próbkowania; zjawiska krótsze od kroku łapie szukanie minimów między próbkami
+    double tolerance = 1.0e-6;     // Dokładność czasów początku i końca
+    float conjunctionAngle = 1.0f; // Próg odstępu brzegów tarcz dla koniunkcji w stopniach, 0 wyłącza koniunkcje
+};
+
+struct EventSearchStats {
+    size_t samples = 0;      // Chwile próbkowania
+    size_t pairs = 0;        // Śledzone pary ciał, razem dla wszystkich obserwatorów
+    size_t evaluations = 0;  // Ustawienia sceny na chwilę: próbki oraz zawężanie pierwiastków i minimów
+    double milliseconds = 0.0;
+};
+
+// Szuka zaćmień, tranzytów, zakryć i koniunkcji w oknie czasu. Pozycje pochodzą z elips (albo efemeryd) jako
+// funkcja czasu, więc okno dzieli się na kawałki liczone równolegle, każdy z własną kopią sceny. Dla każdej pary
+// ciał z promieniem, widzianej z obserwatora, próbkowana jest odległość kątowa minus suma promieni kątowych:
+// zmiana znaku między próbkami wyznacza przedział dla bisekcji, a lokalne minimum próbek jest zawężane metodą
+// złotego podziału, co wyłapuje zjawiska krótsze od kroku. Ciała całkowane w trybie grawitacyjnym są liczone
+// z elips, z których wystartowały. Wynik jest posortowany po chwili peak i nie zależy od liczby wątków.
+// Przyjmuje parametry: ciała (posortowane po rodzicu), efemerydy (mogą być puste), początek i koniec okna,
+// ustawienia i opcjonalnie statystyki
+std::vector<SkyEvent> findSkyEvents(const BodyStore& bodies, std::shared_ptr<const Ephemeris> ephemeris,
+    double begin, double end, const EventSearchSettings& settings, EventSearchStats* stats = nullptr);
+
+const char* skyEventName(SkyEventType type);
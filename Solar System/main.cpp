@@ -5,9 +5,30 @@
 #include <glm/gtc/type_ptr.hpp>
 #include <iostream>
 #include <vector>
+#include <memory>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
 #include <cstdlib>
+#include <exception>
+#include <string>
 #include "planet.h"
 #include "planets_setup.h"
+#include "shader.h"
+#include "shader_permutations.h"
+#include "simulation_clock.h"
+#include "simulation_thread.h"
+#include "orbit_kernel.h"
+#include "barnes_hut.h"
+#include "nbody_system.h"
+#include "ephemeris.h"
+#include "checkpoint.h"
+#include "texture_residency.h"
+#include "virtual_texture.h"
+#include "parallel.h"
+#include "options.h"
+#include "belt.h"
+#include "belt_renderer.h"
 
 #ifndef M_PI
 #   define M_PI 3.1415926535897932384626433832
@@ -17,16 +38,41 @@
 void framebuffer_size_callback(GLFWwindow* window, int width, int height); // Funkcja callback, która ustawia rozmiar okna
 void mouse_callback(GLFWwindow* window, double xpos, double ypos); // Funkcja callback, która obsługuje ruch myszy
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset); // Funkcja callback, która obsługuje przewijanie myszy
-void processInput(GLFWwindow* window); // Funkcja do przetwarzania wejścia z klawiatury
+void processInput(GLFWwindow* window, const SimulationSnapshot& snapshot); // Funkcja do przetwarzania wejścia z klawiatury
 void initializeShader();
-void drawOrbit(float radius, const glm::mat4& view, const glm::mat4& projection);
+void applySnapshot(BodyStore& bodies, const SimulationSnapshot& snapshot, float alpha);
+void printContacts(size_t bodyCount);
+void drawOrbit(const Planet& body, const glm::vec3& center, unsigned int program);
+void drawParticles(const SimulationSnapshot& snapshot, float alpha, unsigned int program);
+void benchmarkBelts(size_t maxCount, int width, int height);
+bool keyPressed(GLFWwindow* window, int key);
+float projectedDiameter(const glm::vec3& center, float radius, const glm::mat4& view, float aspect, int viewportHeight);
+void updateRelevance(const BodyStore& bodies, const SimulationSnapshot& snapshot, const glm::mat4& view, float aspect, int viewportHeight);
 
 // Globalne zmienne OpenGL
-unsigned int VAO, shaderProgram;
+unsigned int VAO, frameUBO;
+ShaderPermutations shaderPermutations;
 unsigned int orbitVAO, orbitVBO;
+unsigned int particleVAO, particleVBO;
+std::vector<float> particleVertices; // Interpolowane pozycje cząstek wysyłane co klatkę
+Belt belt;                           // Pasy małych ciał na stałych orbitach
+BeltRenderer beltRenderer;
+std::vector<float> beltPositions;    // Pozycje cząstek pasów w bieżącej klatce, trójki xyz, tylko przy liczeniu na CPU
+double beltMilliseconds = 0.0;       // Czas liczenia pozycji pasów w ostatniej klatce
+bool beltOrbitsOnCpu = false;        // Pozycje pasów z CPU zamiast z vertex shadera
 unsigned int indexCount;
 float deltaTime = 0.0f;
-float lastFrame = 0.0f;
+double lastFrame = 0.0;
+
+// Symulacja na własnym wątku, ze stałym krokiem niezależnym od częstotliwości klatek
+SimulationClock simulationClock(1.0 / 60.0, 10);
+SimulationThread simulationThread;
+double timeScale = 1.0;
+
+// Poziom szczegółów: układy i cząstki mniejsze na ekranie niż lodPixels albo poza kadrem nie są liczone co krok
+const float lodPixels = 2.0f;
+std::vector<float> systemExtents;       // Promień sfery obejmującej ciało z księżycami
+std::vector<signed char> sentRelevance; // Ostatnio wysłana istotność układów, ostatni element dla cząstek
 
 // Globalne zmienne kamery
 glm::vec3 cameraPos = glm::vec3(0.0f, 7.0f, 10.0f);
@@ -39,68 +85,291 @@ float lastY = 0.0f;
 bool firstMouse = true;
 float fov = 45.0f;
 
+// Menedżer rezydencji tekstur z budżetem VRAM
+const size_t textureBudgetBytes = 256 * 1024 * 1024;
+TextureResidency textureResidency(textureBudgetBytes);
+
+// Tekstury wirtualne dla map powierzchni w wysokiej rozdzielczości
+VirtualTextureSystem virtualTextures;
+
 // Vertex shader - definiuje wierzchołki i ich atrybuty
+// Warianty: LINE - tylko pozycja, bez normalnych i współrzędnych tekstury
 const char* vertexShaderSource = R"(
     #version 330 core
     layout (location = 0) in vec3 aPos;
+#ifndef LINE
     layout (location = 1) in vec3 aNormal;
     layout (location = 2) in vec2 aTexCoord;
-    
+
     out vec2 TexCoords;
     out vec3 FragPos;
     out vec3 Normal;
+#endif
 
     uniform mat4 model;
-    uniform mat4 view;
-    uniform mat4 projection;  
+
+    layout (std140) uniform Frame {
+        mat4 view;
+        mat4 projection;
+        vec4 lightPos;
+        vec4 lightColor;
+    };
 
     void main() {
-        FragPos = vec3(model * vec4(aPos, 1.0));
+        vec4 worldPos = model * vec4(aPos, 1.0);
+#ifndef LINE
+        FragPos = vec3(worldPos);
         Normal = mat3(transpose(inverse(model))) * aNormal;
-        gl_Position = projection * view * vec4(FragPos, 1.0);
-        TexCoords = aTexCoord;  
+        TexCoords = aTexCoord;
+#endif
+        gl_Position = projection * view * worldPos;
     }
 )";
 
 // Fragment shader - oblicza kolor fragmentu na podstawie światła i tekstury
+// Warianty: TEXTURED, VIRTUAL_TEXTURE - źródło koloru; EMISSIVE - ciało świecące bez światła rozproszonego; LINE - stały kolor
 const char* fragmentShaderSource = R"(
     #version 330 core
+    out vec4 FragColor;
+
+    uniform vec3 objectColor;
+
+#ifdef LINE
+    void main() {
+        FragColor = vec4(objectColor, 1.0);
+    }
+#else
     in vec3 FragPos;
     in vec3 Normal;
     in vec2 TexCoords;
 
-    out vec4 FragColor;
+    layout (std140) uniform Frame {
+        mat4 view;
+        mat4 projection;
+        vec4 lightPos;
+        vec4 lightColor;
+    };
 
-    uniform vec3 lightPos;
-    uniform vec3 lightColor;
-    uniform vec3 objectColor;
-    uniform float emissiveStrength;
+#ifdef TEXTURED
     uniform sampler2D texture1;
-    uniform bool useTexture;
+#endif
+
+#ifdef VIRTUAL_TEXTURE
+    // Tekstura wirtualna: tablica pośrednia wskazuje slot kafla w fizycznym cache
+    uniform usampler2D vtIndirection;
+    uniform sampler2D vtPhysical;
+    uniform vec2 vtSize;
+    uniform float vtTileSize;
+    uniform float vtBorder;
+    uniform float vtCacheSize;
+    uniform float vtMaxLevel;
+
+    vec3 sampleVirtualTexture(vec2 uv) {
+        uv = clamp(uv, 0.0, 0.99999);
+        vec2 texel = uv * vtSize;
+        vec2 dx = dFdx(texel);
+        vec2 dy = dFdy(texel);
+        float mip = 0.5 * log2(max(max(dot(dx, dx), dot(dy, dy)), 1e-8));
+        int level = int(clamp(floor(mip), 0.0, vtMaxLevel));
+
+        ivec2 tile = ivec2(uv * vtSize / exp2(float(level)) / vtTileSize);
+        uvec4 page = texelFetch(vtIndirection, tile, level);
+
+        // Kafel może pochodzić z grubszego poziomu, jeśli właściwy nie jest jeszcze wczytany
+        vec2 pageTexel = uv * vtSize / exp2(float(page.b));
+        vec2 inTile = pageTexel - floor(pageTexel / vtTileSize) * vtTileSize;
+        vec2 slotOrigin = vec2(page.rg) * (vtTileSize + 2.0 * vtBorder) + vtBorder;
+        return texture(vtPhysical, (slotOrigin + inTile) / vtCacheSize).rgb;
+    }
+#endif
+
+#ifdef EMISSIVE
+    uniform float emissiveStrength;
+#endif
 
     void main() {
+#if defined(VIRTUAL_TEXTURE)
+        vec3 baseColor = sampleVirtualTexture(TexCoords);
+#elif defined(TEXTURED)
+        vec3 baseColor = texture(texture1, TexCoords).rgb;
+#else
+        vec3 baseColor = objectColor;
+#endif
+
         float ambientStrength = 0.2;
-        vec3 ambient = ambientStrength * lightColor;
+        vec3 ambient = ambientStrength * lightColor.rgb;
 
+#ifdef EMISSIVE
+        // Światło jest w środku ciała świecącego, więc składowa rozproszona i tak jest zerowa
+        vec3 result = ambient + emissiveStrength * baseColor;
+#else
         vec3 norm = normalize(Normal);
-        vec3 lightDirN = normalize(lightPos - FragPos);
+        vec3 lightDirN = normalize(lightPos.xyz - FragPos);
         float diff = max(dot(norm, lightDirN), 0.0);
-        vec3 diffuse = diff * lightColor;
-
-        vec3 baseColor = useTexture ? texture(texture1, TexCoords).rgb : objectColor;
-
-        vec3 emissive = emissiveStrength * baseColor;
-        vec3 result = ambient + diffuse + emissive;
+        vec3 diffuse = diff * lightColor.rgb;
+        vec3 result = ambient + diffuse;
+#endif
 
         FragColor = vec4(result * baseColor, 1.0);
     }
+#endif
 )";
 
+// Dane wspólne dla wszystkich programów sceny, układ zgodny z blokiem std140 Frame
+struct FrameUniforms {
+    glm::mat4 view;
+    glm::mat4 projection;
+    glm::vec4 lightPos;
+    glm::vec4 lightColor;
+};
+
+// Element listy rysowania: indeks ciała i klucz wariantu programu
+struct DrawItem {
+    unsigned int key;
+    int body;
+};
+
+// Klucz wariantu programu dla ciała, przyjmuje parametry: ciało i czy świeci
+unsigned int shaderKey(const Planet& body, bool emissive) {
+    unsigned int key = emissive ? (unsigned int)ShaderEmissive : 0u;
+    if (body.virtualTexture() != 0)
+        key |= ShaderVirtualTexture;
+    else if (body.textureID() != 0)
+        key |= ShaderTextured;
+    return key;
+}
+
 
-int main()
+int main(int argc, char** argv)
 {
     int width, height;
 
+    // Narzędzie offline: pocięcie dużej mapy na kafle tekstury wirtualnej
+    if (argc == 4 && std::string(argv[1]) == "--build-vt") {
+        return buildVirtualTexture(argv[2], argv[3]) ? 0 : 1;
+    }
+
+    // Pomiary z opcjonalnym rozmiarem w argv[2], 0 - rozmiar domyślny
+    std::string benchmark = argc >= 2 ? argv[1] : "";
+    size_t benchmarkSize = 0;
+    if (argc >= 3 && (benchmark == "--bench-orbits" || benchmark == "--bench-nbody" || benchmark == "--bench-direct")) {
+        try {
+            benchmarkSize = (size_t)toCount(argv[2]);
+        }
+        catch (const std::exception&) {
+            printInvalidOption(benchmark);
+            return 1;
+        }
+    }
+
+    // Pomiar wydajności jądra propagacji orbit: --bench-orbits [liczba ciał]
+    if (benchmark == "--bench-orbits") {
+        benchmarkOrbitKernels(benchmarkSize > 0 ? benchmarkSize : 1000000);
+        return 0;
+    }
+
+    // Pomiar wydajności i dokładności drzewa Barnes–Hut: --bench-nbody [liczba cząstek]
+    if (benchmark == "--bench-nbody") {
+        benchmarkBarnesHut(benchmarkSize > 0 ? benchmarkSize : 1000000);
+        return 0;
+    }
+
+    // Pomiar sumowania bezpośredniego i dryfu metod całkowania: --bench-direct [liczba ciał]
+    if (benchmark == "--bench-direct") {
+        benchmarkNBody(benchmarkSize > 0 ? benchmarkSize : 1024);
+        return 0;
+    }
+
+    // Opcje symulacji: --debris [liczba cząstek] - rodzina planetoid, --nbody [leapfrog|yoshida|block] - planety przyciągają się,
+    // --time T - chwila startowa w sekundach, --ephemeris plik - pozycje z efemeryd,
+    // --build-ephemeris plik [sekundy] - zapis efemeryd z orbit sceny od chwili 0 i porównanie z orbitami,
+    // --belts [liczba cząstek] - pasy małych ciał, --belts-cpu - pozycje pasów z CPU zamiast z vertex shadera,
+    // --bench-belts [liczba cząstek] - pomiar pasów do podanej liczby,
+    // --contacts [krotność promieni] - zgłaszanie zbliżeń i zderzeń ciał i cząstek,
+    // --deterministic [ziarno] - powtarzalna symulacja: stały krok, jądro skalarne, ziarno cząstek i pasów,
+    // --hash-log plik - skrót stanu po każdym kroku trybu deterministycznego, --threads N - liczba wątków puli,
+    // --checkpoint plik - plik stanu dla F5 (zapis) i F9 (odtworzenie), --restore plik - start ze stanu z pliku,
+    // --no-lod - wszystkie księżyce i cząstki liczone w każdym kroku, także poza kadrem
+    size_t debrisCount = 0;
+    size_t beltCount = 0, beltBenchmarkCount = 0;
+    double startTime = 0.0;
+    std::string ephemerisPath, ephemerisOutput;
+    double ephemerisDuration = 3600.0;
+    bool gravity = false;
+    float contactFactor = 0.0f;
+    bool deterministic = false;
+    uint32_t debrisSeed = 2024, beltSeed = 4242;
+    std::string hashLogPath;
+    std::string checkpointPath = "simulation.ssck", restorePath;
+    Integrator integrator = Integrator::Yoshida4;
+    bool levelOfDetail = true;
+    for (int i = 1; i < argc; ++i) {
+        std::string option = argv[i];
+        bool hasValue = optionHasValue(i, argc, argv);
+        try {
+            if (option == "--debris") {
+                debrisCount = hasValue ? (size_t)toCount(argv[++i]) : 100000;
+            }
+            else if (option == "--nbody") {
+                gravity = true;
+                std::string name = hasValue ? argv[++i] : "";
+                integrator = name == "leapfrog" ? Integrator::Leapfrog : name == "block" ? Integrator::BlockLeapfrog : Integrator::Yoshida4;
+            }
+            else if (option == "--time" && hasValue) {
+                startTime = toNumber(argv[++i]);
+            }
+            else if (option == "--ephemeris" && hasValue) {
+                ephemerisPath = argv[++i];
+            }
+            else if (option == "--belts") {
+                beltCount = hasValue ? (size_t)toCount(argv[++i]) : 1000000;
+            }
+            else if (option == "--belts-cpu") {
+                beltOrbitsOnCpu = true;
+            }
+            else if (option == "--bench-belts") {
+                beltBenchmarkCount = hasValue ? (size_t)toCount(argv[++i]) : 10000000;
+            }
+            else if (option == "--contacts") {
+                contactFactor = hasValue ? (float)toNumber(argv[++i]) : 3.0f;
+            }
+            else if (option == "--deterministic") {
+                deterministic = true;
+                if (hasValue)
+                    debrisSeed = beltSeed = (uint32_t)toCount(argv[++i]);
+            }
+            else if (option == "--hash-log" && hasValue) {
+                hashLogPath = argv[++i];
+            }
+            else if (option == "--threads" && hasValue) {
+                setWorkerCount((unsigned int)toCount(argv[++i]));
+            }
+            else if (option == "--checkpoint" && hasValue) {
+                checkpointPath = argv[++i];
+            }
+            else if (option == "--restore" && hasValue) {
+                restorePath = argv[++i];
+            }
+            else if (option == "--build-ephemeris" && hasValue) {
+                ephemerisOutput = argv[++i];
+                if (optionHasValue(i, argc, argv))
+                    ephemerisDuration = toNumber(argv[++i]);
+            }
+            else if (option == "--no-lod") {
+                levelOfDetail = false;
+            }
+        }
+        catch (const std::exception&) {
+            printInvalidOption(option);
+            return 1;
+        }
+    }
+
+    // Warianty SIMD różnią się zaokrągleniami (FMA), więc powtarzalność między maszynami daje tylko jądro skalarne;
+    // ustawiane przed policzeniem pierwszych pozycji
+    if (deterministic)
+        setOrbitKernel(OrbitKernel::Scalar);
+
     // Inicjalizacja okna i OpenGL
     glfwInit();
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
@@ -135,113 +404,317 @@ int main()
         return -1;
     }
 
+    initializeProgramCache("shader_cache", (void* (*)(const char*))glfwGetProcAddress);
     initializeShader();
+    virtualTextures.initialize(vertexShaderSource);
+    beltRenderer.initialize();
 	glEnable(GL_DEPTH_TEST); // Włącz test głębokości, aby poprawnie rysować obiekty 3D
 
-	// Planety i tekstury
-    glUniform1i(glGetUniformLocation(shaderProgram, "texture1"), 0);
-    std::vector<Planet> planets;
-    initializePlanets(planets);
+	// Planety i tekstury, wszystkie ciała w jednym magazynie
+    BodyStore bodies;
+    initializePlanets(bodies);
+    std::vector<DrawItem> drawItems;
+    std::vector<float> projectedSizes; // Rzutowana średnica ciał w pikselach, 0 - poza frustum
+
+    if (!ephemerisOutput.empty()) {
+        Ephemeris built;
+        bool success = buildEphemeris(bodies, ephemerisOutput.c_str(), 0.0, ephemerisDuration)
+            && built.open(ephemerisOutput.c_str(), bodies.size());
+        if (success)
+            benchmarkEphemeris(bodies, built);
+        glfwTerminate();
+        return success ? 0 : 1;
+    }
 
-    // Pętla główna renderująca
-    while (!glfwWindowShouldClose(window)) {
-        float currentFrame = glfwGetTime();
-        deltaTime = currentFrame - lastFrame;
-
-		// Aktualizacja pozycji planet i ich księżyców
-        for (size_t i = 1; i < planets.size(); ++i) {
-            planets[i].orbitAngle += planets[i].orbitSpeed * deltaTime;
-            float angleRad = glm::radians(planets[i].orbitAngle);
-            float x = cos(angleRad) * planets[i].orbitRadius;
-            float z = sin(angleRad) * planets[i].orbitRadius;
-            planets[i].position = glm::vec3(x, 0.0f, z);
-            planets[i].updateMoons(deltaTime);
+    if (beltBenchmarkCount > 0) {
+        benchmarkBelts(beltBenchmarkCount, width, height);
+        glfwTerminate();
+        return 0;
+    }
+
+    ParticleSystem debris;
+    initializeDebris(debris, debrisCount, debrisSeed);
+    initializeBelts(belt, beltCount, beltSeed);
+    beltRenderer.upload(belt);
+    if (beltOrbitsOnCpu)
+        beltPositions.resize(belt.size() * 3);
+    Simulation simulation(bodies, debris);
+    if (!ephemerisPath.empty()) {
+        auto ephemeris = std::make_shared<Ephemeris>();
+        if (ephemeris->open(ephemerisPath.c_str(), bodies.size())) {
+            std::cout << "Ephemeris: " << ephemeris->bodyCount() << " bodies, t = " << ephemeris->startTime()
+                << ".." << ephemeris->endTime() << " s" << std::endl;
+            simulation.setEphemeris(ephemeris);
+        }
+        else {
+            std::cout << "Failed to open ephemeris: " << ephemerisPath << std::endl;
         }
+    }
+    if (startTime != 0.0 && !simulation.setTime(startTime))
+        std::cout << "--time is not available with debris, starting at t = 0" << std::endl;
+    // Stan z pliku zastępuje cząstki, tryb grawitacyjny i czas wynikające z opcji
+    bool restored = !restorePath.empty() && loadCheckpoint(simulation, restorePath.c_str());
+    if (gravity && !restored)
+        simulation.enableGravity(integrator);
+    if (contactFactor > 0.0f && !simulation.contactsEnabled()) {
+        ContactSettings contactSettings;
+        contactSettings.approachFactor = contactFactor;
+        simulation.enableContacts(contactSettings);
+    }
+    if (deterministic) {
+        simulation.setDeterministic(true);
+        if (!hashLogPath.empty() && !simulationThread.setHashLog(hashLogPath))
+            std::cout << "Failed to create hash log: " << hashLogPath << std::endl;
+    }
+    if (levelOfDetail) {
+        simulation.enableLevelOfDetail(LevelOfDetailSettings());
+        bodies.subtreeExtents(systemExtents);
+        sentRelevance.assign(bodies.size() + 1, 1);
+    }
+    simulationThread.setCheckpointPath(checkpointPath);
+    simulationThread.start(simulation, simulationClock);
 
+    // Pętla główna renderująca
+    while (!glfwWindowShouldClose(window)) {
+        double currentFrame = glfwGetTime();
+        double frameTime = currentFrame - lastFrame;
+        deltaTime = (float)frameTime; // Kamera porusza się w czasie rzeczywistym
         lastFrame = currentFrame;
+
+		// Najnowszy stan z wątku symulacji, bez czekania na niego; rysujemy stan interpolowany
+        const SimulationSnapshot& snapshot = simulationThread.latest();
+        applySnapshot(bodies, snapshot, SimulationThread::interpolationAlpha(snapshot));
+        printContacts(bodies.size());
 		glfwGetFramebufferSize(window, &width, &height); // Dynamczznie pobierz rozmiar okna
 
-		processInput(window); // Przetwarzanie wejścia z klawiatury
+		processInput(window, snapshot); // Przetwarzanie wejścia z klawiatury
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-        glUseProgram(shaderProgram);
-
         glm::mat4 view = glm::lookAt(cameraPos, cameraPos + cameraFront, cameraUp);
         glm::mat4 projection = glm::perspective(glm::radians(fov), (float)width / (float)height, 0.1f, 100.0f);
 
-        // Ustaw uniformy view/projection tylko raz
-		glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "view"), 1, GL_FALSE, glm::value_ptr(view)); // macierz widoku
-		glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "projection"), 1, GL_FALSE, glm::value_ptr(projection)); // macierz projekcji
-
-        // Ustaw światło globalnie
-        glUniform3f(glGetUniformLocation(shaderProgram, "lightPos"),
-            planets[0].position.x,
-            planets[0].position.y,
-            planets[0].position.z);
-        glUniform3f(glGetUniformLocation(shaderProgram, "lightColor"), 1.0f, 1.0f, 1.0f);
-
-        // Rysuj orbity
-        for (size_t i = 1; i < planets.size(); ++i) {
-            drawOrbit(planets[i].orbitRadius, view, projection);
+        // Ustaw widok, projekcję i światło raz dla wszystkich programów
+        FrameUniforms frame;
+        frame.view = view; // macierz widoku
+        frame.projection = projection; // macierz projekcji
+        frame.lightPos = glm::vec4(Planet(bodies, 0).position(), 1.0f);
+        frame.lightColor = glm::vec4(1.0f, 1.0f, 1.0f, 1.0f);
+        glBindBuffer(GL_UNIFORM_BUFFER, frameUBO);
+        glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(FrameUniforms), &frame);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+        // Odrzucanie poza frustum i rozmiar na ekranie dla każdego ciała, kawałkami na puli wątków
+        float aspect = (float)width / (float)height;
+        projectedSizes.resize(bodies.size());
+        parallelFor(bodies.size(), 256, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                Planet body(bodies, (int)i);
+                projectedSizes[i] = projectedDiameter(body.position(), body.radius(), view, aspect, height);
+            }
+        });
+        updateRelevance(bodies, snapshot, view, aspect, height);
+
+        // Przebieg feedback tekstur wirtualnych w niskiej rozdzielczości
+        if (!virtualTextures.empty()) {
+            virtualTextures.beginFeedback(width, height);
+            unsigned int feedbackProgram = virtualTextures.feedbackProgram;
+            for (size_t i = 0; i < bodies.size(); ++i) {
+                if (projectedSizes[i] <= 0.0f)
+                    continue;
+                Planet body(bodies, (int)i);
+                virtualTextures.setFeedbackTexture(body.virtualTexture());
+                body.draw(feedbackProgram);
+            }
+            virtualTextures.endFeedback();
+            virtualTextures.update();
+            shaderPermutations.invalidate(); // Program feedback zmienił aktywny program
         }
 
-        // Rysuj Słońce
-        glUniform1f(glGetUniformLocation(shaderProgram, "emissiveStrength"), 1.0f);
-        if (planets[0].textureID != 0) {
-            glActiveTexture(GL_TEXTURE0);
-            glBindTexture(GL_TEXTURE_2D, planets[0].textureID);
-            glUniform1i(glGetUniformLocation(shaderProgram, "useTexture"), 1);
+        // Zapotrzebowanie na poziomy mipmap na podstawie rzutowanego rozmiaru ciał
+        textureResidency.beginFrame();
+        for (size_t i = 0; i < bodies.size(); ++i) {
+            textureResidency.request(bodies.textureID[i], projectedSizes[i]);
         }
-        else {
-            glUniform1i(glGetUniformLocation(shaderProgram, "useTexture"), 0);
+        textureResidency.update();
+
+        // Rysuj orbity wariantem linii, bez oświetlenia
+        unsigned int lineProgram = shaderPermutations.use(ShaderLine);
+        glUniform3f(glGetUniformLocation(lineProgram, "objectColor"), 0.4f, 0.4f, 0.4f);
+        // Orbity wokół Słońca i wokół barycentrów (ciał bez promienia), bez orbit księżyców
+        for (size_t i = 0; i < bodies.size(); ++i) {
+            int p = bodies.parent[i];
+            if (p == 0 || (p > 0 && bodies.radius[p] <= 0.0f))
+                drawOrbit(Planet(bodies, (int)i), Planet(bodies, p).position(), lineProgram);
         }
-        planets[0].draw(shaderProgram);
-
-        // Rysuj pozostałe planety i ich księżyce
-        glUniform1f(glGetUniformLocation(shaderProgram, "emissiveStrength"), 0.0f);
-        for (size_t i = 1; i < planets.size(); ++i) {
-            if (planets[i].textureID != 0) {
-                glActiveTexture(GL_TEXTURE0);
-                glBindTexture(GL_TEXTURE_2D, planets[i].textureID);
-                glUniform1i(glGetUniformLocation(shaderProgram, "useTexture"), 1);
+
+        // Cząstki jako punkty, tym samym wariantem linii
+        if (!snapshot.particles.empty()) {
+            glUniform3f(glGetUniformLocation(lineProgram, "objectColor"), 0.7f, 0.65f, 0.55f);
+            drawParticles(snapshot, SimulationThread::interpolationAlpha(snapshot), lineProgram);
+        }
+
+        // Pasy w chwili interpolowanej między stanami; pozycje są funkcją czasu, więc leżą dokładnie na orbitach.
+        // Domyślnie liczy je vertex shader z elementów wysłanych raz, bez pracy CPU i wysyłki danych co klatkę
+        if (!belt.empty()) {
+            double alpha = SimulationThread::interpolationAlpha(snapshot);
+            double beltTime = snapshot.previousTime + (snapshot.time - snapshot.previousTime) * alpha;
+            if (beltOrbitsOnCpu) {
+                auto start = std::chrono::steady_clock::now();
+                belt.evaluate(beltTime, beltPositions.data());
+                beltMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+                beltRenderer.draw(beltPositions, Planet(bodies, 0).position(), width, height);
             }
             else {
-                glUniform1i(glGetUniformLocation(shaderProgram, "useTexture"), 0);
+                beltRenderer.drawOrbits(beltTime, Planet(bodies, 0).position());
             }
-            planets[i].draw(shaderProgram);
-
-            // Księżyce
-            for (const auto& moon : planets[i].moons) {
-                if (moon.textureID != 0) {
-                    glActiveTexture(GL_TEXTURE0);
-                    glBindTexture(GL_TEXTURE_2D, moon.textureID);
-                    glUniform1i(glGetUniformLocation(shaderProgram, "useTexture"), 1);
-                }
-                else {
-                    glUniform1i(glGetUniformLocation(shaderProgram, "useTexture"), 0);
-                }
-                moon.draw(shaderProgram);
+            shaderPermutations.invalidate();
+        }
+
+        // Lista rysowania: Słońce świeci, pozostałe planety i księżyce są oświetlane, barycentra są niewidoczne,
+        // ciała poza frustum pomijamy
+        drawItems.clear();
+        for (size_t i = 0; i < bodies.size(); ++i) {
+            if (bodies.radius[i] <= 0.0f || projectedSizes[i] <= 0.0f)
+                continue;
+            drawItems.push_back({ shaderKey(Planet(bodies, (int)i), i == 0), (int)i });
+        }
+
+        // Sortowanie po kluczu, żeby zmieniać program jak najrzadziej
+        std::stable_sort(drawItems.begin(), drawItems.end(), [](const DrawItem& a, const DrawItem& b) { return a.key < b.key; });
+        unsigned int currentKey = ~0u;
+        unsigned int program = 0;
+        for (const DrawItem& item : drawItems) {
+            if (item.key != currentKey) {
+                currentKey = item.key;
+                program = shaderPermutations.use(item.key);
+                if (item.key & ShaderEmissive)
+                    glUniform1f(glGetUniformLocation(program, "emissiveStrength"), 1.0f);
             }
+            Planet body(bodies, item.body);
+            virtualTextures.bind(body.virtualTexture(), program);
+            body.draw(program);
         }
 
 		glfwSwapBuffers(window); // Wymiana buforów, aby wyświetlić narysowane obiekty
         glfwPollEvents();
     }
 
+    simulationThread.stop();
+    virtualTextures.release();
+    beltRenderer.release();
     glfwTerminate();
 }
 
+// Funkcja ustawiająca pozycje ciał interpolowane ze stanu symulacji, przyjmuje parametry: magazyn ciał, stan i alpha (0..1)
+void applySnapshot(BodyStore& bodies, const SimulationSnapshot& snapshot, float alpha) {
+    const float* previous = snapshot.previousPositions.data();
+    const float* current = snapshot.positions.data();
+    for (size_t i = 0; i < bodies.size(); ++i) {
+        bodies.positionX[i] = previous[i * 3 + 0] + (current[i * 3 + 0] - previous[i * 3 + 0]) * alpha;
+        bodies.positionY[i] = previous[i * 3 + 1] + (current[i * 3 + 1] - previous[i * 3 + 1]) * alpha;
+        bodies.positionZ[i] = previous[i * 3 + 2] + (current[i * 3 + 2] - previous[i * 3 + 2]) * alpha;
+    }
+}
+
+// Funkcja wypisująca zdarzenia zbliżeń odebrane od wątku symulacji, najwyżej kilka na klatkę, żeby konsola
+// nie spowalniała renderowania; reszta jest tylko liczona, przyjmuje parametr: liczba ciał
+void printContacts(size_t bodyCount) {
+    const int maxPrinted = 8;
+    int received = 0;
+    ContactEvent event;
+    while (simulationThread.receiveContact(event)) {
+        if (++received > maxPrinted)
+            continue;
+        auto object = [bodyCount](int index) {
+            return index < (int)bodyCount ? "body " + std::to_string(index) : "particle " + std::to_string(index - (int)bodyCount);
+        };
+        std::cout << (event.type == ContactType::Collision ? "Collision: " : "Close approach: ") << object(event.first)
+            << " and " << object(event.second) << " at t = " << event.time << " s, distance " << event.distance << std::endl;
+    }
+    if (received > maxPrinted)
+        std::cout << "... and " << received - maxPrinted << " more contacts" << std::endl;
+}
+
 // Funkcja callback, która ustawia rozmiar okna, przyjmuje następujące parametry: okno, szerokość i wysokość
 void framebuffer_size_callback(GLFWwindow* window, int width, int height) {
     glViewport(0, 0, width, height);
 }
 
-// Funkcja do przetwarzania wejścia z klawiatury, przyjmuje następujące parametry: okno
-void processInput(GLFWwindow* window) {
+// Funkcja do przetwarzania wejścia z klawiatury, przyjmuje następujące parametry: okno i stan symulacji
+// pobrany w tej klatce (drugie latest() mogłoby oddać producentowi bufor, który pętla główna jeszcze czyta)
+void processInput(GLFWwindow* window, const SimulationSnapshot& snapshot) {
     if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS) {
         glfwSetWindowShouldClose(window, true);
     }
 
+    // Statystyki rezydencji tekstur
+    if (keyPressed(window, GLFW_KEY_I)) {
+        textureResidency.printStats();
+        virtualTextures.printStats();
+        printProgramCacheStats();
+        std::cout << "Simulation: t = " << snapshot.time << " s, " << snapshot.steps << " steps, "
+            << snapshot.droppedSteps << " dropped, time scale " << snapshot.timeScale << (snapshot.paused ? ", paused" : "")
+            << ", " << orbitKernelName(orbitKernel()) << " kernel" << std::endl;
+        if (!snapshot.particles.empty()) {
+            std::cout << "Particles: " << snapshot.particles.size() / 3 << ", Barnes-Hut " << snapshot.treeMilliseconds
+                << " ms per step" << std::endl;
+        }
+        if (!belt.empty()) {
+            std::cout << "Belts: " << belt.size() << " particles in " << belt.populations.size() << " populations, "
+                << belt.memoryBytes() / (1024.0 * 1024.0) << " MB, positions ";
+            if (beltOrbitsOnCpu)
+                std::cout << "on CPU " << beltMilliseconds << " ms per frame" << std::endl;
+            else
+                std::cout << "in vertex shader" << std::endl;
+        }
+        if (snapshot.levelOfDetail) {
+            std::cout << "Level of detail: " << snapshot.lod.evaluatedBodies << "/" << snapshot.positions.size() / 3
+                << " bodies evaluated";
+            if (!snapshot.particles.empty())
+                std::cout << ", particle step " << snapshot.lod.particleStride << " s, " << snapshot.lod.particleLag << " s behind";
+            std::cout << std::endl;
+        }
+        if (snapshot.gravity) {
+            std::cout << "Gravity: energy drift " << snapshot.drift.energy << " (last step " << snapshot.drift.energyStep
+                << "), angular momentum drift " << snapshot.drift.angularMomentum << ", " << snapshot.drift.stepMilliseconds
+                << " ms per step, forces for " << snapshot.drift.activeBodies << " bodies in the last step" << std::endl;
+        }
+    }
+
+    // Sterowanie symulacją: P - pauza, [ i ] - wolniej i szybciej, R - wstecz,
+    // Home - powrót do chwili 0, Page Up i Page Down - skok o 100 s czasu rzeczywistego przy bieżącej skali,
+    // F5 - zapis stanu, F9 - odtworzenie zapisanego stanu
+    double maxTimeScale = snapshot.seekable ? maxSeekableTimeScale : maxSteppedTimeScale;
+    if (keyPressed(window, GLFW_KEY_P)) {
+        simulationThread.send({ SimulationCommandType::TogglePause });
+    }
+    if (keyPressed(window, GLFW_KEY_F5)) {
+        simulationThread.send({ SimulationCommandType::SaveCheckpoint });
+    }
+    if (keyPressed(window, GLFW_KEY_F9)) {
+        simulationThread.send({ SimulationCommandType::RestoreCheckpoint });
+    }
+    if (keyPressed(window, GLFW_KEY_RIGHT_BRACKET) && std::fabs(timeScale) < maxTimeScale) {
+        timeScale = std::copysign(std::min(std::fabs(timeScale) * 2.0, maxTimeScale), timeScale);
+        simulationThread.send({ SimulationCommandType::SetTimeScale, timeScale });
+    }
+    if (keyPressed(window, GLFW_KEY_LEFT_BRACKET) && std::fabs(timeScale) > 0.125) {
+        timeScale *= 0.5;
+        simulationThread.send({ SimulationCommandType::SetTimeScale, timeScale });
+    }
+    if (keyPressed(window, GLFW_KEY_R)) {
+        timeScale = -timeScale;
+        simulationThread.send({ SimulationCommandType::SetTimeScale, timeScale });
+    }
+    if (snapshot.seekable) {
+        if (keyPressed(window, GLFW_KEY_HOME))
+            simulationThread.send({ SimulationCommandType::Seek, 0.0 });
+        if (keyPressed(window, GLFW_KEY_PAGE_UP))
+            simulationThread.send({ SimulationCommandType::Seek, snapshot.time + 100.0 * std::fabs(timeScale) });
+        if (keyPressed(window, GLFW_KEY_PAGE_DOWN))
+            simulationThread.send({ SimulationCommandType::Seek, snapshot.time - 100.0 * std::fabs(timeScale) });
+    }
+
     float baseSpeed = 5.0f;
     if (glfwGetKey(window, GLFW_KEY_LEFT_SHIFT) == GLFW_PRESS)
         baseSpeed = 15.0f;
@@ -261,56 +734,23 @@ void processInput(GLFWwindow* window) {
 
 // Inicjalizuje shadery i tworzy VAO/VBO dla sfery
 void initializeShader() {
-    // Vertex shader, który przekształca wierzchołki i oblicza normalne
-    unsigned int vertexShader = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertexShader, 1, &vertexShaderSource, NULL);
-    glCompileShader(vertexShader);
-
-    {
-        int success;
-        char infoLog[512];
-        glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &success);
-        if (!success) {
-            glGetShaderInfoLog(vertexShader, 512, NULL, infoLog);
-            std::cout << "ERROR::SHADER::VERTEX::COMPILATION_FAILED\n" << infoLog << std::endl;
-        }
-    }
-
-	// Fragment shader, który oblicza kolor fragmentu na podstawie światła i tekstury
-    unsigned int fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragmentShader, 1, &fragmentShaderSource, NULL);
-    glCompileShader(fragmentShader);
-
-    {
-        int success;
-        char infoLog[512];
-        glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &success);
-        if (!success) {
-            glGetShaderInfoLog(fragmentShader, 512, NULL, infoLog);
-            std::cout << "ERROR::SHADER::FRAGMENT::COMPILATION_FAILED\n" << infoLog << std::endl;
-        }
-    }
-
-	// Tworzenie programu shaderów, do którego dołączamy vertex i fragment shader
-    shaderProgram = glCreateProgram();
-    glAttachShader(shaderProgram, vertexShader);
-    glAttachShader(shaderProgram, fragmentShader);
-    glLinkProgram(shaderProgram);
-	
-    // Lokalne sprawdzanie błędów linkowania programu shaderów
-    {
-        int success;
-        char infoLog[512];
-        glGetProgramiv(shaderProgram, GL_LINK_STATUS, &success);
-        if (!success) {
-            glGetProgramInfoLog(shaderProgram, 512, NULL, infoLog);
-            std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
-        }
-    }
-
-	// Usuwanie shaderów, które zostały dołączone do programu
-    glDeleteShader(vertexShader);
-    glDeleteShader(fragmentShader);
+    // Program shaderów: vertex shader przekształca wierzchołki i oblicza normalne,
+    // fragment shader oblicza kolor fragmentu na podstawie światła i tekstury
+    // Warianty budowane z góry jedną partią: linie orbit, Słońce i ciała oświetlane
+    shaderPermutations.initialize(vertexShaderSource, fragmentShaderSource, {
+        ShaderLine,
+        ShaderTextured | ShaderEmissive,
+        ShaderTextured,
+        ShaderVirtualTexture,
+        0
+    });
+
+    // Bufor uniformów Frame wspólny dla wszystkich programów
+    glGenBuffers(1, &frameUBO);
+    glBindBuffer(GL_UNIFORM_BUFFER, frameUBO);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameUniforms), NULL, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    glBindBufferBase(GL_UNIFORM_BUFFER, frameUniformBinding, frameUBO);
 
 	// Inicjalizacja VAO/VBO dla sfery
     std::vector<float> vertices;
@@ -422,6 +862,16 @@ void initializeShader() {
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
     glEnableVertexAttribArray(0);
     glBindVertexArray(0);
+
+    // Bufor cząstek, wypełniany co klatkę w drawParticles
+    glGenVertexArrays(1, &particleVAO);
+    glGenBuffers(1, &particleVBO);
+
+    glBindVertexArray(particleVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, particleVBO);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+    glBindVertexArray(0);
 }
 
 // Funkcja callback, która obsługuje ruch myszy, przyjmuje parametry: okno, pozycja x i y myszy
@@ -469,13 +919,150 @@ void scroll_callback(GLFWwindow* window, double xoffset, double yoffset) {
         fov = 90.0f;
 }
 
-// Funkcja, która rysuje orbitę planety jako linię okręgu, przyjmuje parametry: promień orbity, macierz widoku i macierz projekcji
-void drawOrbit(float radius, const glm::mat4& view, const glm::mat4& projection) {
-	glm::mat4 model = glm::scale(glm::mat4(1.0f), glm::vec3(radius)); // macierz modelu dla orbity
-    unsigned int modelLoc = glGetUniformLocation(shaderProgram, "model");
+// Funkcja, która rysuje orbitę planety jako elipsę, przyjmuje parametry: ciało, pozycja rodzica i program wariantu linii
+// Okrąg jednostkowy w płaszczyźnie x-z przechodzi w elipsę: x -> aP, z -> bQ, środek przesunięty o -e * aP od rodzica
+void drawOrbit(const Planet& body, const glm::vec3& center, unsigned int program) {
+    glm::mat4 model(1.0f); // macierz modelu dla orbity
+    model[0] = glm::vec4(body.periapsis(), 0.0f);
+    model[2] = glm::vec4(body.minorAxis(), 0.0f);
+    model[3] = glm::vec4(center - body.eccentricity() * body.periapsis(), 1.0f);
+    unsigned int modelLoc = glGetUniformLocation(program, "model");
 	glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
 
     glBindVertexArray(orbitVAO);
     glDrawArrays(GL_LINE_LOOP, 0, 100);
     glBindVertexArray(0);
-}
\ No newline at end of file
+}
+
+// Funkcja, która rysuje cząstki jako punkty, przyjmuje parametry: stan symulacji, alpha (0..1) i program wariantu linii
+void drawParticles(const SimulationSnapshot& snapshot, float alpha, unsigned int program) {
+    const std::vector<float>& previous = snapshot.previousParticles;
+    const std::vector<float>& current = snapshot.particles;
+    particleVertices.resize(current.size());
+    for (size_t i = 0; i < current.size(); ++i) {
+        particleVertices[i] = previous[i] + (current[i] - previous[i]) * alpha;
+    }
+
+    glm::mat4 model(1.0f);
+    glUniformMatrix4fv(glGetUniformLocation(program, "model"), 1, GL_FALSE, glm::value_ptr(model));
+
+    // Bufor zastępowany w całości, żeby sterownik nie czekał na rysowanie z poprzedniej klatki
+    glBindBuffer(GL_ARRAY_BUFFER, particleVBO);
+    glBufferData(GL_ARRAY_BUFFER, particleVertices.size() * sizeof(float), NULL, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, particleVertices.size() * sizeof(float), particleVertices.data());
+    glBindVertexArray(particleVAO);
+    glDrawArrays(GL_POINTS, 0, (GLsizei)(particleVertices.size() / 3));
+    glBindVertexArray(0);
+}
+
+// Funkcja, która zwraca true tylko w klatce wciśnięcia klawisza, przyjmuje parametry: okno i kod klawisza
+bool keyPressed(GLFWwindow* window, int key) {
+    static bool previous[GLFW_KEY_LAST + 1] = {};
+    bool down = glfwGetKey(window, key) == GLFW_PRESS;
+    bool pressed = down && !previous[key];
+    previous[key] = down;
+    return pressed;
+}
+
+// Funkcja, która zwraca średnicę ciała na ekranie w pikselach albo 0, gdy ciało jest poza kadrem,
+// przyjmuje parametry: środek i promień ciała, macierz widoku, proporcje i wysokość okna
+float projectedDiameter(const glm::vec3& center, float radius, const glm::mat4& view, float aspect, int viewportHeight) {
+    glm::vec4 viewPos = view * glm::vec4(center, 1.0f);
+    float distance = -viewPos.z;
+    if (distance + radius < 0.1f)
+        return 0.0f; // za kamerą
+
+    float tanHalfFov = tanf(glm::radians(fov) * 0.5f);
+    if (fabsf(viewPos.y) - radius > distance * tanHalfFov || fabsf(viewPos.x) - radius > distance * tanHalfFov * aspect)
+        return 0.0f; // poza bokami frustum
+
+    distance = glm::max(distance, radius);
+    return radius / (distance * tanHalfFov) * viewportHeight;
+}
+
+// Funkcja wysyłająca do symulacji, które układy i czy cząstki są widoczne, przyjmuje parametry: ciała,
+// bieżący stan symulacji, macierz widoku, proporcje i wysokość okna
+// Układ planety jest istotny, gdy sfera z jej księżycami zajmuje na ekranie co najmniej lodPixels; ciała bez księżyców
+// są liczone zawsze. Polecenie idzie tylko przy zmianie, a gdy kolejka jest pełna, zostanie powtórzone w następnej klatce
+void updateRelevance(const BodyStore& bodies, const SimulationSnapshot& snapshot, const glm::mat4& view, float aspect, int viewportHeight) {
+    if (sentRelevance.empty())
+        return;
+    for (size_t i = 1; i < bodies.size(); ++i) {
+        if (bodies.parent[i] != 0 || systemExtents[i] <= bodies.radius[i])
+            continue;
+        glm::vec3 center(bodies.positionX[i], bodies.positionY[i], bodies.positionZ[i]);
+        signed char relevant = projectedDiameter(center, systemExtents[i], view, aspect, viewportHeight) >= lodPixels;
+        if (relevant != sentRelevance[i] && simulationThread.send({ SimulationCommandType::SetRelevance, (double)relevant, (int)i }))
+            sentRelevance[i] = relevant;
+    }
+
+    // Sfera cząstek obejmuje też drogę, którą przebędą do następnego kroku
+    if (snapshot.levelOfDetail && !snapshot.particles.empty()) {
+        const BoundingSphere& sphere = snapshot.lod.particleBounds;
+        glm::vec3 center(sphere.x, sphere.y, sphere.z);
+        signed char relevant = projectedDiameter(center, sphere.radius, view, aspect, viewportHeight) > 0.0f;
+        if (relevant != sentRelevance.back() && simulationThread.send({ SimulationCommandType::SetRelevance, (double)relevant, -1 }))
+            sentRelevance.back() = relevant;
+    }
+}
+// Funkcja mierząca pasy, przyjmuje parametry: największa liczba cząstek, szerokość i wysokość okna
+// Dla każdej liczby cząstek osobno liczenie pozycji na CPU oraz wysyłka z rysowaniem, z czekaniem na koniec pracy GPU,
+// i dla porównania orbity liczone w vertex shaderze
+void benchmarkBelts(size_t maxCount, int width, int height) {
+    FrameUniforms frame;
+    frame.view = glm::lookAt(glm::vec3(0.0f, 20.0f, 25.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    frame.projection = glm::perspective(glm::radians(45.0f), (float)width / (float)height, 0.1f, 100.0f);
+    frame.lightPos = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+    frame.lightColor = glm::vec4(1.0f);
+    glBindBuffer(GL_UNIFORM_BUFFER, frameUBO);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(FrameUniforms), &frame);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    std::vector<size_t> counts;
+    for (size_t count = 100000; count < maxCount; count *= 10) {
+        counts.push_back(count);
+    }
+    counts.push_back(maxCount);
+
+    std::cout << "Belt benchmark: " << workerCount() << " workers, " << orbitKernelName(orbitKernel()) << " kernel, "
+        << sizeof(BeltParticle) << " bytes per particle" << std::endl;
+    const int iterations = 10;
+    for (size_t count : counts) {
+        initializeBelts(belt, count);
+        beltRenderer.upload(belt);
+        beltPositions.resize(count * 3);
+
+        belt.evaluate(0.0, beltPositions.data());
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; ++i) {
+            belt.evaluate(1.0e4 + i / 60.0, beltPositions.data());
+        }
+        double evaluateMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / iterations;
+
+        beltRenderer.draw(beltPositions, glm::vec3(0.0f), width, height);
+        glFinish();
+        start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; ++i) {
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            beltRenderer.draw(beltPositions, glm::vec3(0.0f), width, height);
+            glFinish();
+        }
+        double drawMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / iterations;
+
+        beltRenderer.drawOrbits(0.0, glm::vec3(0.0f));
+        glFinish();
+        start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; ++i) {
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            beltRenderer.drawOrbits(1.0e4 + i / 60.0, glm::vec3(0.0f));
+            glFinish();
+        }
+        double shaderMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / iterations;
+
+        std::cout << "Belts " << count << ": " << belt.memoryBytes() / (1024.0 * 1024.0) << " MB, positions "
+            << evaluateMilliseconds << " ms (" << count / evaluateMilliseconds / 1000.0 << " M particles/s), upload and draw "
+            << drawMilliseconds << " ms (" << count / drawMilliseconds / 1000.0 << " M particles/s), frame "
+            << evaluateMilliseconds + drawMilliseconds << " ms; vertex shader orbits " << shaderMilliseconds << " ms ("
+            << count / shaderMilliseconds / 1000.0 << " M particles/s), no upload" << std::endl;
+    }
+}
@@ -0,0 +1,28 @@
+﻿#pragma once
+#include <cstddef>
+
+// Plik zmapowany w pamięci tylko do odczytu: system wczytuje strony dopiero przy pierwszym dostępie,
+// więc otwarcie dużego pliku nic nie kopiuje, a nieużywane fragmenty nie zajmują pamięci
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // Mapuje cały plik, zwraca false, gdy pliku nie ma albo jest pusty, przyjmuje parametr: ścieżka
+    bool open(const char* path);
+    void close();
+
+    const unsigned char* data() const { return bytes; }
+    size_t size() const { return length; }
+    bool isOpen() const { return bytes != nullptr; }
+
+private:
+    const unsigned char* bytes = nullptr;
+    size_t length = 0;
+#ifdef _WIN32
+    void* fileHandle = nullptr;
+    void* mappingHandle = nullptr;
+#endif
+};
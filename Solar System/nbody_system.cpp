@@ -0,0 +1,356 @@
+﻿#include "nbody_system.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include "orbit_kernel.h"
+#include "parallel.h"
+
+// Współczynniki Yoshidy: w1, w0, w1 z w0 ujemnym, suma równa 1
+static const double cubeRootTwo = 1.2599210498948732;
+static const double yoshidaOuter = 1.0 / (2.0 - cubeRootTwo);
+static const double yoshidaInner = -cubeRootTwo / (2.0 - cubeRootTwo);
+
+// Funkcja dodająca ciało, przyjmuje parametry: pozycja, prędkość, masa (GM) i ciało główne
+int NBodySystem::add(double x, double y, double z, double vx, double vy, double vz, double bodyMass, int primaryIndex) {
+    positionX.push_back(x);
+    positionY.push_back(y);
+    positionZ.push_back(z);
+    velocityX.push_back(vx);
+    velocityY.push_back(vy);
+    velocityZ.push_back(vz);
+    mass.push_back(bodyMass);
+    primary.push_back(primaryIndex);
+    stepLevel.push_back(0);
+    accelerationsValid = false;
+    scheduleValid = false;
+    initialValid = false;
+    return (int)size() - 1;
+}
+
+void NBodySystem::removeMomentum() {
+    double px = 0.0, py = 0.0, pz = 0.0, total = 0.0;
+    for (size_t i = 0; i < size(); ++i) {
+        px += mass[i] * velocityX[i];
+        py += mass[i] * velocityY[i];
+        pz += mass[i] * velocityZ[i];
+        total += mass[i];
+    }
+    if (total <= 0.0)
+        return;
+    for (size_t i = 0; i < size(); ++i) {
+        velocityX[i] -= px / total;
+        velocityY[i] -= py / total;
+        velocityZ[i] -= pz / total;
+    }
+    scheduleValid = false;
+    initialValid = false;
+}
+
+void NBodySystem::computeAccelerations() {
+    size_t count = size();
+    accelerationX.resize(count);
+    accelerationY.resize(count);
+    accelerationZ.resize(count);
+    gravity.accelerations(positionX.data(), positionY.data(), positionZ.data(), mass.data(), count,
+        accelerationX.data(), accelerationY.data(), accelerationZ.data());
+    accelerationsValid = true;
+}
+
+// Jeden krok żabki kick-drift-kick; przyspieszenia z końca kroku zostają na początek następnego,
+// przyjmuje parametr: długość kroku (ujemna w środkowym kroku Yoshidy)
+void NBodySystem::leapfrog(double dt) {
+    size_t count = size();
+    double halfStep = dt * 0.5;
+    for (size_t i = 0; i < count; ++i) {
+        velocityX[i] += accelerationX[i] * halfStep;
+        velocityY[i] += accelerationY[i] * halfStep;
+        velocityZ[i] += accelerationZ[i] * halfStep;
+        positionX[i] += velocityX[i] * dt;
+        positionY[i] += velocityY[i] * dt;
+        positionZ[i] += velocityZ[i] * dt;
+    }
+    computeAccelerations();
+    for (size_t i = 0; i < count; ++i) {
+        velocityX[i] += accelerationX[i] * halfStep;
+        velocityY[i] += accelerationY[i] * halfStep;
+        velocityZ[i] += accelerationZ[i] * halfStep;
+    }
+}
+
+// Funkcja wykonująca krok, przyjmuje parametr: długość kroku w sekundach
+void NBodySystem::step(double dt) {
+    if (size() == 0)
+        return;
+    auto start = std::chrono::steady_clock::now();
+    if (!accelerationsValid)
+        computeAccelerations();
+    if (trackInvariants && !initialValid)
+        resetDrift();
+
+    if (integrator == Integrator::Yoshida4) {
+        leapfrog(yoshidaOuter * dt);
+        leapfrog(yoshidaInner * dt);
+        leapfrog(yoshidaOuter * dt);
+        statistics.activeBodies = size();
+        statistics.forceEvaluations += 3.0 * size();
+    }
+    else if (integrator == Integrator::BlockLeapfrog) {
+        blockStep(dt);
+        statistics.forceEvaluations += (double)statistics.activeBodies;
+    }
+    else {
+        leapfrog(dt);
+        statistics.activeBodies = size();
+        statistics.forceEvaluations += (double)size();
+    }
+    statistics.stepMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    if (trackInvariants) {
+        NBodyInvariants current = invariants();
+        double energyScale = std::max(std::fabs(initial.energy), 1e-300);
+        double dLx = current.angularMomentumX - initial.angularMomentumX;
+        double dLy = current.angularMomentumY - initial.angularMomentumY;
+        double dLz = current.angularMomentumZ - initial.angularMomentumZ;
+        double L0 = std::sqrt(initial.angularMomentumX * initial.angularMomentumX + initial.angularMomentumY * initial.angularMomentumY
+            + initial.angularMomentumZ * initial.angularMomentumZ);
+        statistics.energy = std::fabs(current.energy - initial.energy) / energyScale;
+        statistics.energyStep = std::fabs(current.energy - lastEnergy) / energyScale;
+        statistics.maxEnergyStep = std::max(statistics.maxEnergyStep, statistics.energyStep);
+        statistics.angularMomentum = std::sqrt(dLx * dLx + dLy * dLy + dLz * dLz) / std::max(L0, 1e-300);
+        lastEnergy = current.energy;
+    }
+}
+
+// Poziom kroku z okresu orbity wokół ciała głównego, przyjmuje parametry: ciało i najkrótszy krok
+int NBodySystem::desiredLevel(size_t body, double dt) const {
+    int p = primary[body];
+    if (p < 0)
+        return 0; // Bez ciała głównego najbezpieczniej najkrótszy krok
+    double dx = positionX[body] - positionX[p], dy = positionY[body] - positionY[p], dz = positionZ[body] - positionZ[p];
+    double r = std::sqrt(dx * dx + dy * dy + dz * dz);
+    double period = 6.283185307179586 * std::sqrt(r * r * r / (mass[p] + mass[body]));
+    double allowed = period / blockSettings.stepsPerOrbit;
+    int level = 0;
+    while (level < blockSettings.maxLevel && std::fabs(dt) * (double)(2LL << level) <= allowed) {
+        ++level;
+    }
+    return level;
+}
+
+// Jeden najkrótszy krok żabki blokowej: wszystkie ciała przesuwane są co krok (to tanie O(N)),
+// a siły liczone i kopnięcia wykonywane tylko dla ciał, których krok właśnie się kończy.
+// Kopnięcie zamykające stary krok i otwierające nowy są połączone w jedno, przyjmuje parametr: najkrótszy krok
+void NBodySystem::blockStep(double dt) {
+    size_t count = size();
+    if (!scheduleValid || dt != blockDt) {
+        // Zmiana kroku (np. cofanie czasu): najpierw prędkości zsynchronizowane z bieżącą chwilą
+        // i przyspieszenia wszystkich ciał w tej chwili, a nie z początku ich kroków
+        if (scheduleValid) {
+            for (size_t i = 0; i < count; ++i) {
+                velocityAt(i, velocityX[i], velocityY[i], velocityZ[i]);
+            }
+            computeAccelerations();
+        }
+
+        // Start harmonogramu: wszystkie ciała zaczynają krok w chwili 0, gdzie każdy poziom jest wyrównany
+        blockDt = dt;
+        tick = 0;
+        for (size_t i = 0; i < count; ++i) {
+            stepLevel[i] = desiredLevel(i, dt);
+            double halfStep = 0.5 * dt * (double)(1LL << stepLevel[i]);
+            velocityX[i] += accelerationX[i] * halfStep;
+            velocityY[i] += accelerationY[i] * halfStep;
+            velocityZ[i] += accelerationZ[i] * halfStep;
+        }
+        scheduleValid = true;
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+        positionX[i] += velocityX[i] * dt;
+        positionY[i] += velocityY[i] * dt;
+        positionZ[i] += velocityZ[i] * dt;
+    }
+    ++tick;
+
+    active.clear();
+    for (size_t i = 0; i < count; ++i) {
+        if (tick % (1LL << stepLevel[i]) == 0)
+            active.push_back((int)i);
+    }
+    statistics.activeBodies = active.size();
+    if (active.empty())
+        return;
+
+    gravity.accelerations(positionX.data(), positionY.data(), positionZ.data(), mass.data(), count,
+        active.data(), active.size(), accelerationX.data(), accelerationY.data(), accelerationZ.data());
+    for (int i : active) {
+        double kick = 0.5 * dt * (double)(1LL << stepLevel[i]);
+
+        // Nowy poziom: krótszy zawsze wolno, dłuższy tylko gdy chwila jest wyrównana do jego granicy
+        int level = desiredLevel(i, dt);
+        while (level > stepLevel[i] && tick % (1LL << level) != 0) {
+            --level;
+        }
+        stepLevel[i] = level;
+        kick += 0.5 * dt * (double)(1LL << level);
+        velocityX[i] += accelerationX[i] * kick;
+        velocityY[i] += accelerationY[i] * kick;
+        velocityZ[i] += accelerationZ[i] * kick;
+    }
+}
+
+// Prędkość w bieżącej chwili; przy krokach blokowych zapisana prędkość jest z połowy kroku ciała,
+// więc cofamy ją o przyspieszenie z początku kroku, przyjmuje parametry: ciało i wyjście
+void NBodySystem::velocityAt(size_t body, double& vx, double& vy, double& vz) const {
+    vx = velocityX[body];
+    vy = velocityY[body];
+    vz = velocityZ[body];
+    if (integrator != Integrator::BlockLeapfrog || !scheduleValid)
+        return;
+    long long period = 1LL << stepLevel[body];
+    double shift = blockDt * ((double)(tick % period) - 0.5 * (double)period);
+    vx += accelerationX[body] * shift;
+    vy += accelerationY[body] * shift;
+    vz += accelerationZ[body] * shift;
+}
+
+NBodyInvariants NBodySystem::invariants() const {
+    size_t count = size();
+    double softening2 = (double)gravity.softening * gravity.softening;
+
+    // Energia potencjalna par i < j, wiersze rozdzielone między wątki z osobnymi sumami. Liczba sum częściowych
+    // nie zależy od liczby wątków i są dodawane po kolei, więc wynik jest ten sam przy każdej liczbie wątków
+    const size_t reductionChunks = 16;
+    size_t chunks = std::max<size_t>(1, std::min<size_t>(reductionChunks, count / 64));
+    std::vector<double> potential(chunks, 0.0);
+    parallelFor(chunks, 1, [&](size_t first, size_t last) {
+        for (size_t c = first; c < last; ++c) {
+            for (size_t i = c; i < count; i += chunks) {
+                double sum = 0.0;
+                for (size_t j = i + 1; j < count; ++j) {
+                    double dx = positionX[j] - positionX[i], dy = positionY[j] - positionY[i], dz = positionZ[j] - positionZ[i];
+                    double r2 = dx * dx + dy * dy + dz * dz + softening2;
+                    if (r2 > 0.0)
+                        sum += mass[j] / std::sqrt(r2);
+                }
+                potential[c] -= mass[i] * sum;
+            }
+        }
+    });
+
+    NBodyInvariants result;
+    for (double value : potential) {
+        result.energy += value;
+    }
+    for (size_t i = 0; i < count; ++i) {
+        double vx, vy, vz;
+        velocityAt(i, vx, vy, vz);
+        result.energy += 0.5 * mass[i] * (vx * vx + vy * vy + vz * vz);
+        result.angularMomentumX += mass[i] * (positionY[i] * vz - positionZ[i] * vy);
+        result.angularMomentumY += mass[i] * (positionZ[i] * vx - positionX[i] * vz);
+        result.angularMomentumZ += mass[i] * (positionX[i] * vy - positionY[i] * vx);
+    }
+    return result;
+}
+
+void NBodySystem::resetDrift() {
+    initial = invariants();
+    lastEnergy = initial.energy;
+    statistics = NBodyDrift();
+    initialValid = true;
+}
+
+// Układ testowy: ciężkie ciało centralne i lekkie ciała na orbitach prawie kołowych, przyjmuje parametry: układ i liczba ciał
+static void createTestSystem(NBodySystem& system, size_t count) {
+    std::mt19937 random(1234);
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    const double centralMass = 12.0;
+    system.add(0.0, 0.0, 0.0, 0.0, 0.0, 0.0, centralMass);
+    for (size_t i = 1; i < count; ++i) {
+        double r = 2.0 + 12.0 * unit(random);
+        double angle = 6.283185307179586 * unit(random);
+        double speed = std::sqrt(centralMass / r) * (1.0 + 0.05 * (unit(random) - 0.5));
+        double height = 0.05 * r * (unit(random) - 0.5);
+        system.add(r * std::cos(angle), height, r * std::sin(angle), -std::sin(angle) * speed, 0.0, std::cos(angle) * speed,
+            1e-6 + 1e-3 * unit(random) * unit(random) * unit(random), 0);
+    }
+    system.gravity.softening = 1e-3f;
+    system.removeMomentum();
+}
+
+// Funkcja mierząca jądro i metody całkowania, przyjmuje parametr: liczba ciał
+void benchmarkNBody(size_t count) {
+    count = std::max<size_t>(count, 2);
+    NBodySystem system;
+    createTestSystem(system, count);
+    std::vector<double> ax(count), ay(count), az(count);
+
+    // Wydajność jądra; dokładność względem sumy w podwójnej precyzji na próbce ciał
+    OrbitKernel previous = orbitKernel();
+    const OrbitKernel kernels[] = { OrbitKernel::Scalar, OrbitKernel::SSE2, OrbitKernel::AVX2, OrbitKernel::NEON };
+    for (OrbitKernel kernel : kernels) {
+        if (!setOrbitKernel(kernel))
+            continue;
+        const int iterations = 10;
+        system.gravity.accelerations(system.positionX.data(), system.positionY.data(), system.positionZ.data(), system.mass.data(),
+            count, ax.data(), ay.data(), az.data());
+        auto start = std::chrono::steady_clock::now();
+        for (int k = 0; k < iterations; ++k) {
+            system.gravity.accelerations(system.positionX.data(), system.positionY.data(), system.positionZ.data(), system.mass.data(),
+                count, ax.data(), ay.data(), az.data());
+        }
+        double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / iterations;
+
+        double maxError = 0.0;
+        double softening2 = (double)system.gravity.softening * system.gravity.softening;
+        for (size_t s = 0; s < std::min<size_t>(count, 64); ++s) {
+            size_t i = s * count / std::min<size_t>(count, 64);
+            double exact[3] = { 0.0, 0.0, 0.0 };
+            for (size_t j = 0; j < count; ++j) {
+                double dx = system.positionX[j] - system.positionX[i];
+                double dy = system.positionY[j] - system.positionY[i];
+                double dz = system.positionZ[j] - system.positionZ[i];
+                double r2 = dx * dx + dy * dy + dz * dz + softening2;
+                double inv = 1.0 / std::sqrt(r2);
+                double strength = j == i ? 0.0 : system.mass[j] * inv * inv * inv;
+                exact[0] += dx * strength;
+                exact[1] += dy * strength;
+                exact[2] += dz * strength;
+            }
+            double ex = ax[i] - exact[0], ey = ay[i] - exact[1], ez = az[i] - exact[2];
+            maxError = std::max(maxError, std::sqrt(ex * ex + ey * ey + ez * ez)
+                / std::sqrt(exact[0] * exact[0] + exact[1] * exact[1] + exact[2] * exact[2]));
+        }
+        double pairs = (double)count * count;
+        std::cout << orbitKernelName(kernel) << ": " << count << " bodies, " << milliseconds << " ms per evaluation, "
+            << pairs / (milliseconds * 1e6) << " G pairs/s, max relative error " << maxError << std::endl;
+    }
+    setOrbitKernel(previous);
+
+    // Dryf przez tę samą długość symulacji dla różnych kroków; najtańszy krok spełniający cel dokładności
+    // to ten z najmniejszym kosztem na sekundę symulacji i akceptowalnym dryfem
+    const double duration = 10.0;
+    const double steps[] = { 1.0 / 15.0, 1.0 / 30.0, 1.0 / 60.0, 1.0 / 120.0 };
+    const Integrator integrators[] = { Integrator::Leapfrog, Integrator::Yoshida4, Integrator::BlockLeapfrog };
+    const char* integratorNames[] = { "leapfrog", "Yoshida4", "block leapfrog" };
+    for (Integrator integrator : integrators) {
+        for (double dt : steps) {
+            NBodySystem run;
+            createTestSystem(run, count);
+            run.integrator = integrator;
+            int stepCount = (int)std::lround(duration / dt);
+            double milliseconds = 0.0;
+            for (int s = 0; s < stepCount; ++s) {
+                run.step(dt);
+                milliseconds += run.drift().stepMilliseconds;
+            }
+            std::cout << integratorNames[(int)integrator] << " dt = 1/" << std::lround(1.0 / dt)
+                << ": " << milliseconds / duration << " ms and " << run.drift().forceEvaluations / duration
+                << " force evaluations per simulated second, energy drift " << run.drift().energy
+                << " (max per step " << run.drift().maxEnergyStep << "), angular momentum drift " << run.drift().angularMomentum
+                << std::endl;
+        }
+    }
+}
@@ -0,0 +1,93 @@
+﻿#pragma once
+#include <cstddef>
+#include <vector>
+#include "direct_gravity.h"
+
+// Całkowanie symplektyczne: błąd energii nie narasta z czasem, tylko oscyluje
+enum class Integrator {
+    Leapfrog,      // Kick-drift-kick, 2. rząd, jedno liczenie sił na krok
+    Yoshida4,      // Złożenie trzech kroków żabki, 4. rząd, trzy liczenia sił na krok
+    BlockLeapfrog  // Żabka z krokami blokowymi: każde ciało ma własny krok dt * 2^poziom
+};
+
+// Ustawienia kroków blokowych
+struct BlockTimestepSettings {
+    int maxLevel = 8;              // Najdłuższy krok to dt * 2^maxLevel
+    double stepsPerOrbit = 256.0;  // Krok ciała nie dłuższy niż okres orbity wokół ciała głównego / stepsPerOrbit
+};
+
+// Wielkości zachowane układu: energia i moment pędu (masy jako GM, więc obie podzielone przez G)
+struct NBodyInvariants {
+    double energy = 0.0;
+    double angularMomentumX = 0.0;
+    double angularMomentumY = 0.0;
+    double angularMomentumZ = 0.0;
+};
+
+// Dryf wielkości zachowanych względem stanu początkowego
+struct NBodyDrift {
+    double energy = 0.0;          // |E - E0| / |E0|
+    double angularMomentum = 0.0; // |L - L0| / |L0|
+    double energyStep = 0.0;      // |E - E_poprzedni| / |E0| w ostatnim kroku
+    double maxEnergyStep = 0.0;   // Największa zmiana energii w jednym kroku
+    double stepMilliseconds = 0.0;
+    size_t activeBodies = 0;       // Ciała, dla których w ostatnim kroku liczono siły
+    double forceEvaluations = 0.0; // Łączna liczba ciał, dla których liczono siły, od resetDrift
+};
+
+// Ciała z masą przyciągające się nawzajem, siły z sumowania bezpośredniego, stan w podwójnej precyzji
+class NBodySystem {
+public:
+    std::vector<double> positionX, positionY, positionZ;
+    std::vector<double> velocityX, velocityY, velocityZ;
+    std::vector<double> mass; // GM
+    std::vector<int> primary;    // Ciało, wokół którego krąży (dla kroków blokowych), -1 gdy brak
+    std::vector<int> stepLevel;  // Ciało jest aktualizowane co 2^stepLevel kroków (tylko BlockLeapfrog)
+    Integrator integrator = Integrator::Yoshida4;
+    BlockTimestepSettings blockSettings;
+    DirectGravity gravity;
+    bool trackInvariants = true; // Liczenie energii co krok kosztuje drugie O(N^2)
+
+    size_t size() const { return mass.size(); }
+
+    // Dodaje ciało, zwraca jego indeks, przyjmuje parametry: pozycja, prędkość, masa (GM) i ciało główne
+    int add(double x, double y, double z, double vx, double vy, double vz, double bodyMass, int primaryIndex = -1);
+
+    // Zeruje całkowity pęd, żeby środek masy stał w miejscu
+    void removeMomentum();
+
+    // Wykonuje krok wybraną metodą, przyjmuje parametr: długość kroku w sekundach.
+    // Przy krokach blokowych dt jest najkrótszym krokiem i musi być stały
+    void step(double dt);
+
+    // Energia i moment pędu w podwójnej precyzji, O(N^2)
+    NBodyInvariants invariants() const;
+
+    const NBodyDrift& drift() const { return statistics; }
+    void resetDrift();
+
+private:
+    // Zapis i odtworzenie stanu integratora w trakcie kroków blokowych (checkpoint.cpp)
+    friend struct CheckpointAccess;
+
+    void computeAccelerations();
+    void leapfrog(double dt);
+    void blockStep(double dt);
+    int desiredLevel(size_t body, double dt) const;
+    void velocityAt(size_t body, double& vx, double& vy, double& vz) const;
+
+    std::vector<double> accelerationX, accelerationY, accelerationZ;
+    bool accelerationsValid = false;
+    bool scheduleValid = false;      // Poziomy ustalone i pierwsze pół kopnięcia wykonane
+    long long tick = 0;              // Liczba najkrótszych kroków od ustalenia poziomów
+    double blockDt = 0.0;
+    std::vector<int> active;
+    bool initialValid = false;
+    NBodyInvariants initial;
+    double lastEnergy = 0.0;
+    NBodyDrift statistics;
+};
+
+// Pomiar jądra sumowania bezpośredniego dla każdego wariantu SIMD i tabela dryfu energii i momentu pędu
+// dla obu metod i kilku długości kroku, wypisywane na std::cout, przyjmuje parametr: liczba ciał
+void benchmarkNBody(size_t count);
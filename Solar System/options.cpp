@@ -0,0 +1,36 @@
+﻿#include "options.h"
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+
+bool optionHasValue(int i, int argc, char** argv) {
+    return i + 1 < argc && (argv[i + 1][0] != '-' || isNumber(argv[i + 1]));
+}
+
+bool isNumber(const char* text) {
+    char* end = nullptr;
+    std::strtod(text, &end);
+    return end != text && *end == '\0';
+}
+
+double toNumber(const std::string& text) {
+    size_t used = 0;
+    double value = std::stod(text, &used);
+    if (used != text.size())
+        throw std::invalid_argument(text);
+    return value;
+}
+
+unsigned long long toCount(const std::string& text) {
+    if (text.empty() || text[0] == '-')
+        throw std::invalid_argument(text);
+    size_t used = 0;
+    unsigned long long value = std::stoull(text, &used);
+    if (used != text.size())
+        throw std::invalid_argument(text);
+    return value;
+}
+
+void printInvalidOption(const std::string& option) {
+    std::cout << "Invalid value for option: " << option << std::endl;
+}
@@ -0,0 +1,19 @@
+﻿#pragma once
+#include <string>
+
+// Wspólne odczytywanie opcji wiersza poleceń okna i symulacji bez okna
+
+// Funkcja sprawdzająca, czy po opcji i stoi jej wartość, przyjmuje parametry: indeks opcji, argc i argv.
+// Argument zaczynający się od '-' jest wartością tylko wtedy, gdy jest liczbą (np. --time -3600)
+bool optionHasValue(int i, int argc, char** argv);
+
+// Funkcja sprawdzająca, czy cały tekst jest liczbą, przyjmuje parametr: tekst
+bool isNumber(const char* text);
+
+// Funkcje zamieniające wartość opcji na liczbę, przyjmują parametr: tekst; rzucają std::invalid_argument
+// albo std::out_of_range, gdy tekst nie jest w całości liczbą (liczbą nieujemną dla toCount)
+double toNumber(const std::string& text);
+unsigned long long toCount(const std::string& text);
+
+// Komunikat o błędnej wartości, taki sam w obu programach, przyjmuje parametr: nazwa opcji
+void printInvalidOption(const std::string& option);
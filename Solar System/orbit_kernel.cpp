@@ -0,0 +1,541 @@
+﻿#include "orbit_kernel.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <vector>
+#include "simd.h"
+
+// Stałe sinusa i cosinusa pojedynczej precyzji (wielomiany minimaksowe z biblioteki Cephes):
+// redukcja do przedziału -pi/4..pi/4 w trzech częściach, żeby nie tracić dokładności
+static const float fourOverPi = 1.27323954473516f;
+static const float dp1 = 0.78515625f;
+static const float dp2 = 2.4187564849853515625e-4f;
+static const float dp3 = 3.77489497744594108e-8f;
+static const float sinC0 = -1.9515295891e-4f;
+static const float sinC1 = 8.3321608736e-3f;
+static const float sinC2 = -1.6666654611e-1f;
+static const float cosC0 = 2.443315711809948e-5f;
+static const float cosC1 = -1.388731625493765e-3f;
+static const float cosC2 = 4.166664568298827e-2f;
+static const float twoPi = 6.28318530717958647692f;
+static const double twoPiDouble = 6.28318530717958647692;
+static const double invTwoPiDouble = 0.159154943091895335769;
+static const double roundingBias = 6755399441055744.0; // 1.5 * 2^52: x + bias - bias zaokrągla do całkowitej
+
+// Sinus i cosinus jednej wartości, te same wielomiany co w wariantach wektorowych, przyjmuje parametr: kąt w radianach
+static inline void sincosScalar(float x, float& sine, float& cosine) {
+    bool negative = x < 0.0f;
+    x = fabsf(x);
+    int j = (int)(x * fourOverPi);
+    j = (j + 1) & ~1;
+    float y = (float)j;
+    float r = ((x - y * dp1) - y * dp2) - y * dp3;
+    float z = r * r;
+    float sinPoly = ((sinC0 * z + sinC1) * z + sinC2) * z * r + r;
+    float cosPoly = ((cosC0 * z + cosC1) * z + cosC2) * z * z - 0.5f * z + 1.0f;
+
+    // Ćwiartka wybiera wielomian i znak
+    bool swap = (j & 2) != 0;
+    float s = swap ? cosPoly : sinPoly;
+    float c = swap ? sinPoly : cosPoly;
+    sine = ((j & 4) != 0) != negative ? -s : s;
+    cosine = ((j + 2) & 4) ? -c : c;
+}
+
+// Rozwiązuje równanie Keplera, zwraca sin E i cos E, przyjmuje parametry: anomalia średnia i mimośród
+static inline void solveKeplerScalar(float M, float e, float& sinE, float& cosE) {
+    float s, c;
+    sincosScalar(M, s, c);
+    float E = M + e * s * (1.0f + e * c);
+    float delta = 0.0f;
+    for (int k = 0; k < keplerIterations; ++k) {
+        sincosScalar(E, s, c);
+        delta = (E - e * s - M) / (1.0f - e * c);
+        E -= delta;
+    }
+    // Ostatnia poprawka jest mała, więc sin i cos poprawiamy liniowo zamiast liczyć od nowa
+    sinE = s - delta * c;
+    cosE = c + delta * s;
+}
+
+// Anomalia średnia w chwili time w podwójnej precyzji, zawinięta do -pi..pi, przyjmuje parametry: M0, n i czas
+static inline float meanAnomalyAt(double epochAnomaly, double meanMotion, double time) {
+    double M = epochAnomaly + meanMotion * time;
+    return (float)(M - twoPiDouble * std::nearbyint(M * invTwoPiDouble));
+}
+
+static void evaluateScalar(const OrbitArrays& o, size_t begin, double time) {
+    for (size_t i = begin; i < o.count; ++i) {
+        float M = meanAnomalyAt(o.epochAnomaly[i], o.meanMotion[i], time);
+        o.meanAnomaly[i] = M;
+
+        float e = o.eccentricity[i];
+        float sinE, cosE;
+        solveKeplerScalar(M, e, sinE, cosE);
+        float u = cosE - e;
+        o.x[i] = u * o.periapsisX[i] + sinE * o.minorAxisX[i];
+        o.y[i] = u * o.periapsisY[i] + sinE * o.minorAxisY[i];
+        o.z[i] = u * o.periapsisZ[i] + sinE * o.minorAxisZ[i];
+    }
+}
+
+static void sincosBatchScalar(const float* angle, float* sine, float* cosine, size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+        sincosScalar(angle[i], sine[i], cosine[i]);
+    }
+}
+
+#ifdef SIMD_X86
+// SSE2 jest zawsze dostępne na x86-64
+static inline void sincos4(__m128 x, __m128& sine, __m128& cosine) {
+    const __m128i one = _mm_set1_epi32(1);
+    const __m128i two = _mm_set1_epi32(2);
+    const __m128i four = _mm_set1_epi32(4);
+    const __m128 signMask = _mm_set1_ps(-0.0f);
+
+    __m128 inputSign = _mm_and_ps(x, signMask);
+    x = _mm_andnot_ps(signMask, x);
+    __m128i j = _mm_cvttps_epi32(_mm_mul_ps(x, _mm_set1_ps(fourOverPi)));
+    j = _mm_andnot_si128(one, _mm_add_epi32(j, one));
+    __m128 y = _mm_cvtepi32_ps(j);
+    __m128 r = _mm_sub_ps(x, _mm_mul_ps(y, _mm_set1_ps(dp1)));
+    r = _mm_sub_ps(r, _mm_mul_ps(y, _mm_set1_ps(dp2)));
+    r = _mm_sub_ps(r, _mm_mul_ps(y, _mm_set1_ps(dp3)));
+    __m128 z = _mm_mul_ps(r, r);
+
+    __m128 sinPoly = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(sinC0), z), _mm_set1_ps(sinC1));
+    sinPoly = _mm_add_ps(_mm_mul_ps(sinPoly, z), _mm_set1_ps(sinC2));
+    sinPoly = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(sinPoly, z), r), r);
+    __m128 cosPoly = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(cosC0), z), _mm_set1_ps(cosC1));
+    cosPoly = _mm_add_ps(_mm_mul_ps(cosPoly, z), _mm_set1_ps(cosC2));
+    cosPoly = _mm_mul_ps(_mm_mul_ps(cosPoly, z), z);
+    cosPoly = _mm_add_ps(_mm_sub_ps(cosPoly, _mm_mul_ps(_mm_set1_ps(0.5f), z)), _mm_set1_ps(1.0f));
+
+    __m128 swap = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(j, two), two));
+    __m128 s = _mm_or_ps(_mm_and_ps(swap, cosPoly), _mm_andnot_ps(swap, sinPoly));
+    __m128 c = _mm_or_ps(_mm_and_ps(swap, sinPoly), _mm_andnot_ps(swap, cosPoly));
+    __m128 sinSign = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(j, four), 29));
+    __m128 cosSign = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(_mm_add_epi32(j, two), four), 29));
+    sine = _mm_xor_ps(_mm_xor_ps(s, sinSign), inputSign);
+    cosine = _mm_xor_ps(c, cosSign);
+}
+
+static inline void solveKepler4(__m128 M, __m128 e, __m128& sinE, __m128& cosE) {
+    const __m128 one = _mm_set1_ps(1.0f);
+    __m128 s, c;
+    sincos4(M, s, c);
+    __m128 E = _mm_add_ps(M, _mm_mul_ps(_mm_mul_ps(e, s), _mm_add_ps(one, _mm_mul_ps(e, c))));
+    __m128 delta = _mm_setzero_ps();
+    for (int k = 0; k < keplerIterations; ++k) {
+        sincos4(E, s, c);
+        __m128 f = _mm_sub_ps(_mm_sub_ps(E, _mm_mul_ps(e, s)), M);
+        delta = _mm_div_ps(f, _mm_sub_ps(one, _mm_mul_ps(e, c)));
+        E = _mm_sub_ps(E, delta);
+    }
+    sinE = _mm_sub_ps(s, _mm_mul_ps(delta, c));
+    cosE = _mm_add_ps(c, _mm_mul_ps(delta, s));
+}
+
+// Dwie anomalie średnie w podwójnej precyzji, zawinięte do -pi..pi; SSE2 nie ma zaokrąglania double, więc przez bias
+static inline __m128d meanAnomaly2(const OrbitArrays& o, size_t i, __m128d time) {
+    __m128d M = _mm_add_pd(_mm_loadu_pd(o.epochAnomaly + i), _mm_mul_pd(_mm_loadu_pd(o.meanMotion + i), time));
+    const __m128d bias = _mm_set1_pd(roundingBias);
+    __m128d turns = _mm_sub_pd(_mm_add_pd(_mm_mul_pd(M, _mm_set1_pd(invTwoPiDouble)), bias), bias);
+    return _mm_sub_pd(M, _mm_mul_pd(turns, _mm_set1_pd(twoPiDouble)));
+}
+
+static void evaluateSSE2(const OrbitArrays& o, double time) {
+    const __m128d t = _mm_set1_pd(time);
+    size_t i = 0;
+    for (; i + 4 <= o.count; i += 4) {
+        __m128 M = _mm_movelh_ps(_mm_cvtpd_ps(meanAnomaly2(o, i, t)), _mm_cvtpd_ps(meanAnomaly2(o, i + 2, t)));
+        _mm_storeu_ps(o.meanAnomaly + i, M);
+
+        __m128 e = _mm_loadu_ps(o.eccentricity + i);
+        __m128 sinE, cosE;
+        solveKepler4(M, e, sinE, cosE);
+        __m128 u = _mm_sub_ps(cosE, e);
+        _mm_storeu_ps(o.x + i, _mm_add_ps(_mm_mul_ps(u, _mm_loadu_ps(o.periapsisX + i)), _mm_mul_ps(sinE, _mm_loadu_ps(o.minorAxisX + i))));
+        _mm_storeu_ps(o.y + i, _mm_add_ps(_mm_mul_ps(u, _mm_loadu_ps(o.periapsisY + i)), _mm_mul_ps(sinE, _mm_loadu_ps(o.minorAxisY + i))));
+        _mm_storeu_ps(o.z + i, _mm_add_ps(_mm_mul_ps(u, _mm_loadu_ps(o.periapsisZ + i)), _mm_mul_ps(sinE, _mm_loadu_ps(o.minorAxisZ + i))));
+    }
+    evaluateScalar(o, i, time);
+}
+
+static void sincosBatchSSE2(const float* angle, float* sine, float* cosine, size_t count) {
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128 s, c;
+        sincos4(_mm_loadu_ps(angle + i), s, c);
+        _mm_storeu_ps(sine + i, s);
+        _mm_storeu_ps(cosine + i, c);
+    }
+    sincosBatchScalar(angle, sine, cosine, i, count);
+}
+
+TARGET_AVX2 static inline void sincos8(__m256 x, __m256& sine, __m256& cosine) {
+    const __m256i one = _mm256_set1_epi32(1);
+    const __m256i two = _mm256_set1_epi32(2);
+    const __m256i four = _mm256_set1_epi32(4);
+    const __m256 signMask = _mm256_set1_ps(-0.0f);
+
+    __m256 inputSign = _mm256_and_ps(x, signMask);
+    x = _mm256_andnot_ps(signMask, x);
+    __m256i j = _mm256_cvttps_epi32(_mm256_mul_ps(x, _mm256_set1_ps(fourOverPi)));
+    j = _mm256_andnot_si256(one, _mm256_add_epi32(j, one));
+    __m256 y = _mm256_cvtepi32_ps(j);
+    __m256 r = _mm256_fnmadd_ps(y, _mm256_set1_ps(dp1), x);
+    r = _mm256_fnmadd_ps(y, _mm256_set1_ps(dp2), r);
+    r = _mm256_fnmadd_ps(y, _mm256_set1_ps(dp3), r);
+    __m256 z = _mm256_mul_ps(r, r);
+
+    __m256 sinPoly = _mm256_fmadd_ps(_mm256_set1_ps(sinC0), z, _mm256_set1_ps(sinC1));
+    sinPoly = _mm256_fmadd_ps(sinPoly, z, _mm256_set1_ps(sinC2));
+    sinPoly = _mm256_fmadd_ps(_mm256_mul_ps(sinPoly, z), r, r);
+    __m256 cosPoly = _mm256_fmadd_ps(_mm256_set1_ps(cosC0), z, _mm256_set1_ps(cosC1));
+    cosPoly = _mm256_fmadd_ps(cosPoly, z, _mm256_set1_ps(cosC2));
+    cosPoly = _mm256_mul_ps(_mm256_mul_ps(cosPoly, z), z);
+    cosPoly = _mm256_add_ps(_mm256_fnmadd_ps(_mm256_set1_ps(0.5f), z, cosPoly), _mm256_set1_ps(1.0f));
+
+    __m256 swap = _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(j, two), two));
+    __m256 s = _mm256_blendv_ps(sinPoly, cosPoly, swap);
+    __m256 c = _mm256_blendv_ps(cosPoly, sinPoly, swap);
+    __m256 sinSign = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(j, four), 29));
+    __m256 cosSign = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(_mm256_add_epi32(j, two), four), 29));
+    sine = _mm256_xor_ps(_mm256_xor_ps(s, sinSign), inputSign);
+    cosine = _mm256_xor_ps(c, cosSign);
+}
+
+TARGET_AVX2 static inline void solveKepler8(__m256 M, __m256 e, __m256& sinE, __m256& cosE) {
+    const __m256 one = _mm256_set1_ps(1.0f);
+    __m256 s, c;
+    sincos8(M, s, c);
+    __m256 E = _mm256_fmadd_ps(_mm256_mul_ps(e, s), _mm256_fmadd_ps(e, c, one), M);
+    __m256 delta = _mm256_setzero_ps();
+    for (int k = 0; k < keplerIterations; ++k) {
+        sincos8(E, s, c);
+        __m256 f = _mm256_sub_ps(_mm256_fnmadd_ps(e, s, E), M);
+        delta = _mm256_div_ps(f, _mm256_fnmadd_ps(e, c, one));
+        E = _mm256_sub_ps(E, delta);
+    }
+    sinE = _mm256_fnmadd_ps(delta, c, s);
+    cosE = _mm256_fmadd_ps(delta, s, c);
+}
+
+// Cztery anomalie średnie w podwójnej precyzji, zawinięte do -pi..pi
+TARGET_AVX2 static inline __m128 meanAnomaly4(const OrbitArrays& o, size_t i, __m256d time) {
+    __m256d M = _mm256_fmadd_pd(_mm256_loadu_pd(o.meanMotion + i), time, _mm256_loadu_pd(o.epochAnomaly + i));
+    __m256d turns = _mm256_round_pd(_mm256_mul_pd(M, _mm256_set1_pd(invTwoPiDouble)), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    return _mm256_cvtpd_ps(_mm256_fnmadd_pd(turns, _mm256_set1_pd(twoPiDouble), M));
+}
+
+TARGET_AVX2 static void evaluateAVX2(const OrbitArrays& o, double time) {
+    const __m256d t = _mm256_set1_pd(time);
+    size_t i = 0;
+    for (; i + 8 <= o.count; i += 8) {
+        __m256 M = _mm256_set_m128(meanAnomaly4(o, i + 4, t), meanAnomaly4(o, i, t));
+        _mm256_storeu_ps(o.meanAnomaly + i, M);
+
+        __m256 e = _mm256_loadu_ps(o.eccentricity + i);
+        __m256 sinE, cosE;
+        solveKepler8(M, e, sinE, cosE);
+        __m256 u = _mm256_sub_ps(cosE, e);
+        _mm256_storeu_ps(o.x + i, _mm256_fmadd_ps(u, _mm256_loadu_ps(o.periapsisX + i), _mm256_mul_ps(sinE, _mm256_loadu_ps(o.minorAxisX + i))));
+        _mm256_storeu_ps(o.y + i, _mm256_fmadd_ps(u, _mm256_loadu_ps(o.periapsisY + i), _mm256_mul_ps(sinE, _mm256_loadu_ps(o.minorAxisY + i))));
+        _mm256_storeu_ps(o.z + i, _mm256_fmadd_ps(u, _mm256_loadu_ps(o.periapsisZ + i), _mm256_mul_ps(sinE, _mm256_loadu_ps(o.minorAxisZ + i))));
+    }
+    evaluateScalar(o, i, time);
+}
+
+TARGET_AVX2 static void sincosBatchAVX2(const float* angle, float* sine, float* cosine, size_t count) {
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256 s, c;
+        sincos8(_mm256_loadu_ps(angle + i), s, c);
+        _mm256_storeu_ps(sine + i, s);
+        _mm256_storeu_ps(cosine + i, c);
+    }
+    sincosBatchScalar(angle, sine, cosine, i, count);
+}
+
+// Sprawdza AVX2 i FMA oraz to, czy system zapisuje rejestry YMM przy przełączaniu wątków
+static bool cpuHasAVX2() {
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 1);
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    bool avx = (info[2] & (1 << 28)) != 0;
+    bool fma = (info[2] & (1 << 12)) != 0;
+    if (!osxsave || !avx || !fma || (_xgetbv(0) & 6) != 6)
+        return false;
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#endif
+}
+#endif
+
+#ifdef SIMD_NEON
+static inline void sincos4(float32x4_t x, float32x4_t& sine, float32x4_t& cosine) {
+    const int32x4_t one = vdupq_n_s32(1);
+    const int32x4_t two = vdupq_n_s32(2);
+    const int32x4_t four = vdupq_n_s32(4);
+
+    uint32x4_t inputSign = vandq_u32(vreinterpretq_u32_f32(x), vdupq_n_u32(0x80000000u));
+    x = vabsq_f32(x);
+    int32x4_t j = vcvtq_s32_f32(vmulq_n_f32(x, fourOverPi));
+    j = vbicq_s32(vaddq_s32(j, one), one);
+    float32x4_t y = vcvtq_f32_s32(j);
+    float32x4_t r = vmlsq_n_f32(x, y, dp1);
+    r = vmlsq_n_f32(r, y, dp2);
+    r = vmlsq_n_f32(r, y, dp3);
+    float32x4_t z = vmulq_f32(r, r);
+
+    float32x4_t sinPoly = vmlaq_n_f32(vdupq_n_f32(sinC1), z, sinC0);
+    sinPoly = vmlaq_f32(vdupq_n_f32(sinC2), sinPoly, z);
+    sinPoly = vmlaq_f32(r, vmulq_f32(sinPoly, z), r);
+    float32x4_t cosPoly = vmlaq_n_f32(vdupq_n_f32(cosC1), z, cosC0);
+    cosPoly = vmlaq_f32(vdupq_n_f32(cosC2), cosPoly, z);
+    cosPoly = vmulq_f32(vmulq_f32(cosPoly, z), z);
+    cosPoly = vaddq_f32(vmlsq_n_f32(cosPoly, z, 0.5f), vdupq_n_f32(1.0f));
+
+    uint32x4_t swap = vceqq_s32(vandq_s32(j, two), two);
+    float32x4_t s = vbslq_f32(swap, cosPoly, sinPoly);
+    float32x4_t c = vbslq_f32(swap, sinPoly, cosPoly);
+    uint32x4_t sinSign = veorq_u32(vreinterpretq_u32_s32(vshlq_n_s32(vandq_s32(j, four), 29)), inputSign);
+    uint32x4_t cosSign = vreinterpretq_u32_s32(vshlq_n_s32(vandq_s32(vaddq_s32(j, two), four), 29));
+    sine = vreinterpretq_f32_u32(veorq_u32(vreinterpretq_u32_f32(s), sinSign));
+    cosine = vreinterpretq_f32_u32(veorq_u32(vreinterpretq_u32_f32(c), cosSign));
+}
+
+static inline void solveKepler4(float32x4_t M, float32x4_t e, float32x4_t& sinE, float32x4_t& cosE) {
+    const float32x4_t one = vdupq_n_f32(1.0f);
+    float32x4_t s, c;
+    sincos4(M, s, c);
+    float32x4_t E = vmlaq_f32(M, vmulq_f32(e, s), vmlaq_f32(one, e, c));
+    float32x4_t delta = vdupq_n_f32(0.0f);
+    for (int k = 0; k < keplerIterations; ++k) {
+        sincos4(E, s, c);
+        float32x4_t f = vsubq_f32(vmlsq_f32(E, e, s), M);
+        delta = vdivq_f32(f, vmlsq_f32(one, e, c));
+        E = vsubq_f32(E, delta);
+    }
+    sinE = vmlsq_f32(s, delta, c);
+    cosE = vmlaq_f32(c, delta, s);
+}
+
+// Dwie anomalie średnie w podwójnej precyzji, zawinięte do -pi..pi
+static inline float32x2_t meanAnomaly2(const OrbitArrays& o, size_t i, double time) {
+    float64x2_t M = vfmaq_n_f64(vld1q_f64(o.epochAnomaly + i), vld1q_f64(o.meanMotion + i), time);
+    float64x2_t turns = vrndnq_f64(vmulq_n_f64(M, invTwoPiDouble));
+    return vcvt_f32_f64(vfmsq_n_f64(M, turns, twoPiDouble));
+}
+
+static void evaluateNEON(const OrbitArrays& o, double time) {
+    size_t i = 0;
+    for (; i + 4 <= o.count; i += 4) {
+        float32x4_t M = vcombine_f32(meanAnomaly2(o, i, time), meanAnomaly2(o, i + 2, time));
+        vst1q_f32(o.meanAnomaly + i, M);
+
+        float32x4_t e = vld1q_f32(o.eccentricity + i);
+        float32x4_t sinE, cosE;
+        solveKepler4(M, e, sinE, cosE);
+        float32x4_t u = vsubq_f32(cosE, e);
+        vst1q_f32(o.x + i, vmlaq_f32(vmulq_f32(sinE, vld1q_f32(o.minorAxisX + i)), u, vld1q_f32(o.periapsisX + i)));
+        vst1q_f32(o.y + i, vmlaq_f32(vmulq_f32(sinE, vld1q_f32(o.minorAxisY + i)), u, vld1q_f32(o.periapsisY + i)));
+        vst1q_f32(o.z + i, vmlaq_f32(vmulq_f32(sinE, vld1q_f32(o.minorAxisZ + i)), u, vld1q_f32(o.periapsisZ + i)));
+    }
+    evaluateScalar(o, i, time);
+}
+
+static void sincosBatchNEON(const float* angle, float* sine, float* cosine, size_t count) {
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        float32x4_t s, c;
+        sincos4(vld1q_f32(angle + i), s, c);
+        vst1q_f32(sine + i, s);
+        vst1q_f32(cosine + i, c);
+    }
+    sincosBatchScalar(angle, sine, cosine, i, count);
+}
+#endif
+
+static bool kernelSupported(OrbitKernel kernel) {
+    switch (kernel) {
+    case OrbitKernel::Scalar:
+        return true;
+#ifdef SIMD_X86
+    case OrbitKernel::SSE2:
+        return true;
+    case OrbitKernel::AVX2:
+        return cpuHasAVX2();
+#endif
+#ifdef SIMD_NEON
+    case OrbitKernel::NEON:
+        return true;
+#endif
+    default:
+        return false;
+    }
+}
+
+OrbitKernel bestOrbitKernel() {
+    static const OrbitKernel best = kernelSupported(OrbitKernel::AVX2) ? OrbitKernel::AVX2
+        : kernelSupported(OrbitKernel::NEON) ? OrbitKernel::NEON
+        : kernelSupported(OrbitKernel::SSE2) ? OrbitKernel::SSE2
+        : OrbitKernel::Scalar;
+    return best;
+}
+
+static OrbitKernel activeKernel = bestOrbitKernel();
+
+OrbitKernel orbitKernel() {
+    return activeKernel;
+}
+
+bool setOrbitKernel(OrbitKernel kernel) {
+    if (!kernelSupported(kernel))
+        return false;
+    activeKernel = kernel;
+    return true;
+}
+
+const char* orbitKernelName(OrbitKernel kernel) {
+    switch (kernel) {
+    case OrbitKernel::SSE2: return "SSE2";
+    case OrbitKernel::AVX2: return "AVX2";
+    case OrbitKernel::NEON: return "NEON";
+    default: return "scalar";
+    }
+}
+
+// Funkcja liczącą pozycje aktywnym wariantem jądra, przyjmuje parametry: tablice orbit i czas symulacji
+void evaluateOrbits(const OrbitArrays& orbits, double time) {
+    switch (activeKernel) {
+#ifdef SIMD_X86
+    case OrbitKernel::AVX2:
+        evaluateAVX2(orbits, time);
+        return;
+    case OrbitKernel::SSE2:
+        evaluateSSE2(orbits, time);
+        return;
+#endif
+#ifdef SIMD_NEON
+    case OrbitKernel::NEON:
+        evaluateNEON(orbits, time);
+        return;
+#endif
+    default:
+        evaluateScalar(orbits, 0, time);
+    }
+}
+
+void sincosBatch(const float* angle, float* sine, float* cosine, size_t count) {
+    switch (activeKernel) {
+#ifdef SIMD_X86
+    case OrbitKernel::AVX2:
+        sincosBatchAVX2(angle, sine, cosine, count);
+        return;
+    case OrbitKernel::SSE2:
+        sincosBatchSSE2(angle, sine, cosine, count);
+        return;
+#endif
+#ifdef SIMD_NEON
+    case OrbitKernel::NEON:
+        sincosBatchNEON(angle, sine, cosine, count);
+        return;
+#endif
+    default:
+        sincosBatchScalar(angle, sine, cosine, 0, count);
+    }
+}
+
+// Funkcja mierząca wydajność wariantów jądra, przyjmuje parametr: liczba ciał
+void benchmarkOrbitKernels(size_t count) {
+    std::mt19937 random(1234);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+    // Losowe orbity z mimośrodem do 0.9 i dowolnym nachyleniem
+    std::vector<double> epochAnomaly(count), meanMotion(count);
+    std::vector<float> meanAnomaly(count), eccentricity(count);
+    std::vector<float> periapsis[3], minorAxis[3], position[3];
+    for (int k = 0; k < 3; ++k) {
+        periapsis[k].resize(count);
+        minorAxis[k].resize(count);
+        position[k].resize(count);
+    }
+    for (size_t i = 0; i < count; ++i) {
+        epochAnomaly[i] = twoPi * unit(random);
+        meanMotion[i] = 4.0f * unit(random) - 2.0f;
+        eccentricity[i] = 0.9f * unit(random);
+        float a = 0.1f + 40.0f * unit(random);
+        float b = a * std::sqrt(1.0f - eccentricity[i] * eccentricity[i]);
+        float node = twoPi * unit(random);
+        float tilt = 3.14159265f * unit(random);
+        periapsis[0][i] = a * std::cos(node);
+        periapsis[2][i] = a * std::sin(node);
+        minorAxis[0][i] = -b * std::sin(node) * std::cos(tilt);
+        minorAxis[1][i] = b * std::sin(tilt);
+        minorAxis[2][i] = b * std::cos(node) * std::cos(tilt);
+    }
+    OrbitArrays orbits = { epochAnomaly.data(), meanMotion.data(), eccentricity.data(),
+        periapsis[0].data(), periapsis[1].data(), periapsis[2].data(),
+        minorAxis[0].data(), minorAxis[1].data(), minorAxis[2].data(),
+        meanAnomaly.data(), position[0].data(), position[1].data(), position[2].data(), count };
+
+    // Dokładność sinusa i cosinusa w całym zakresie 0..2pi
+    const size_t samples = 1 << 20;
+    std::vector<float> samplesAngle(samples), sine(samples), cosine(samples);
+    for (size_t i = 0; i < samples; ++i) {
+        samplesAngle[i] = twoPi * (float)i / samples;
+    }
+
+    OrbitKernel previous = activeKernel;
+    const OrbitKernel kernels[] = { OrbitKernel::Scalar, OrbitKernel::SSE2, OrbitKernel::AVX2, OrbitKernel::NEON };
+    for (OrbitKernel kernel : kernels) {
+        if (!setOrbitKernel(kernel))
+            continue;
+
+        sincosBatch(samplesAngle.data(), sine.data(), cosine.data(), samples);
+        double maxError = 0.0;
+        for (size_t i = 0; i < samples; ++i) {
+            maxError = std::max(maxError, std::fabs(sine[i] - std::sin((double)samplesAngle[i])));
+            maxError = std::max(maxError, std::fabs(cosine[i] - std::cos((double)samplesAngle[i])));
+        }
+
+        // Późna chwila, żeby sprawdzić też zawijanie dużych kątów
+        const int iterations = 20;
+        const double time = 1.0e7;
+        evaluateOrbits(orbits, time);
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; ++i) {
+            evaluateOrbits(orbits, time + i / 60.0);
+        }
+        double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / iterations;
+
+        // Reszta równania Keplera dla ostatniej chwili, liczona w podwójnej precyzji z pozycji w płaszczyźnie orbity,
+        // i błąd samej anomalii średniej względem M0 + n * t
+        double maxResidual = 0.0, maxAnomalyError = 0.0;
+        for (size_t i = 0; i < count; i += 97) {
+            double a = std::sqrt((double)periapsis[0][i] * periapsis[0][i] + (double)periapsis[2][i] * periapsis[2][i]);
+            double b = a * std::sqrt(1.0 - (double)eccentricity[i] * eccentricity[i]);
+            double u = (position[0][i] * (double)periapsis[0][i] + position[2][i] * (double)periapsis[2][i]) / (a * a);
+            double v = (position[0][i] * (double)minorAxis[0][i] + position[1][i] * (double)minorAxis[1][i] + position[2][i] * (double)minorAxis[2][i]) / (b * b);
+            double E = std::atan2(v, u + eccentricity[i]);
+            double M = E - eccentricity[i] * std::sin(E);
+            double residual = std::fabs(std::remainder(M - meanAnomaly[i], 2.0 * 3.14159265358979323846));
+            maxResidual = std::max(maxResidual, residual);
+            double exact = epochAnomaly[i] + meanMotion[i] * (time + (iterations - 1) / 60.0);
+            maxAnomalyError = std::max(maxAnomalyError, std::fabs(std::remainder(exact - meanAnomaly[i], 2.0 * 3.14159265358979323846)));
+        }
+
+        std::cout << orbitKernelName(kernel) << ": " << count << " orbits in " << milliseconds << " ms ("
+            << milliseconds * 1e6 / count << " ns/body), max sin/cos error " << maxError
+            << ", max Kepler residual " << maxResidual << ", max mean anomaly error at t = 1e7 s " << maxAnomalyError << std::endl;
+    }
+    activeKernel = previous;
+}
@@ -0,0 +1,53 @@
+﻿#pragma once
+#include <cstddef>
+
+// Wariant jądra propagacji orbit wybierany przy starcie na podstawie możliwości procesora
+enum class OrbitKernel {
+    Scalar, // Po jednym ciele, zawsze dostępny
+    SSE2,   // 4 ciała naraz (x86-64)
+    AVX2,   // 8 ciał naraz, z FMA
+    NEON    // 4 ciała naraz (ARM64)
+};
+
+// Tablice wejściowe i wyjściowe jądra orbit keplerowskich, wszystkie o długości count
+struct OrbitArrays {
+    const double* epochAnomaly; // Anomalia średnia M0 w chwili 0, w radianach
+    const double* meanMotion;   // Ruch średni n w radianach na sekundę
+    const float* eccentricity;
+    const float* periapsisX; // a * P: kierunek perycentrum razy półoś wielka
+    const float* periapsisY;
+    const float* periapsisZ;
+    const float* minorAxisX; // b * Q: kierunek prostopadły w płaszczyźnie orbity razy półoś mała
+    const float* minorAxisY;
+    const float* minorAxisZ;
+    float* meanAnomaly;      // Wyjście: anomalia średnia w chwili time, -pi..pi
+    float* x;                // Wyjście: pozycja względem rodzica
+    float* y;
+    float* z;
+    size_t count;
+};
+
+// Liczba iteracji Newtona dla równania Keplera: stała, bez warunku stopu, więc bez rozgałęzień.
+// Przy starcie z M + e sin M (1 + e cos M) daje pełną precyzję float dla e <= 0.9
+const int keplerIterations = 4;
+
+// Liczy pozycje w chwili time jako czystą funkcję czasu: M = M0 + n * t w podwójnej precyzji, zawinięte
+// do -pi..pi, potem w pojedynczej precyzji równanie Keplera E - e sin E = M i pozycja (cos E - e) * aP + sin E * bQ.
+// Bez sumowania kroków, więc błąd nie narasta, a skok do dowolnej chwili kosztuje tyle co jeden krok.
+// Przyjmuje parametry: tablice orbit i czas symulacji w sekundach (także ujemny)
+void evaluateOrbits(const OrbitArrays& orbits, double time);
+
+// Liczy sinus i cosinus wektorowo dla całej tablicy, przyjmuje parametry: kąty w radianach (-4pi..4pi), wyjścia i liczba
+// Błąd bezwzględny względem sin/cos w podwójnej precyzji jest poniżej 1e-7 w przedziale 0..2pi
+void sincosBatch(const float* angle, float* sine, float* cosine, size_t count);
+
+// Aktywny wariant jądra i najlepszy dostępny na tym procesorze
+OrbitKernel orbitKernel();
+OrbitKernel bestOrbitKernel();
+
+// Wymusza wariant, np. do porównań wydajności; zwraca false, gdy procesor go nie obsługuje
+bool setOrbitKernel(OrbitKernel kernel);
+const char* orbitKernelName(OrbitKernel kernel);
+
+// Mierzy czas propagacji dla count ciał każdym dostępnym wariantem i wypisuje wyniki
+void benchmarkOrbitKernels(size_t count);
@@ -0,0 +1,262 @@
+﻿#include "parallel.h"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+typedef std::function<void()> Job;
+
+struct Task {
+    std::function<void()> work;
+    std::atomic<int> pending{ 1 };       // Niezakończone zależności i jedna blokada na czas zlecania
+    std::atomic<bool> done{ false };
+    std::mutex mutex;                    // Chroni done przy dopisywaniu następników
+    std::vector<TaskHandle> continuations;
+};
+
+// Kolejka dwustronna jednego wątku; właściciel bierze od końca (najświeższe, ciepłe w cache), złodzieje od początku
+struct WorkerQueue {
+    std::mutex mutex;
+    std::deque<Job> jobs;
+};
+
+class Scheduler {
+public:
+    explicit Scheduler(unsigned int threadCount);
+    ~Scheduler();
+
+    // Dodaje zadanie do kolejki bieżącego wątku, przyjmuje parametr: zadanie
+    void push(Job job);
+
+    // Wykonuje jedno zadanie z własnej kolejki albo ukradzione, zwraca false, gdy wszystkie są puste
+    bool runOne();
+
+    // Wykonuje zadania, dopóki finished() nie zwróci true; bez pracy śpi do powiadomienia, przyjmuje parametr: warunek
+    void waitUntil(const std::function<bool()>& finished);
+
+    // Budzi czekających po zakończeniu pracy, na którą mogą czekać
+    void notifyAll();
+
+    unsigned int workers;
+
+private:
+    void run(size_t index);
+    bool take(size_t index, bool fromBack, Job& job);
+
+    std::vector<std::unique_ptr<WorkerQueue>> queues; // 0 - wątki spoza puli, 1..n - wątki puli
+    std::vector<std::thread> threads;
+    std::atomic<size_t> queued{ 0 };
+    std::atomic<unsigned int> nextVictim{ 0 };
+    std::mutex sleepMutex;
+    std::condition_variable wake;
+    bool stopping = false;
+};
+
+// Kolejka bieżącego wątku: 0 dla wątków spoza puli
+static thread_local size_t currentQueue = 0;
+
+Scheduler::Scheduler(unsigned int threadCount) : workers(std::max(1u, threadCount)) {
+    // Wątek wywołujący też pracuje, więc pula ma o jeden wątek mniej
+    for (unsigned int i = 0; i < workers; ++i) {
+        queues.push_back(std::make_unique<WorkerQueue>());
+    }
+    for (unsigned int i = 1; i < workers; ++i) {
+        threads.emplace_back(&Scheduler::run, this, (size_t)i);
+    }
+}
+
+Scheduler::~Scheduler() {
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+void Scheduler::push(Job job) {
+    WorkerQueue& queue = *queues[currentQueue < queues.size() ? currentQueue : 0];
+    {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.jobs.push_back(std::move(job));
+    }
+    ++queued;
+
+    // Blokada przed powiadomieniem, żeby wątek sprawdzający queued nie zasnął tuż po sprawdzeniu
+    { std::lock_guard<std::mutex> lock(sleepMutex); }
+    wake.notify_one();
+}
+
+bool Scheduler::take(size_t index, bool fromBack, Job& job) {
+    WorkerQueue& queue = *queues[index];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.jobs.empty())
+        return false;
+    if (fromBack) {
+        job = std::move(queue.jobs.back());
+        queue.jobs.pop_back();
+    }
+    else {
+        job = std::move(queue.jobs.front());
+        queue.jobs.pop_front();
+    }
+    --queued;
+    return true;
+}
+
+bool Scheduler::runOne() {
+    if (queued == 0)
+        return false;
+
+    Job job;
+    size_t self = currentQueue < queues.size() ? currentQueue : 0;
+    bool found = self != 0 && take(self, true, job);
+
+    // Kradzież: każdy złodziej zaczyna od innej ofiary, żeby nie walczyć o tę samą kolejkę
+    size_t count = queues.size();
+    size_t start = nextVictim.fetch_add(1, std::memory_order_relaxed);
+    for (size_t k = 0; k < count && !found; ++k) {
+        found = take((start + k) % count, false, job);
+    }
+    if (!found)
+        return false;
+    job();
+    return true;
+}
+
+void Scheduler::waitUntil(const std::function<bool()>& finished) {
+    while (!finished()) {
+        if (runOne())
+            continue;
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        wake.wait(lock, [&] { return finished() || queued > 0; });
+    }
+}
+
+void Scheduler::notifyAll() {
+    { std::lock_guard<std::mutex> lock(sleepMutex); }
+    wake.notify_all();
+}
+
+// Pętla wątku puli, przyjmuje parametr: indeks własnej kolejki
+void Scheduler::run(size_t index) {
+    currentQueue = index;
+    while (true) {
+        if (runOne())
+            continue;
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        wake.wait(lock, [&] { return stopping || queued > 0; });
+        if (stopping && queued == 0)
+            return;
+    }
+}
+
+static unsigned int requestedWorkers = std::max(1u, std::thread::hardware_concurrency());
+static std::unique_ptr<Scheduler> pool;
+static std::once_flag poolCreated;
+
+// Pula tworzona przy pierwszym użyciu
+static Scheduler& scheduler() {
+    std::call_once(poolCreated, [] {
+        if (!pool)
+            pool = std::make_unique<Scheduler>(requestedWorkers);
+    });
+    return *pool;
+}
+
+unsigned int workerCount() {
+    return requestedWorkers;
+}
+
+void setWorkerCount(unsigned int count) {
+    requestedWorkers = std::max(1u, count);
+    scheduler();
+    if (pool->workers != requestedWorkers) {
+        pool.reset();
+        pool = std::make_unique<Scheduler>(requestedWorkers);
+    }
+}
+
+// Funkcja wykonująca pętlę równolegle, przyjmuje parametry: liczba elementów, minimalny kawałek i funkcja (begin, end)
+void parallelFor(size_t count, size_t grain, const std::function<void(size_t begin, size_t end)>& body) {
+    if (count == 0)
+        return;
+
+    // Kilka kawałków na wątek, żeby kradzież wyrównała nierówną pracę
+    Scheduler& pool = scheduler();
+    size_t chunks = std::min<size_t>((size_t)pool.workers * 4, (count + grain - 1) / std::max<size_t>(grain, 1));
+    if (chunks <= 1 || pool.workers == 1) {
+        body(0, count);
+        return;
+    }
+
+    // Stan na stosie wywołującego: wraca on dopiero, gdy remaining spadnie do zera
+    std::atomic<size_t> remaining{ chunks };
+    for (size_t c = chunks - 1; c >= 1; --c) {
+        size_t begin = count * c / chunks, end = count * (c + 1) / chunks;
+        pool.push([&body, &remaining, &pool, begin, end] {
+            body(begin, end);
+            if (--remaining == 0)
+                pool.notifyAll();
+        });
+    }
+    body(0, count / chunks);
+    --remaining;
+    pool.waitUntil([&] { return remaining == 0; });
+}
+
+static void scheduleTask(const TaskHandle& task);
+
+// Zdejmuje jedną blokadę zadania, ostatnia zleca je do wykonania
+static void releaseTask(const TaskHandle& task) {
+    if (--task->pending == 0)
+        scheduleTask(task);
+}
+
+static void scheduleTask(const TaskHandle& task) {
+    scheduler().push([task] {
+        task->work();
+        task->work = nullptr;
+
+        std::vector<TaskHandle> next;
+        {
+            std::lock_guard<std::mutex> lock(task->mutex);
+            task->done = true;
+            next.swap(task->continuations);
+        }
+        scheduler().notifyAll();
+        for (const TaskHandle& continuation : next) {
+            releaseTask(continuation);
+        }
+    });
+}
+
+// Funkcja zlecająca zadanie, przyjmuje parametry: funkcja i zadania, na które ma poczekać
+TaskHandle submitTask(std::function<void()> work, const std::vector<TaskHandle>& dependencies) {
+    TaskHandle task = std::make_shared<Task>();
+    task->work = std::move(work);
+    for (const TaskHandle& dependency : dependencies) {
+        if (!dependency)
+            continue;
+        std::lock_guard<std::mutex> lock(dependency->mutex);
+        if (!dependency->done) {
+            ++task->pending;
+            dependency->continuations.push_back(task);
+        }
+    }
+    releaseTask(task);
+    return task;
+}
+
+void waitTask(const TaskHandle& task) {
+    if (task)
+        scheduler().waitUntil([&] { return task->done.load(); });
+}
+
+bool taskDone(const TaskHandle& task) {
+    return !task || task->done;
+}
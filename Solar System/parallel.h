@@ -0,0 +1,29 @@
+﻿#pragma once
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <vector>
+
+// Pula wątków z kradzieżą pracy: każdy wątek ma własną kolejkę dwustronną, z której bierze zadania od końca,
+// a gdy jest pusta, kradnie z początku kolejek innych wątków. Wątki spoza puli (główny, symulacji) zlecają
+// przez wspólną kolejkę i czekając, same wykonują zadania, więc zagnieżdżone parallelFor nie blokują puli
+
+// Liczba wątków wykonujących pracę, razem z wątkiem wywołującym; domyślnie liczba rdzeni.
+// Zmiana tworzy pulę od nowa, więc wolno ją wywołać tylko, gdy nic nie jest zlecone
+unsigned int workerCount();
+void setWorkerCount(unsigned int count);
+
+// Dzieli zakres 0..count na kawałki po co najmniej grain elementów i wykonuje je równolegle;
+// wraca po zakończeniu wszystkich kawałków, przyjmuje parametry: liczba elementów, minimalny kawałek i funkcja (begin, end)
+void parallelFor(size_t count, size_t grain, const std::function<void(size_t begin, size_t end)>& body);
+
+// Zadanie z zależnościami; uchwyt pozwala na nie czekać albo podać je jako zależność kolejnych zadań
+struct Task;
+typedef std::shared_ptr<Task> TaskHandle;
+
+// Zleca zadanie, które wystartuje po zakończeniu wszystkich zależności, przyjmuje parametry: funkcja i zależności
+TaskHandle submitTask(std::function<void()> work, const std::vector<TaskHandle>& dependencies = {});
+
+// Czeka na zakończenie zadania, w międzyczasie wykonując inne zadania, przyjmuje parametr: uchwyt zadania
+void waitTask(const TaskHandle& task);
+bool taskDone(const TaskHandle& task);
@@ -0,0 +1,115 @@
+﻿#include "particle_system.h"
+#include <algorithm>
+#include <cmath>
+#include "parallel.h"
+
+void ParticleStore::reserve(size_t count) {
+    positionX.reserve(count);
+    positionY.reserve(count);
+    positionZ.reserve(count);
+    velocityX.reserve(count);
+    velocityY.reserve(count);
+    velocityZ.reserve(count);
+    accelerationX.reserve(count);
+    accelerationY.reserve(count);
+    accelerationZ.reserve(count);
+    mass.reserve(count);
+}
+
+// Funkcja dodająca cząstkę, przyjmuje parametry: pozycja, prędkość i masa (GM)
+int ParticleStore::add(float x, float y, float z, float vx, float vy, float vz, float particleMass) {
+    positionX.push_back(x);
+    positionY.push_back(y);
+    positionZ.push_back(z);
+    velocityX.push_back(vx);
+    velocityY.push_back(vy);
+    velocityZ.push_back(vz);
+    accelerationX.push_back(0.0f);
+    accelerationY.push_back(0.0f);
+    accelerationZ.push_back(0.0f);
+    mass.push_back(particleMass);
+    return (int)size() - 1;
+}
+
+// Funkcja wykonująca pierwszą połowę kroku, przyjmuje parametr: długość kroku w sekundach
+void ParticleSystem::kickDrift(double dt) {
+    float halfStep = (float)(dt * 0.5);
+    float step = (float)dt;
+    ParticleStore& p = particles;
+    parallelFor(p.size(), 16384, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            p.velocityX[i] += p.accelerationX[i] * halfStep;
+            p.velocityY[i] += p.accelerationY[i] * halfStep;
+            p.velocityZ[i] += p.accelerationZ[i] * halfStep;
+            p.positionX[i] += p.velocityX[i] * step;
+            p.positionY[i] += p.velocityY[i] * step;
+            p.positionZ[i] += p.velocityZ[i] * step;
+        }
+    });
+}
+
+// Funkcja wykonująca drugą połowę kroku, przyjmuje parametry: długość kroku i ciała kinematyczne
+void ParticleSystem::kick(double dt, const BodyStore& bodies) {
+    computeAccelerations(bodies);
+    float halfStep = (float)(dt * 0.5);
+    ParticleStore& p = particles;
+    parallelFor(p.size(), 16384, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            p.velocityX[i] += p.accelerationX[i] * halfStep;
+            p.velocityY[i] += p.accelerationY[i] * halfStep;
+            p.velocityZ[i] += p.accelerationZ[i] * halfStep;
+        }
+    });
+}
+
+// Przyspieszenia: cząstki między sobą z drzewa, ciała z masą bezpośrednio (jest ich kilkanaście)
+void ParticleSystem::computeAccelerations(const BodyStore& bodies) {
+    ParticleStore& p = particles;
+    size_t count = p.size();
+    bool selfGravity = std::any_of(p.mass.begin(), p.mass.end(), [](float m) { return m > 0.0f; });
+    if (selfGravity) {
+        tree.build(p.positionX.data(), p.positionY.data(), p.positionZ.data(), p.mass.data(), count, settings);
+        tree.accelerations(p.accelerationX.data(), p.accelerationY.data(), p.accelerationZ.data(), settings);
+    }
+    else {
+        // Same cząstki próbne, drzewo niepotrzebne
+        std::fill(p.accelerationX.begin(), p.accelerationX.end(), 0.0f);
+        std::fill(p.accelerationY.begin(), p.accelerationY.end(), 0.0f);
+        std::fill(p.accelerationZ.begin(), p.accelerationZ.end(), 0.0f);
+    }
+
+    std::vector<int> attractors;
+    for (size_t b = 0; b < bodies.size(); ++b) {
+        if (bodies.mass[b] > 0.0f)
+            attractors.push_back((int)b);
+    }
+    float eps2 = settings.softening * settings.softening;
+    parallelFor(count, 4096, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            float ax = 0.0f, ay = 0.0f, az = 0.0f;
+            for (int b : attractors) {
+                float dx = bodies.positionX[b] - p.positionX[i];
+                float dy = bodies.positionY[b] - p.positionY[i];
+                float dz = bodies.positionZ[b] - p.positionZ[i];
+                float inv = 1.0f / sqrtf(dx * dx + dy * dy + dz * dz + eps2);
+                float strength = bodies.mass[b] * inv * inv * inv;
+                ax += dx * strength;
+                ay += dy * strength;
+                az += dz * strength;
+            }
+            p.accelerationX[i] += ax;
+            p.accelerationY[i] += ay;
+            p.accelerationZ[i] += az;
+        }
+    });
+}
+
+void ParticleSystem::copyPositions(std::vector<float>& out) const {
+    size_t count = particles.size();
+    out.resize(count * 3);
+    for (size_t i = 0; i < count; ++i) {
+        out[i * 3 + 0] = particles.positionX[i];
+        out[i * 3 + 1] = particles.positionY[i];
+        out[i * 3 + 2] = particles.positionZ[i];
+    }
+}
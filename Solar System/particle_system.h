@@ -0,0 +1,48 @@
+﻿#pragma once
+#include <cstddef>
+#include <vector>
+#include "barnes_hut.h"
+#include "body_store.h"
+
+// Cząstki (gruz, rodziny planetoid) w układzie struktury tablic. Masy są w jednostkach GM, jak BodyStore::mass
+class ParticleStore {
+public:
+    std::vector<float> positionX, positionY, positionZ;
+    std::vector<float> velocityX, velocityY, velocityZ;
+    std::vector<float> accelerationX, accelerationY, accelerationZ;
+    std::vector<float> mass;
+
+    size_t size() const { return mass.size(); }
+    void reserve(size_t count);
+
+    // Dodaje cząstkę, zwraca jej indeks, przyjmuje parametry: pozycja, prędkość i masa (GM)
+    int add(float x, float y, float z, float vx, float vy, float vz, float particleMass);
+};
+
+// Cząstki poruszające się pod wpływem grawitacji: wzajemne przyciąganie z drzewa Barnes–Hut
+// i przyciąganie ciał kinematycznych z masą, liczone bezpośrednio. Całkowanie metodą żabki (kick-drift-kick)
+class ParticleSystem {
+public:
+    ParticleStore particles;
+    BarnesHutSettings settings;
+
+    bool empty() const { return particles.size() == 0; }
+
+    // Pierwsza połowa kroku: pół kopnięcia przyspieszeniem z poprzedniego kroku i przesunięcie o pełny krok,
+    // przyjmuje parametr: długość kroku w sekundach
+    void kickDrift(double dt);
+
+    // Druga połowa kroku: nowe przyspieszenia dla pozycji po przesunięciu i pół kopnięcia, przyjmuje parametry:
+    // długość kroku i ciała kinematyczne już ustawione na koniec kroku
+    void kick(double dt, const BodyStore& bodies);
+
+    // Kopiuje pozycje wszystkich cząstek jako kolejne trójki xyz
+    void copyPositions(std::vector<float>& out) const;
+
+    const BarnesHutStats& treeStats() const { return tree.stats(); }
+
+private:
+    void computeAccelerations(const BodyStore& bodies);
+
+    BarnesHutTree tree;
+};
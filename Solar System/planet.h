@@ -1,32 +1,35 @@
 ﻿#pragma once
 #include <glm/glm.hpp>
-#include <vector>
+#include "body_store.h"
 
 unsigned int loadTexture(const char* path);
 
+// Uchwyt ciała: nie przechowuje własnych danych, tylko indeks w magazynie BodyStore,
+// z którego tablic czyta wszystkie właściwości
 class Planet {
 public:
+	Planet(const BodyStore& store, int index);
+
 	// Parametry planety
-    glm::vec3 position;
-    glm::vec3 color;
-    float radius;
-    float selfRotationAngle = 0.0f;  // Kąt obrotu wokół własnej osi
-    float selfRotationSpeed = 20.0f; // Stopnie na sekundę
-    unsigned int textureID = 0;
+    glm::vec3 position() const;      // Pozycja interpolowana między krokami symulacji, używana do rysowania
+    glm::vec3 color() const;
+    float radius() const { return store->radius[bodyIndex]; }
+    unsigned int textureID() const { return store->textureID[bodyIndex]; }
+    int virtualTexture() const { return store->virtualTexture[bodyIndex]; } // 0 gdy brak
 
     // Parametry orbity
-    float orbitRadius = 0.0f;
-    float orbitSpeed = 0.0f;
-    float orbitAngle = 0.0f;
+    int parent() const { return store->parent[bodyIndex]; }
+    float semiMajorAxis() const { return store->semiMajorAxis[bodyIndex]; }
+    float eccentricity() const { return store->eccentricity[bodyIndex]; }
+    glm::vec3 periapsis() const;     // a * P, od środka elipsy do perycentrum
+    glm::vec3 minorAxis() const;     // b * Q, prostopadle w płaszczyźnie orbity
 
-	Planet(glm::vec3 position, float radius, glm::vec3 color);
+    int index() const { return bodyIndex; }
 
-	// Funkcje do rysowania i aktualizacji planety
-    void update(float deltaTime);
+	// Funkcja do rysowania planety
     void draw(unsigned int shaderProgram) const;
 
-	// Funkcje do rysowania i aktualizacji księżyców
-    std::vector<Planet> moons;
-    void updateMoons(float deltaTime);
-    void drawMoons(unsigned int shaderProgram) const;
-};
\ No newline at end of file
+private:
+    const BodyStore* store;
+    int bodyIndex;
+};
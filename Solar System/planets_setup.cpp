@@ -1,122 +1,167 @@
 ﻿#include "planets_setup.h"
-#include <cstdlib> // dla rand()
+#include <glm/glm.hpp>
+#include <cmath>
 #include <iostream>
+#include "seeded_random.h"
+#include "procedural_texture.h"
+#include "texture_residency.h"
+#include "virtual_texture.h"
 
 // Deklaracja funkcji ładowania tekstur, przyjmuje parametr: ścieżka do pliku tekstury
 extern unsigned int loadTexture(const char* path);
-
-// Funkcja inicjaluzująca planety, przyjmuje parametr: tablica wektorowa planet
-void initializePlanets(std::vector<Planet>& planets) {
+extern VirtualTextureSystem virtualTextures; // Zdefiniowane w main.cpp
+extern TextureResidency textureResidency;
+
+// Funkcja inicjaluzująca planety, przyjmuje parametr: magazyn ciał
+void initializePlanets(BodyStore& bodies) {
+    // Pliki dekodują się na puli wątków w czasie budowania sceny i generowania tekstur proceduralnych na GPU
+    const char* planetTexturePaths[] = { "resources/sun.jpg", "resources/mercury.jpg", "resources/venus.jpg",
+        "resources/earth.jpg", "resources/mars.jpg", "resources/jupiter.jpg", "resources/saturn.jpg",
+        "resources/uranus.jpg", "resources/neptune.jpg" };
+    unsigned int planetTextures[9];
+    for (int i = 0; i < 9; ++i) {
+        planetTextures[i] = loadTexture(planetTexturePaths[i]);
+    }
     unsigned int moonTexture = loadTexture("resources/moon.jpg");
 
-    std::vector<unsigned int> moonTextures = {
-        loadTexture("resources/eris_fictional.jpg"),
-        loadTexture("resources/makemake_fictional.jpg"),
-        loadTexture("resources/haumea_fictional.jpg"),
-        loadTexture("resources/ceres_fictional.jpg")
-    };
-
-    Planet sun(glm::vec3(0.0f), 0.7f, glm::vec3(1.0f, 1.0f, 0.0f));
-    planets.push_back(sun);
-
-    // Merkury
-	planets.emplace_back(glm::vec3(0.0f), 0.10f, glm::vec3(0.5f));
-
-    // Wenus
-    planets.emplace_back(glm::vec3(0.0f), 0.18f, glm::vec3(0.9f, 0.7f, 0.2f));
-
-	// Ziemia + Księżyc
-    planets.emplace_back(glm::vec3(0.0f), 0.22f, glm::vec3(0.2f, 0.6f, 1.0f));
-    Planet moon(glm::vec3(0.0f), 0.05f, glm::vec3(0.8f, 0.8f, 0.8f));
-    moon.orbitRadius = 0.5f;
-    moon.orbitSpeed = 100.0f;
-    moon.textureID = moonTexture;
-    planets[3].moons.push_back(moon);
-
-	// Mars + Deimos i Phobos
-    planets.emplace_back(glm::vec3(0.0f), 0.15f, glm::vec3(0.8f, 0.3f, 0.2f));
-    Planet phobos(glm::vec3(0.0f), 0.03f, glm::vec3(0.6f));
-    phobos.orbitRadius = 0.3f;
-    phobos.orbitSpeed = 120.0f;
-    phobos.textureID = moonTextures[rand() % moonTextures.size()];
-    planets[4].moons.push_back(phobos);
-
-    Planet deimos(glm::vec3(0.0f), 0.02f, glm::vec3(0.7f));
-    deimos.orbitRadius = 0.5f;
-    deimos.orbitSpeed = 90.0f;
-    deimos.textureID = moonTextures[rand() % moonTextures.size()];
-    planets[4].moons.push_back(deimos);
-
-	// Jowisz + Księżyce: Io, Europa, Ganymede, Callisto
-    planets.emplace_back(glm::vec3(0.0f), 0.45f, glm::vec3(0.9f, 0.8f, 0.6f));
-    float jMoonSize = 0.05f;
-
-    Planet io(glm::vec3(0.0f), jMoonSize, glm::vec3(0.9f, 0.6f, 0.3f));
-    io.orbitRadius = 0.7f;
-    io.orbitSpeed = 55.0f;
-    io.textureID = moonTextures[rand() % moonTextures.size()];
-    planets[5].moons.push_back(io);
-
-    Planet europa(glm::vec3(0.0f), jMoonSize, glm::vec3(0.6f, 0.8f, 1.0f));
-    europa.orbitRadius = 0.9f;
-    europa.orbitSpeed = 50.0f;
-    europa.textureID = moonTextures[rand() % moonTextures.size()];
-    planets[5].moons.push_back(europa);
-
-    Planet ganymede(glm::vec3(0.0f), jMoonSize, glm::vec3(0.4f, 0.7f, 0.9f));
-    ganymede.orbitRadius = 1.2f;
-    ganymede.orbitSpeed = 45.0f;
-    ganymede.textureID = moonTextures[rand() % moonTextures.size()];
-    planets[5].moons.push_back(ganymede);
-
-    Planet callisto(glm::vec3(0.0f), jMoonSize, glm::vec3(0.6f, 0.5f, 0.4f));
-    callisto.orbitRadius = 1.5f;
-    callisto.orbitSpeed = 40.0f;
-    callisto.textureID = moonTextures[rand() % moonTextures.size()];
-    planets[5].moons.push_back(callisto);
-
-	// Saturn + Tytan
-    planets.emplace_back(glm::vec3(0.0f), 0.40f, glm::vec3(0.9f, 0.85f, 0.5f));
-    Planet tytan(glm::vec3(0.0f), 0.06f, glm::vec3(0.8f, 0.7f, 0.4f));
-    tytan.orbitRadius = 1.0f;
-    tytan.orbitSpeed = 42.5f;
-    tytan.textureID = moonTextures[rand() % moonTextures.size()];
-    planets[6].moons.push_back(tytan);
-
-	// Uran + Miranda
-    planets.emplace_back(glm::vec3(0.0f), 0.30f, glm::vec3(0.6f, 0.9f, 0.9f));
-    Planet miranda(glm::vec3(0.0f), 0.03f, glm::vec3(0.6f, 0.6f, 0.8f));
-    miranda.orbitRadius = 0.8f;
-    miranda.orbitSpeed = 45.0f;
-    miranda.textureID = moonTextures[rand() % moonTextures.size()];
-    planets[7].moons.push_back(miranda);
-
-	// Neptun + Tryton
-    planets.emplace_back(glm::vec3(0.0f), 0.28f, glm::vec3(0.4f, 0.5f, 0.9f));
-    Planet tryton(glm::vec3(0.0f), 0.04f, glm::vec3(0.5f, 0.7f, 0.9f));
-    tryton.orbitRadius = 0.7f;
-    tryton.orbitSpeed = 47.5f;
-    tryton.textureID = moonTextures[rand() % moonTextures.size()];
-    planets[8].moons.push_back(tryton);
-
-    // Ustaw parametry orbity dla planet (nie słońca)
-    planets[1].orbitRadius = 2.5f;  planets[1].orbitSpeed = 30.0f;
-    planets[2].orbitRadius = 3.5f;  planets[2].orbitSpeed = 22.5f;
-    planets[3].orbitRadius = 5.0f;  planets[3].orbitSpeed = 17.5f;
-    planets[4].orbitRadius = 6.5f;  planets[4].orbitSpeed = 14.0f;
-    planets[5].orbitRadius = 8.5f;  planets[5].orbitSpeed = 9.0f;
-    planets[6].orbitRadius = 10.5f; planets[6].orbitSpeed = 7.0f;
-    planets[7].orbitRadius = 12.0f; planets[7].orbitSpeed = 5.0f;
-    planets[8].orbitRadius = 13.5f; planets[8].orbitSpeed = 4.0f;
+    SolarSystemBodies s = buildSolarSystem(bodies);
+
+    // Księżyce bez prawdziwych map dostają powierzchnie generowane na GPU, każda z własnym ziarnem
+    ProceduralTextureBaker baker;
+    baker.initialize();
+    bodies.textureID[s.moon] = moonTexture;
+    bodies.textureID[s.phobos] = baker.bake({ SurfaceType::Rocky, 101, glm::vec3(0.55f, 0.48f, 0.42f), glm::vec3(0.25f, 0.22f, 0.20f), 1.2f });
+    bodies.textureID[s.deimos] = baker.bake({ SurfaceType::Rocky, 102, glm::vec3(0.60f, 0.55f, 0.48f), glm::vec3(0.30f, 0.27f, 0.24f), 0.8f });
+    bodies.textureID[s.io] = baker.bake({ SurfaceType::Volcanic, 501, glm::vec3(0.95f, 0.85f, 0.35f), glm::vec3(0.60f, 0.45f, 0.15f), 0.0f });
+    bodies.textureID[s.europa] = baker.bake({ SurfaceType::Icy, 502, glm::vec3(0.92f, 0.90f, 0.85f), glm::vec3(0.55f, 0.35f, 0.25f), 0.2f });
+    bodies.textureID[s.ganymede] = baker.bake({ SurfaceType::Icy, 503, glm::vec3(0.70f, 0.65f, 0.60f), glm::vec3(0.35f, 0.32f, 0.30f), 0.8f });
+    bodies.textureID[s.callisto] = baker.bake({ SurfaceType::Rocky, 504, glm::vec3(0.45f, 0.40f, 0.35f), glm::vec3(0.15f, 0.13f, 0.12f), 1.5f });
+    bodies.textureID[s.tytan] = baker.bake({ SurfaceType::Hazy, 601, glm::vec3(0.85f, 0.65f, 0.30f), glm::vec3(0.60f, 0.40f, 0.15f), 0.0f });
+    bodies.textureID[s.miranda] = baker.bake({ SurfaceType::Icy, 701, glm::vec3(0.75f, 0.75f, 0.78f), glm::vec3(0.40f, 0.40f, 0.45f), 1.0f });
+    bodies.textureID[s.tryton] = baker.bake({ SurfaceType::Icy, 801, glm::vec3(0.85f, 0.75f, 0.72f), glm::vec3(0.55f, 0.45f, 0.45f), 0.3f });
+    bodies.textureID[s.pluto] = baker.bake({ SurfaceType::Icy, 901, glm::vec3(0.85f, 0.75f, 0.62f), glm::vec3(0.45f, 0.30f, 0.22f), 0.4f });
+    bodies.textureID[s.charon] = baker.bake({ SurfaceType::Rocky, 902, glm::vec3(0.60f, 0.58f, 0.56f), glm::vec3(0.30f, 0.28f, 0.27f), 1.0f });
 
     // Tekstury planet
-    planets[0].textureID = loadTexture("resources/sun.jpg");
-    planets[1].textureID = loadTexture("resources/mercury.jpg");
-    planets[2].textureID = loadTexture("resources/venus.jpg");
-    planets[3].textureID = loadTexture("resources/earth.jpg");
-    planets[4].textureID = loadTexture("resources/mars.jpg");
-    planets[5].textureID = loadTexture("resources/jupiter.jpg");
-    planets[6].textureID = loadTexture("resources/saturn.jpg");
-    planets[7].textureID = loadTexture("resources/uranus.jpg");
-    planets[8].textureID = loadTexture("resources/neptune.jpg");
-}
\ No newline at end of file
+    int planets[] = { s.sun, s.mercury, s.venus, s.earth, s.mars, s.jupiter, s.saturn, s.uranus, s.neptune };
+    for (int i = 0; i < 9; ++i) {
+        bodies.textureID[planets[i]] = planetTextures[i];
+    }
+    baker.release();
+    textureResidency.finishLoads();
+
+    // Mapy w wysokiej rozdzielczości jako tekstury wirtualne, jeśli zostały pocięte narzędziem --build-vt
+    bodies.virtualTexture[s.earth] = virtualTextures.open("resources/earth.vt");
+    bodies.virtualTexture[s.mars] = virtualTextures.open("resources/mars.vt");
+}
+
+// Funkcja tworząca populację, przyjmuje parametry: nazwa, zakres półosi, największy mimośród i nachylenie (stopnie),
+// półoś i ruch średni odniesienia oraz kolor
+static BeltPopulation population(const char* name, float minA, float maxA, float maxE, float maxI,
+    float referenceA, float referenceMotion, glm::vec3 color, bool coorbital = false) {
+    BeltPopulation p;
+    p.name = name;
+    p.minSemiMajorAxis = minA;
+    p.maxSemiMajorAxis = maxA;
+    p.maxEccentricity = maxE;
+    p.maxInclination = maxI;
+    p.referenceSemiMajorAxis = referenceA;
+    p.referenceMeanMotion = referenceMotion;
+    p.coorbital = coorbital;
+    p.colorR = color.r;
+    p.colorG = color.g;
+    p.colorB = color.b;
+    return p;
+}
+
+void initializeBelts(Belt& belt, size_t count, uint32_t seed) {
+    belt.clear();
+    if (count == 0)
+        return;
+
+    SeededRandom random(seed);
+    belt.particles.reserve(count);
+
+    // Elementy Jowisza i Neptuna jak w initializePlanets, ruch średni w stopniach na sekundę
+    const float jupiterA = 8.5f, jupiterMotion = 9.0f;
+    const float jupiterLongitude = 100.46f + 273.87f; // Długość średnia w chwili 0: węzeł + perycentrum + M0
+    const float neptuneA = 13.5f, neptuneMotion = 4.0f;
+
+    // Pas główny: 2.1-3.3 au odwzorowane na 7-8 jednostek między Marsem a Jowiszem, z przerwami Kirkwooda
+    // w rezonansach 3:1, 5:2 i 7:3 z Jowiszem; ruch średni z trzeciego prawa Keplera względem Jowisza
+    int mainBelt = belt.addPopulation(population("main belt", 7.0f, 8.0f, 0.35f, 35.0f,
+        jupiterA, jupiterMotion, glm::vec3(0.65f, 0.60f, 0.52f)));
+    const float kirkwoodGaps[] = { 2.50f, 2.82f, 2.95f };
+    size_t mainCount = count * 55 / 100;
+    while (belt.populations[mainBelt].count < mainCount) {
+        float au = 2.1f + 1.2f * random.unit();
+        bool inGap = false;
+        for (float gap : kirkwoodGaps)
+            inGap = inGap || std::fabs(au - gap) < 0.015f;
+        if (inGap)
+            continue;
+
+        OrbitalElements elements;
+        elements.semiMajorAxis = 7.0f + (au - 2.1f) / 1.2f;
+        elements.eccentricity = std::min(0.35f, std::fabs(0.12f * random.normal()));
+        elements.inclination = std::min(35.0f, std::fabs(8.0f * random.normal()));
+        elements.ascendingNode = 360.0f * random.unit();
+        elements.periapsisArgument = 360.0f * random.unit();
+        elements.meanAnomaly = 360.0f * random.unit();
+        // Kolejność losowań ustalona zmiennymi, bo kolejność liczenia argumentów zależy od kompilatora
+        float brightness = 0.3f + 0.7f * random.unit();
+        float size = std::pow(random.unit(), 3.0f);
+        belt.add(mainBelt, elements, brightness, size);
+    }
+
+    // Trojańczycy: na orbicie Jowisza, z jego ruchem średnim, skupieni 60 stopni przed nim (L4) i za nim (L5)
+    int trojans = belt.addPopulation(population("trojans", jupiterA - 0.2f, jupiterA + 0.2f, 0.2f, 40.0f,
+        jupiterA, jupiterMotion, glm::vec3(0.70f, 0.50f, 0.40f), true));
+    size_t trojanCount = count * 10 / 100;
+    for (size_t i = 0; i < trojanCount; ++i) {
+        float longitude = jupiterLongitude + (i % 2 == 0 ? 60.0f : -60.0f) + 12.0f * random.normal();
+        OrbitalElements elements;
+        elements.semiMajorAxis = jupiterA + 0.06f * random.normal();
+        elements.eccentricity = std::min(0.2f, std::fabs(0.06f * random.normal()));
+        elements.inclination = std::min(40.0f, std::fabs(12.0f * random.normal()));
+        elements.ascendingNode = 360.0f * random.unit();
+        elements.periapsisArgument = 360.0f * random.unit();
+        elements.meanAnomaly = longitude - elements.ascendingNode - elements.periapsisArgument;
+        float brightness = 0.2f + 0.6f * random.unit();
+        float size = std::pow(random.unit(), 3.0f);
+        belt.add(trojans, elements, brightness, size);
+    }
+
+    // Plutonki: w rezonansie 3:2 z Neptunem jak Pluton, więc wszystkie z ruchem średnim Plutona
+    int plutinos = belt.addPopulation(population("plutinos", 15.8f, 16.2f, 0.35f, 40.0f,
+        16.0f, neptuneMotion * 2.0f / 3.0f, glm::vec3(0.80f, 0.70f, 0.60f), true));
+    size_t plutinoCount = count * 10 / 100;
+    for (size_t i = 0; i < plutinoCount; ++i) {
+        OrbitalElements elements;
+        elements.semiMajorAxis = 16.0f + 0.05f * random.normal();
+        elements.eccentricity = 0.1f + 0.25f * random.unit();
+        elements.inclination = std::min(40.0f, std::fabs(12.0f * random.normal()));
+        elements.ascendingNode = 360.0f * random.unit();
+        elements.periapsisArgument = 360.0f * random.unit();
+        elements.meanAnomaly = 360.0f * random.unit();
+        float brightness = 0.3f + 0.7f * random.unit();
+        float size = std::pow(random.unit(), 3.0f);
+        belt.add(plutinos, elements, brightness, size);
+    }
+
+    // Klasyczny pas Kuipera: zimna, prawie kołowa i płaska populacja za Plutonem, reszta cząstek
+    int kuiper = belt.addPopulation(population("Kuiper belt", 16.5f, 19.5f, 0.15f, 15.0f,
+        neptuneA, neptuneMotion, glm::vec3(0.60f, 0.70f, 0.85f)));
+    while (belt.size() < count) {
+        OrbitalElements elements;
+        elements.semiMajorAxis = 16.5f + 3.0f * random.unit();
+        elements.eccentricity = std::min(0.15f, std::fabs(0.05f * random.normal()));
+        elements.inclination = std::min(15.0f, std::fabs(3.0f * random.normal()));
+        elements.ascendingNode = 360.0f * random.unit();
+        elements.periapsisArgument = 360.0f * random.unit();
+        elements.meanAnomaly = 360.0f * random.unit();
+        float brightness = 0.3f + 0.7f * random.unit();
+        float size = std::pow(random.unit(), 3.0f);
+        belt.add(kuiper, elements, brightness, size);
+    }
+}
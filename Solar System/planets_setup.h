@@ -1,9 +1,16 @@
 ﻿#pragma once
-#include <vector>
-#include "planet.h"
+#include <cstdint>
+#include "belt.h"
+#include "body_store.h"
+#include "particle_system.h"
+#include "scene.h"
 
 // Funkcja ładowania tekstur, przyjmuje parametr: ścieżka do pliku tekstury
 extern unsigned int loadTexture(const char* path);
 
-// Funkcja inicjaluzująca planety, przyjmuje parametr: tablica wektorowa planet
-void initializePlanets(std::vector<Planet>& planets);
\ No newline at end of file
+// Funkcja inicjaluzująca planety: scena z buildSolarSystem oraz tekstury, przyjmuje parametr: magazyn ciał
+void initializePlanets(BodyStore& bodies);
+
+// Funkcja tworząca pasy: główny, trojańczyków Jowisza, plutonków i pas Kuipera, przyjmuje parametry: pasy, łączna liczba cząstek
+// i ziarno generatora
+void initializeBelts(Belt& belt, size_t count, uint32_t seed = 4242);
\ No newline at end of file
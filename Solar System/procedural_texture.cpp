@@ -0,0 +1,193 @@
+﻿#include "procedural_texture.h"
+#include <glad/glad.h>
+#include <iostream>
+#include "shader.h"
+
+// Vertex shader - trójkąt pokrywający cały ekran, bez bufora wierzchołków
+static const char* bakeVertexShaderSource = R"(
+    #version 330 core
+    out vec2 TexCoords;
+
+    void main() {
+        vec2 position = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+        TexCoords = position;
+        gl_Position = vec4(position * 2.0 - 1.0, 0.0, 1.0);
+    }
+)";
+
+// Fragment shader - powierzchnia księżyca z szumu 3D na kierunku na sferze, więc bez szwów i zniekształceń przy biegunach
+static const char* bakeFragmentShaderSource = R"(
+    #version 330 core
+    in vec2 TexCoords;
+
+    out vec4 FragColor;
+
+    uniform uint seed;
+    uniform int surfaceType;
+    uniform vec3 baseColor;
+    uniform vec3 darkColor;
+    uniform float craterDensity;
+
+    const float PI = 3.14159265358979;
+
+    uint hash(uint x) {
+        x ^= x >> 16;
+        x *= 0x7feb352du;
+        x ^= x >> 15;
+        x *= 0x846ca68bu;
+        x ^= x >> 16;
+        return x;
+    }
+
+    float random(ivec3 cell, uint salt) {
+        uint h = hash(uint(cell.x) ^ hash(uint(cell.y) ^ hash(uint(cell.z) ^ hash(seed ^ salt))));
+        return float(h) / 4294967295.0;
+    }
+
+    float valueNoise(vec3 p) {
+        ivec3 cell = ivec3(floor(p));
+        vec3 f = fract(p);
+        vec3 u = f * f * (3.0 - 2.0 * f);
+
+        float n000 = random(cell, 0u);
+        float n100 = random(cell + ivec3(1, 0, 0), 0u);
+        float n010 = random(cell + ivec3(0, 1, 0), 0u);
+        float n110 = random(cell + ivec3(1, 1, 0), 0u);
+        float n001 = random(cell + ivec3(0, 0, 1), 0u);
+        float n101 = random(cell + ivec3(1, 0, 1), 0u);
+        float n011 = random(cell + ivec3(0, 1, 1), 0u);
+        float n111 = random(cell + ivec3(1, 1, 1), 0u);
+
+        return mix(mix(mix(n000, n100, u.x), mix(n010, n110, u.x), u.y),
+                   mix(mix(n001, n101, u.x), mix(n011, n111, u.x), u.y), u.z);
+    }
+
+    float fbm(vec3 p) {
+        float sum = 0.0;
+        float amplitude = 0.5;
+        for (int i = 0; i < 6; ++i) {
+            sum += amplitude * valueNoise(p);
+            p *= 2.03;
+            amplitude *= 0.5;
+        }
+        return sum;
+    }
+
+    // Kratery z szumu komórkowego: x - głębokość misy, y - jasność wału
+    vec2 craters(vec3 p, uint salt) {
+        ivec3 cell = ivec3(floor(p));
+        vec2 result = vec2(0.0);
+        for (int z = -1; z <= 1; ++z)
+        for (int y = -1; y <= 1; ++y)
+        for (int x = -1; x <= 1; ++x) {
+            ivec3 c = cell + ivec3(x, y, z);
+            if (random(c, salt + 7u) > craterDensity * 0.6)
+                continue;
+
+            vec3 center = vec3(c) + vec3(random(c, salt + 1u), random(c, salt + 2u), random(c, salt + 3u));
+            float radius = mix(0.15, 0.5, random(c, salt + 4u));
+            float d = length(p - center) / radius;
+            if (d < 1.2) {
+                result.x = max(result.x, 1.0 - smoothstep(0.0, 0.9, d));
+                result.y = max(result.y, smoothstep(0.8, 0.95, d) * (1.0 - smoothstep(0.95, 1.2, d)));
+            }
+        }
+        return result;
+    }
+
+    void main() {
+        // Punkt na sferze dla współrzędnych tekstury, zgodnie z siatką sfery w main.cpp
+        float sector = TexCoords.x * 2.0 * PI;
+        float stack = (TexCoords.y - 0.5) * PI;
+        vec3 dir = vec3(cos(stack) * cos(sector), cos(stack) * sin(sector), sin(stack));
+
+        float n = fbm(dir * 3.0);
+        vec3 color = mix(darkColor, baseColor, smoothstep(0.25, 0.75, n));
+
+        if (surfaceType == 1) {
+            // Lód: ciemne pęknięcia tam, gdzie szum przechodzi przez połowę
+            float lineae = 1.0 - smoothstep(0.0, 0.015, abs(fbm(dir * 4.0 + 11.0) - 0.5));
+            color = mix(color, darkColor, lineae * 0.8);
+        }
+        else if (surfaceType == 2) {
+            // Wulkany: ciemne plamy z jasną obwódką
+            float spots = fbm(dir * 6.0 + 5.0);
+            color = mix(color, darkColor * 0.4, smoothstep(0.62, 0.66, spots));
+            color = mix(color, vec3(0.9, 0.4, 0.1), smoothstep(0.58, 0.62, spots) * (1.0 - smoothstep(0.62, 0.66, spots)));
+        }
+        else if (surfaceType == 3) {
+            // Mgła: delikatne pasy równoleżnikowe
+            float bands = 0.5 + 0.5 * sin(dir.z * 12.0 + fbm(dir * 2.0) * 4.0);
+            color = mix(baseColor, darkColor, bands * 0.35);
+        }
+
+        // Kratery w trzech skalach
+        if (craterDensity > 0.0) {
+            for (int i = 0; i < 3; ++i) {
+                vec2 crater = craters(dir * (4.0 * exp2(float(i))), uint(i) * 16u);
+                color *= 1.0 - 0.35 * crater.x;
+                color += 0.15 * crater.y;
+            }
+        }
+
+        FragColor = vec4(clamp(color, 0.0, 1.0), 1.0);
+    }
+)";
+
+bool ProceduralTextureBaker::initialize() {
+    program = createProgram(bakeVertexShaderSource, bakeFragmentShaderSource);
+    glGenVertexArrays(1, &emptyVAO); // Profil core wymaga VAO także bez atrybutów
+    glGenFramebuffers(1, &framebuffer);
+    return program != 0;
+}
+
+void ProceduralTextureBaker::release() {
+    glDeleteProgram(program);
+    glDeleteVertexArrays(1, &emptyVAO);
+    glDeleteFramebuffers(1, &framebuffer);
+    program = emptyVAO = framebuffer = 0;
+}
+
+// Funkcja generująca teksturę, przyjmuje parametry: opis powierzchni, szerokość i wysokość tekstury
+unsigned int ProceduralTextureBaker::bake(const ProceduralSurface& surface, int width, int height) {
+    unsigned int textureID;
+    glGenTextures(1, &textureID);
+    glBindTexture(GL_TEXTURE_2D, textureID);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+
+    int viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, textureID, 0);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        std::cout << "ERROR::FRAMEBUFFER::BAKE_INCOMPLETE" << std::endl;
+    }
+    glViewport(0, 0, width, height);
+    glDisable(GL_DEPTH_TEST);
+
+    glUseProgram(program);
+    glUniform1ui(glGetUniformLocation(program, "seed"), surface.seed);
+    glUniform1i(glGetUniformLocation(program, "surfaceType"), (int)surface.type);
+    glUniform3f(glGetUniformLocation(program, "baseColor"), surface.baseColor.r, surface.baseColor.g, surface.baseColor.b);
+    glUniform3f(glGetUniformLocation(program, "darkColor"), surface.darkColor.r, surface.darkColor.g, surface.darkColor.b);
+    glUniform1f(glGetUniformLocation(program, "craterDensity"), surface.craterDensity);
+
+    glBindVertexArray(emptyVAO);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glBindVertexArray(0);
+
+    glEnable(GL_DEPTH_TEST);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+
+    // Mipmapy i parametry jak dla tekstur z plików
+    glBindTexture(GL_TEXTURE_2D, textureID);
+    glGenerateMipmap(GL_TEXTURE_2D);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    return textureID;
+}
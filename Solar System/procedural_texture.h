@@ -0,0 +1,34 @@
+﻿#pragma once
+#include <glm/glm.hpp>
+
+// Rodzaj powierzchni generowanej proceduralnie
+enum class SurfaceType {
+    Rocky,    // Szara skała pokryta kraterami
+    Icy,      // Jasny lód z ciemnymi pęknięciami
+    Volcanic, // Żółte siarkowe równiny z plamami wulkanów
+    Hazy      // Gładkie pasy mgły bez kraterów
+};
+
+// Parametry powierzchni jednego księżyca
+struct ProceduralSurface {
+    SurfaceType type;
+    unsigned int seed;          // Ziarno szumu, każde ciało dostaje własne
+    glm::vec3 baseColor;
+    glm::vec3 darkColor;
+    float craterDensity = 1.0f; // 0 - brak kraterów
+};
+
+// Generator tekstur księżyców: szum i kratery liczone na GPU i zapisywane do tekstury przy ładowaniu
+class ProceduralTextureBaker {
+public:
+    bool initialize();
+    void release();
+
+    // Generuje teksturę z mipmapami, przyjmuje parametry: opis powierzchni, szerokość i wysokość tekstury
+    unsigned int bake(const ProceduralSurface& surface, int width = 1024, int height = 512);
+
+private:
+    unsigned int program = 0;
+    unsigned int emptyVAO = 0;
+    unsigned int framebuffer = 0;
+};
@@ -0,0 +1,113 @@
+﻿#include "scene.h"
+#include <cmath>
+#include "seeded_random.h"
+
+// Funkcja tworząca elementy orbity, przyjmuje parametry: półoś wielka, prędkość (stopnie na sekundę), mimośród,
+// nachylenie, długość węzła wstępującego i argument perycentrum (stopnie)
+static OrbitalElements orbit(float semiMajorAxis, float speed, float eccentricity = 0.0f, float inclination = 0.0f,
+    float ascendingNode = 0.0f, float periapsisArgument = 0.0f) {
+    OrbitalElements elements;
+    elements.semiMajorAxis = semiMajorAxis;
+    elements.meanMotion = speed;
+    elements.eccentricity = eccentricity;
+    elements.inclination = inclination;
+    elements.ascendingNode = ascendingNode;
+    elements.periapsisArgument = periapsisArgument;
+    return elements;
+}
+
+// Funkcja budująca scenę, przyjmuje parametr: pusty magazyn ciał
+SolarSystemBodies buildSolarSystem(BodyStore& bodies) {
+    SolarSystemBodies s;
+    s.sun = bodies.add(-1, 0.7f, 1.0f, 1.0f, 0.0f);
+
+    // Mimośrody, nachylenia i kąty orbit planet według rzeczywistych elementów (J2000), półosie i prędkości w skali sceny
+    // Merkury
+    s.mercury = bodies.add(s.sun, 0.10f, 0.5f, 0.5f, 0.5f, orbit(2.5f, 30.0f, 0.2056f, 7.00f, 48.33f, 29.12f));
+
+    // Wenus
+    s.venus = bodies.add(s.sun, 0.18f, 0.9f, 0.7f, 0.2f, orbit(3.5f, 22.5f, 0.0068f, 3.39f, 76.68f, 54.88f));
+
+    // Ziemia + Księżyc
+    s.earth = bodies.add(s.sun, 0.22f, 0.2f, 0.6f, 1.0f, orbit(5.0f, 17.5f, 0.0167f, 0.0f, 0.0f, 102.94f));
+    s.moon = bodies.add(s.earth, 0.05f, 0.8f, 0.8f, 0.8f, orbit(0.5f, 100.0f, 0.0549f, 5.15f));
+
+    // Mars + Deimos i Phobos
+    s.mars = bodies.add(s.sun, 0.15f, 0.8f, 0.3f, 0.2f, orbit(6.5f, 14.0f, 0.0934f, 1.85f, 49.56f, 286.50f));
+    s.phobos = bodies.add(s.mars, 0.03f, 0.6f, 0.6f, 0.6f, orbit(0.3f, 120.0f));
+    s.deimos = bodies.add(s.mars, 0.02f, 0.7f, 0.7f, 0.7f, orbit(0.5f, 90.0f));
+
+    // Jowisz + Księżyce: Io, Europa, Ganymede, Callisto
+    s.jupiter = bodies.add(s.sun, 0.45f, 0.9f, 0.8f, 0.6f, orbit(8.5f, 9.0f, 0.0489f, 1.30f, 100.46f, 273.87f));
+    float jMoonSize = 0.05f;
+    s.io = bodies.add(s.jupiter, jMoonSize, 0.9f, 0.6f, 0.3f, orbit(0.7f, 55.0f));
+    s.europa = bodies.add(s.jupiter, jMoonSize, 0.6f, 0.8f, 1.0f, orbit(0.9f, 50.0f));
+    s.ganymede = bodies.add(s.jupiter, jMoonSize, 0.4f, 0.7f, 0.9f, orbit(1.2f, 45.0f));
+    s.callisto = bodies.add(s.jupiter, jMoonSize, 0.6f, 0.5f, 0.4f, orbit(1.5f, 40.0f));
+
+    // Saturn + Tytan
+    s.saturn = bodies.add(s.sun, 0.40f, 0.9f, 0.85f, 0.5f, orbit(10.5f, 7.0f, 0.0565f, 2.49f, 113.67f, 339.39f));
+    s.tytan = bodies.add(s.saturn, 0.06f, 0.8f, 0.7f, 0.4f, orbit(1.0f, 42.5f, 0.0288f));
+
+    // Uran + Miranda
+    s.uranus = bodies.add(s.sun, 0.30f, 0.6f, 0.9f, 0.9f, orbit(12.0f, 5.0f, 0.0463f, 0.77f, 74.01f, 96.99f));
+    s.miranda = bodies.add(s.uranus, 0.03f, 0.6f, 0.6f, 0.8f, orbit(0.8f, 45.0f));
+
+    // Neptun + Tryton (orbita wsteczna)
+    s.neptune = bodies.add(s.sun, 0.28f, 0.4f, 0.5f, 0.9f, orbit(13.5f, 4.0f, 0.0087f, 1.77f, 131.78f, 273.19f));
+    s.tryton = bodies.add(s.neptune, 0.04f, 0.5f, 0.7f, 0.9f, orbit(0.7f, 47.5f, 0.0f, 156.9f));
+
+    // Pluton + Charon: oba krążą wokół wspólnego środka masy leżącego poza Plutonem. Barycentrum jest niewidocznym
+    // ciałem (promień 0) na orbicie Plutona wokół Słońca, w rezonansie 3:2 z Neptunem; Pluton i Charon są jego
+    // dziećmi na przeciwległych orbitach (perycentra co 180 stopni) o półosiach w stosunku odwrotnym do mas
+    s.plutoCharon = bodies.add(s.sun, 0.0f, 0.0f, 0.0f, 0.0f, orbit(16.0f, 4.0f * 2.0f / 3.0f, 0.2488f, 17.16f, 110.30f, 113.83f));
+    const float separation = 0.45f;
+    const float charonFraction = 0.1086f; // m_Charon / (m_Pluton + m_Charon)
+    s.pluto = bodies.add(s.plutoCharon, 0.04f, 0.8f, 0.7f, 0.6f,
+        orbit(separation * charonFraction, 60.0f, 0.0f, 112.9f, 223.0f, 0.0f));
+    s.charon = bodies.add(s.plutoCharon, 0.02f, 0.6f, 0.6f, 0.6f,
+        orbit(separation * (1.0f - charonFraction), 60.0f, 0.0f, 112.9f, 223.0f, 180.0f));
+
+    // Masy (GM) dla cząstek w trybie grawitacyjnym: Słońce dobrane tak, żeby orbita kołowa na wysokości Ziemi
+    // miała prędkość zbliżoną do kinematycznej, planety w rzeczywistych proporcjach do Słońca; księżyce pomijamy
+    bodies.mass[s.sun] = 12.0f;
+    bodies.mass[s.mercury] = 2.0e-6f;
+    bodies.mass[s.venus] = 2.95e-5f;
+    bodies.mass[s.earth] = 3.6e-5f;
+    bodies.mass[s.mars] = 3.9e-6f;
+    bodies.mass[s.jupiter] = 1.146e-2f;
+    bodies.mass[s.saturn] = 3.43e-3f;
+    bodies.mass[s.uranus] = 5.24e-4f;
+    bodies.mass[s.neptune] = 6.79e-4f;
+
+    // Księżyce za planetami, pogrupowane po rodzicu, żeby przejścia po tablicach były liniowe
+    std::vector<int> remap = bodies.sortByParent();
+    int* indices[] = { &s.sun, &s.mercury, &s.venus, &s.earth, &s.moon, &s.mars, &s.phobos, &s.deimos,
+        &s.jupiter, &s.io, &s.europa, &s.ganymede, &s.callisto, &s.saturn, &s.tytan,
+        &s.uranus, &s.miranda, &s.neptune, &s.tryton, &s.plutoCharon, &s.pluto, &s.charon };
+    for (int* index : indices) {
+        *index = remap[*index];
+    }
+    return s;
+}
+
+// Funkcja tworząca rodzinę planetoid, przyjmuje parametry: system cząstek, liczba cząstek i ziarno generatora
+void initializeDebris(ParticleSystem& debris, size_t count, uint32_t seed) {
+    SeededRandom random(seed);
+
+    // Odłamki po zderzeniu: skupione wokół jednego miejsca orbity, na orbitach prawie kołowych
+    // wokół Słońca (GM = 12) z niewielkim rozrzutem prędkości; łączna masa rzędu masy Ziemi
+    const float sunMass = 12.0f;
+    const float familyAngle = 1.0f;
+    debris.particles.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        float r = 7.5f + 0.25f * random.normal();
+        float angle = familyAngle + 0.3f * random.normal();
+        float speed = std::sqrt(sunMass / r) * (1.0f + 0.02f * random.normal());
+        float x = r * std::cos(angle);
+        float z = r * std::sin(angle);
+        float y = 0.05f * random.normal();
+        float vy = 0.02f * speed * random.normal();
+        debris.particles.add(x, y, z, -std::sin(angle) * speed, vy, std::cos(angle) * speed, 3.0e-5f / count);
+    }
+}
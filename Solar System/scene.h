@@ -0,0 +1,20 @@
+﻿#pragma once
+#include <cstddef>
+#include <cstdint>
+#include "body_store.h"
+#include "particle_system.h"
+
+// Indeksy ciał sceny w magazynie po sortByParent, żeby kod rysujący mógł przypisać im tekstury
+struct SolarSystemBodies {
+    int sun, mercury, venus, earth, moon, mars, phobos, deimos;
+    int jupiter, io, europa, ganymede, callisto, saturn, tytan;
+    int uranus, miranda, neptune, tryton, plutoCharon, pluto, charon;
+};
+
+// Funkcja budująca scenę bez okna i tekstur: Słońce, planety z księżycami, orbity i masy, ciała posortowane
+// po rodzicu. Zwraca indeksy ciał, przyjmuje parametr: pusty magazyn ciał
+SolarSystemBodies buildSolarSystem(BodyStore& bodies);
+
+// Funkcja tworząca rodzinę planetoid między Marsem a Jowiszem, przyjmuje parametry: system cząstek, liczba cząstek
+// i ziarno generatora; to samo ziarno daje tę samą rodzinę w każdym kompilatorze
+void initializeDebris(ParticleSystem& debris, size_t count, uint32_t seed = 2024);
@@ -0,0 +1,35 @@
+﻿#pragma once
+#include <cmath>
+#include <cstdint>
+#include <random>
+
+// Generator liczb losowych o wynikach niezależnych od biblioteki standardowej: sekwencja mt19937 jest
+// określona przez standard, ale rozkłady (uniform_real_distribution, normal_distribution) każda biblioteka
+// liczy inaczej, więc ten sam ziarno dawałoby różne sceny w różnych kompilatorach
+class SeededRandom {
+public:
+    explicit SeededRandom(uint32_t seed) : engine(seed) {}
+
+    // Liczba z przedziału 0..1 (bez 1) z 24 najstarszych bitów, dokładnie reprezentowalna we float
+    float unit() { return (float)(engine() >> 8) * (1.0f / 16777216.0f); }
+
+    // Rozkład normalny N(0, 1) metodą Boxa–Mullera, drugi wynik pary jest zapamiętywany
+    float normal() {
+        if (hasSpare) {
+            hasSpare = false;
+            return spare;
+        }
+        float u = 1.0f - unit(); // 0..1 bez 0, żeby logarytm był skończony
+        float v = unit();
+        float radius = std::sqrt(-2.0f * std::log(u));
+        float angle = 6.28318530717958647692f * v;
+        spare = radius * std::sin(angle);
+        hasSpare = true;
+        return radius * std::cos(angle);
+    }
+
+private:
+    std::mt19937 engine;
+    float spare = 0.0f;
+    bool hasSpare = false;
+};
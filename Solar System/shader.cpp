@@ -0,0 +1,267 @@
+﻿#include "shader.h"
+#include <glad/glad.h>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#ifndef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+#   define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#endif
+#ifndef GL_PROGRAM_BINARY_LENGTH
+#   define GL_PROGRAM_BINARY_LENGTH 0x8741
+#endif
+#ifndef GL_NUM_PROGRAM_BINARY_FORMATS
+#   define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#endif
+
+// Funkcje z GL 4.1 / rozszerzeń ładowane ręcznie, bo kontekst to 3.3 core
+typedef void (APIENTRY* GetProgramBinaryFunc)(GLuint program, GLsizei bufSize, GLsizei* length, GLenum* binaryFormat, void* binary);
+typedef void (APIENTRY* ProgramBinaryFunc)(GLuint program, GLenum binaryFormat, const void* binary, GLsizei length);
+typedef void (APIENTRY* ProgramParameteriFunc)(GLuint program, GLenum pname, GLint value);
+typedef void (APIENTRY* MaxShaderCompilerThreadsFunc)(GLuint count);
+
+// Nagłówek pliku z binarnym programem
+struct ProgramBinaryHeader {
+    char magic[4];      // "SSPB"
+    uint32_t version;
+    uint64_t key;       // Skrót źródeł i sterownika
+    uint32_t format;    // Format binarny zwrócony przez sterownik
+    uint32_t length;
+};
+
+static struct {
+    bool enabled = false;
+    std::string directory;
+    std::string driver; // Producent, renderer i wersja sterownika
+    GetProgramBinaryFunc getProgramBinary = nullptr;
+    ProgramBinaryFunc programBinary = nullptr;
+    ProgramParameteriFunc programParameteri = nullptr;
+    bool parallelCompile = false;
+    ProgramCacheStats stats;
+} cache;
+
+// Skrót FNV-1a 64-bitowy, przyjmuje parametry: poprzedni skrót i dane
+static uint64_t hashBytes(uint64_t hash, const char* data, size_t size) {
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= (unsigned char)data[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+static uint64_t programKey(const char* vertexSource, const char* fragmentSource) {
+    uint64_t hash = 14695981039346656037ull;
+    hash = hashBytes(hash, cache.driver.c_str(), cache.driver.size() + 1);
+    hash = hashBytes(hash, vertexSource, strlen(vertexSource) + 1);
+    hash = hashBytes(hash, fragmentSource, strlen(fragmentSource) + 1);
+    return hash;
+}
+
+static std::string programPath(uint64_t key) {
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.bin", (unsigned long long)key);
+    return cache.directory + "/" + name;
+}
+
+static bool hasExtension(const char* name) {
+    int count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (int i = 0; i < count; ++i) {
+        const char* extension = (const char*)glGetStringi(GL_EXTENSIONS, i);
+        if (extension && strcmp(extension, name) == 0)
+            return true;
+    }
+    return false;
+}
+
+// Funkcja włączająca cache, przyjmuje parametry: katalog i funkcja ładująca funkcje OpenGL
+void initializeProgramCache(const char* directory, void* (*loader)(const char*)) {
+    cache.directory = directory;
+    cache.driver = std::string((const char*)glGetString(GL_VENDOR)) + "|"
+        + (const char*)glGetString(GL_RENDERER) + "|" + (const char*)glGetString(GL_VERSION);
+
+    cache.getProgramBinary = (GetProgramBinaryFunc)loader("glGetProgramBinary");
+    cache.programBinary = (ProgramBinaryFunc)loader("glProgramBinary");
+    cache.programParameteri = (ProgramParameteriFunc)loader("glProgramParameteri");
+
+    int formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    cache.enabled = cache.getProgramBinary && cache.programBinary && cache.programParameteri && formats > 0;
+
+    std::error_code error;
+    std::filesystem::create_directories(cache.directory, error);
+    if (error)
+        cache.enabled = false;
+
+    // Równoległa kompilacja, jeśli sterownik ją wspiera
+    MaxShaderCompilerThreadsFunc maxThreads = nullptr;
+    if (hasExtension("GL_KHR_parallel_shader_compile"))
+        maxThreads = (MaxShaderCompilerThreadsFunc)loader("glMaxShaderCompilerThreadsKHR");
+    else if (hasExtension("GL_ARB_parallel_shader_compile"))
+        maxThreads = (MaxShaderCompilerThreadsFunc)loader("glMaxShaderCompilerThreadsARB");
+    if (maxThreads) {
+        maxThreads(0xFFFFFFFF); // Tyle wątków, ile sterownik uzna za stosowne
+        cache.parallelCompile = true;
+    }
+}
+
+// Próbuje wczytać program z cache, przyjmuje parametr: klucz programu
+static unsigned int loadProgramBinary(uint64_t key) {
+    std::ifstream file(programPath(key), std::ios::binary);
+    if (!file)
+        return 0;
+
+    ProgramBinaryHeader header;
+    if (!file.read((char*)&header, sizeof(header)) || memcmp(header.magic, "SSPB", 4) != 0
+        || header.version != 1 || header.key != key) {
+        return 0;
+    }
+    std::vector<char> binary(header.length);
+    if (!file.read(binary.data(), binary.size()))
+        return 0;
+
+    unsigned int program = glCreateProgram();
+    cache.programBinary(program, header.format, binary.data(), (GLsizei)binary.size());
+
+    int success;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if (!success) {
+        // Sterownik nie przyjął binariów, kompilujemy od nowa
+        glDeleteProgram(program);
+        ++cache.stats.rejected;
+        return 0;
+    }
+    return program;
+}
+
+// Zapisuje zlinkowany program do cache, przyjmuje parametry: klucz i program
+static void saveProgramBinary(uint64_t key, unsigned int program) {
+    int length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0)
+        return;
+
+    std::vector<char> binary(length);
+    GLenum format = 0;
+    GLsizei written = 0;
+    cache.getProgramBinary(program, length, &written, &format, binary.data());
+    if (written <= 0)
+        return;
+
+    ProgramBinaryHeader header;
+    memcpy(header.magic, "SSPB", 4);
+    header.version = 1;
+    header.key = key;
+    header.format = format;
+    header.length = (uint32_t)written;
+
+    std::ofstream file(programPath(key), std::ios::binary | std::ios::trunc);
+    file.write((const char*)&header, sizeof(header));
+    file.write(binary.data(), written);
+    if (file)
+        ++cache.stats.saved;
+}
+
+std::vector<unsigned int> createPrograms(const std::vector<ProgramSource>& sources) {
+    auto start = std::chrono::steady_clock::now();
+
+    struct Pending {
+        size_t index;
+        uint64_t key;
+        unsigned int vertexShader;
+        unsigned int fragmentShader;
+    };
+    std::vector<unsigned int> programs(sources.size(), 0);
+    std::vector<Pending> pending;
+
+    // Najpierw trafienia w cache, dla pozostałych tylko zlecamy kompilację i linkowanie
+    for (size_t i = 0; i < sources.size(); ++i) {
+        uint64_t key = cache.enabled ? programKey(sources[i].vertexSource, sources[i].fragmentSource) : 0;
+        if (cache.enabled) {
+            programs[i] = loadProgramBinary(key);
+            if (programs[i] != 0) {
+                ++cache.stats.hits;
+                continue;
+            }
+        }
+        ++cache.stats.misses;
+
+        unsigned int vertexShader = glCreateShader(GL_VERTEX_SHADER);
+        glShaderSource(vertexShader, 1, &sources[i].vertexSource, NULL);
+        glCompileShader(vertexShader);
+
+        unsigned int fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
+        glShaderSource(fragmentShader, 1, &sources[i].fragmentSource, NULL);
+        glCompileShader(fragmentShader);
+
+        programs[i] = glCreateProgram();
+        if (cache.enabled)
+            cache.programParameteri(programs[i], GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+        glAttachShader(programs[i], vertexShader);
+        glAttachShader(programs[i], fragmentShader);
+        glLinkProgram(programs[i]);
+
+        pending.push_back({ i, key, vertexShader, fragmentShader });
+    }
+
+    // Sprawdzanie wyników dopiero po zleceniu wszystkich kompilacji
+    for (const Pending& item : pending) {
+        int success;
+        char infoLog[512];
+        unsigned int program = programs[item.index];
+
+        glGetShaderiv(item.vertexShader, GL_COMPILE_STATUS, &success);
+        if (!success) {
+            glGetShaderInfoLog(item.vertexShader, 512, NULL, infoLog);
+            std::cout << "ERROR::SHADER::VERTEX::COMPILATION_FAILED\n" << infoLog << std::endl;
+        }
+
+        glGetShaderiv(item.fragmentShader, GL_COMPILE_STATUS, &success);
+        if (!success) {
+            glGetShaderInfoLog(item.fragmentShader, 512, NULL, infoLog);
+            std::cout << "ERROR::SHADER::FRAGMENT::COMPILATION_FAILED\n" << infoLog << std::endl;
+        }
+
+        glGetProgramiv(program, GL_LINK_STATUS, &success);
+        if (!success) {
+            glGetProgramInfoLog(program, 512, NULL, infoLog);
+            std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
+        }
+        else if (cache.enabled) {
+            saveProgramBinary(item.key, program);
+        }
+
+        glDeleteShader(item.vertexShader);
+        glDeleteShader(item.fragmentShader);
+    }
+
+    cache.stats.milliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return programs;
+}
+
+// Kompiluje i linkuje program shaderów, przyjmuje parametry: źródła vertex i fragment shadera
+unsigned int createProgram(const char* vertexSource, const char* fragmentSource) {
+    return createPrograms({ { vertexSource, fragmentSource } })[0];
+}
+
+// Funkcja podpinająca blok Frame, przyjmuje parametr: program
+void bindFrameUniforms(unsigned int program) {
+    unsigned int index = glGetUniformBlockIndex(program, "Frame");
+    if (index != GL_INVALID_INDEX)
+        glUniformBlockBinding(program, index, frameUniformBinding);
+}
+
+const ProgramCacheStats& programCacheStats() {
+    return cache.stats;
+}
+
+void printProgramCacheStats() {
+    std::cout << "Shader programs: " << cache.stats.hits << " from cache, " << cache.stats.misses << " compiled"
+        << (cache.parallelCompile ? " (parallel)" : "")
+        << ", " << cache.stats.rejected << " rejected, " << cache.stats.saved << " saved"
+        << ", " << cache.stats.milliseconds << " ms" << (cache.enabled ? "" : ", binary cache unavailable") << std::endl;
+}
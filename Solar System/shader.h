@@ -0,0 +1,36 @@
+﻿#pragma once
+#include <vector>
+
+// Źródła jednego programu shaderów
+struct ProgramSource {
+    const char* vertexSource;
+    const char* fragmentSource;
+};
+
+// Statystyki cache binarnych programów
+struct ProgramCacheStats {
+    int hits = 0;          // Programy wczytane z binariów
+    int misses = 0;        // Programy skompilowane od zera
+    int rejected = 0;      // Binaria odrzucone przez sterownik, np. po aktualizacji
+    int saved = 0;         // Zapisane binaria
+    double milliseconds = 0.0; // Łączny czas tworzenia programów
+};
+
+// Punkt wiązania bufora uniformów Frame (widok, projekcja, światło) wspólnego dla programów sceny
+const unsigned int frameUniformBinding = 0;
+
+// Podpina blok Frame programu do wspólnego punktu wiązania, przyjmuje parametr: program
+void bindFrameUniforms(unsigned int program);
+
+// Włącza cache binarnych programów w katalogu directory, przyjmuje parametry: katalog i funkcja ładująca funkcje OpenGL
+void initializeProgramCache(const char* directory, void* (*loader)(const char*));
+
+// Kompiluje i linkuje program shaderów, przyjmuje parametry: źródła vertex i fragment shadera
+unsigned int createProgram(const char* vertexSource, const char* fragmentSource);
+
+// Tworzy wiele programów naraz: najpierw zleca wszystkie kompilacje, dopiero potem sprawdza wyniki,
+// dzięki czemu sterownik z GL_KHR_parallel_shader_compile kompiluje je równolegle
+std::vector<unsigned int> createPrograms(const std::vector<ProgramSource>& sources);
+
+const ProgramCacheStats& programCacheStats();
+void printProgramCacheStats();
@@ -0,0 +1,77 @@
+﻿#include "shader_permutations.h"
+#include <glad/glad.h>
+#include "shader.h"
+
+// Wstawia definicje zaraz po linii #version, przyjmuje parametry: źródło i definicje
+static std::string injectDefines(const char* source, const std::string& defines) {
+    std::string result = source;
+    size_t version = result.find("#version");
+    size_t lineEnd = version == std::string::npos ? 0 : result.find('\n', version) + 1;
+    result.insert(lineEnd, defines);
+    return result;
+}
+
+std::string ShaderPermutations::defines(unsigned int key) {
+    std::string result;
+    if (key & ShaderTextured)
+        result += "#define TEXTURED\n";
+    if (key & ShaderVirtualTexture)
+        result += "#define VIRTUAL_TEXTURE\n";
+    if (key & ShaderEmissive)
+        result += "#define EMISSIVE\n";
+    if (key & ShaderLine)
+        result += "#define LINE\n";
+    return result;
+}
+
+void ShaderPermutations::initialize(const char* vertexSource, const char* fragmentSource, const std::vector<unsigned int>& keys) {
+    this->vertexSource = vertexSource;
+    this->fragmentSource = fragmentSource;
+    build(keys);
+}
+
+// Kompiluje warianty jedną partią, żeby sterownik mógł je kompilować równolegle
+void ShaderPermutations::build(const std::vector<unsigned int>& keys) {
+    std::vector<std::string> vertexSources, fragmentSources;
+    for (unsigned int key : keys) {
+        vertexSources.push_back(injectDefines(vertexSource, defines(key)));
+        fragmentSources.push_back(injectDefines(fragmentSource, defines(key)));
+    }
+
+    std::vector<ProgramSource> sources;
+    for (size_t i = 0; i < keys.size(); ++i)
+        sources.push_back({ vertexSources[i].c_str(), fragmentSources[i].c_str() });
+    std::vector<unsigned int> programs = createPrograms(sources);
+
+    for (size_t i = 0; i < keys.size(); ++i) {
+        unsigned int program = programs[i];
+        bindFrameUniforms(program);
+
+        // Jednostki tekstur ustawione raz, różne typy samplerów nie mogą dzielić jednostki
+        glUseProgram(program);
+        glUniform1i(glGetUniformLocation(program, "texture1"), 0);
+        glUniform1i(glGetUniformLocation(program, "vtPhysical"), 1);
+        glUniform1i(glGetUniformLocation(program, "vtIndirection"), 2);
+
+        variants[keys[i]] = program;
+    }
+    glUseProgram(currentProgram);
+}
+
+unsigned int ShaderPermutations::program(unsigned int key) {
+    auto it = variants.find(key);
+    if (it == variants.end()) {
+        build({ key });
+        it = variants.find(key);
+    }
+    return it->second;
+}
+
+unsigned int ShaderPermutations::use(unsigned int key) {
+    unsigned int selected = program(key);
+    if (selected != currentProgram) {
+        glUseProgram(selected);
+        currentProgram = selected;
+    }
+    return selected;
+}
@@ -0,0 +1,39 @@
+﻿#pragma once
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Cechy wariantu programu, każda włącza jedną definicję preprocesora w shaderach
+enum ShaderFeature : unsigned int {
+    ShaderTextured = 1 << 0,       // TEXTURED - kolor z tekstury
+    ShaderVirtualTexture = 1 << 1, // VIRTUAL_TEXTURE - kolor z tekstury wirtualnej
+    ShaderEmissive = 1 << 2,       // EMISSIVE - ciało świecące, bez oświetlenia rozproszonego
+    ShaderLine = 1 << 3            // LINE - linie orbit, stały kolor bez normalnych i oświetlenia
+};
+
+// Zbiór wyspecjalizowanych wariantów jednego programu, wybieranych po kluczu z cech
+class ShaderPermutations {
+public:
+    // Buduje warianty dla podanych kluczy jedną partią, przyjmuje parametry: źródła shaderów i lista kluczy
+    void initialize(const char* vertexSource, const char* fragmentSource, const std::vector<unsigned int>& keys);
+
+    // Zwraca program dla klucza, brakujący wariant jest budowany na żądanie
+    unsigned int program(unsigned int key);
+
+    // Ustawia program jako aktywny, jeśli nie był już aktywny
+    unsigned int use(unsigned int key);
+
+    // Zapomina aktywny program, gdy ktoś inny wywołał glUseProgram
+    void invalidate() { currentProgram = 0; }
+
+    // Definicje preprocesora dla klucza, np. "#define TEXTURED\n"
+    static std::string defines(unsigned int key);
+
+private:
+    void build(const std::vector<unsigned int>& keys);
+
+    const char* vertexSource = nullptr;
+    const char* fragmentSource = nullptr;
+    std::unordered_map<unsigned int, unsigned int> variants;
+    unsigned int currentProgram = 0;
+};
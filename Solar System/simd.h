@@ -0,0 +1,21 @@
+﻿#pragma once
+
+// Wybór zestawu instrukcji wektorowych na etapie kompilacji, wspólny dla jąder SIMD.
+// Wariant AVX2 jest kompilowany zawsze na x86-64 i wybierany w czasie działania (patrz orbit_kernel.h)
+#if defined(_M_X64) || defined(__x86_64__)
+#   define SIMD_X86 1
+#   include <immintrin.h>
+#   ifdef _MSC_VER
+#       include <intrin.h>
+#   endif
+#elif defined(_M_ARM64) || defined(__aarch64__)
+#   define SIMD_NEON 1
+#   include <arm_neon.h>
+#endif
+
+// GCC i Clang kompilują funkcje AVX2 tylko z atrybutem celu, MSVC pozwala na intrinsics bez flag
+#if defined(SIMD_X86) && (defined(__GNUC__) || defined(__clang__))
+#   define TARGET_AVX2 __attribute__((target("avx2,fma")))
+#else
+#   define TARGET_AVX2
+#endif
@@ -0,0 +1,298 @@
+﻿// Symulacja bez okna: scena z buildSolarSystem, zadany czas symulacji przeliczony stałymi krokami na puli wątków,
+// na końcu opcjonalnie plik stanu i pozycje. Korzysta tylko z rdzenia symulacji, bez GLFW i OpenGL, więc działa
+// na maszynie bez ekranu (pomiary, długie przebiegi, porównywanie skrótów stanu między maszynami)
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <exception>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+#include "checkpoint.h"
+#include "event_finder.h"
+#include "options.h"
+#include "orbit_kernel.h"
+#include "parallel.h"
+#include "scene.h"
+#include "simulation.h"
+
+// Funkcja wypisująca opcje programu, przyjmuje parametr: nazwa programu
+static void printUsage(const char* program) {
+    std::cout << "Usage: " << program << " [options]\n"
+        << "  --span S                 simulated seconds to advance (default 60)\n"
+        << "  --step DT                fixed step in simulated seconds (default 1/60, as in the viewer)\n"
+        << "  --threads N              worker threads of the pool\n"
+        << "  --debris [N]             asteroid family of N particles (default 100000)\n"
+        << "  --nbody [leapfrog|yoshida|block]  planets attract each other\n"
+        << "  --time T                 start time in seconds (without debris and gravity)\n"
+        << "  --ephemeris FILE         body positions from an ephemeris file\n"
+        << "  --contacts [FACTOR]      close approach and collision detection\n"
+        << "  --deterministic [SEED]   reproducible run: scalar kernel, seeded debris\n"
+        << "  --hash-log FILE          state hash after every step of a deterministic run\n"
+        << "  --restore FILE           start from a checkpoint\n"
+        << "  --checkpoint FILE        write a checkpoint at the end\n"
+        << "  --positions FILE         write final positions as CSV (bodies, then particles)\n"
+        << "  --events FILE            instead of stepping, find eclipses, transits, occultations and\n"
+        << "                           conjunctions seen from Earth and the Sun over the span, sampled at --step\n";
+}
+
+// Funkcja zwracająca nazwy ciał sceny po indeksie, przyjmuje parametry: indeksy ciał i liczba ciał
+static std::vector<std::string> bodyNames(const SolarSystemBodies& s, size_t count) {
+    std::vector<std::string> names(count);
+    for (size_t i = 0; i < count; ++i) {
+        names[i] = "body " + std::to_string(i);
+    }
+    const std::pair<int, const char*> known[] = { { s.sun, "Sun" }, { s.mercury, "Mercury" }, { s.venus, "Venus" },
+        { s.earth, "Earth" }, { s.moon, "Moon" }, { s.mars, "Mars" }, { s.phobos, "Phobos" }, { s.deimos, "Deimos" },
+        { s.jupiter, "Jupiter" }, { s.io, "Io" }, { s.europa, "Europa" }, { s.ganymede, "Ganymede" },
+        { s.callisto, "Callisto" }, { s.saturn, "Saturn" }, { s.tytan, "Titan" }, { s.uranus, "Uranus" },
+        { s.miranda, "Miranda" }, { s.neptune, "Neptune" }, { s.tryton, "Triton" }, { s.plutoCharon, "Pluto-Charon" },
+        { s.pluto, "Pluto" }, { s.charon, "Charon" } };
+    for (const auto& body : known) {
+        names[body.first] = body.second;
+    }
+    return names;
+}
+
+// Funkcja szukająca zjawisk w oknie [t, t + span] i zapisująca tabelę CSV, przyjmuje parametry: symulacja,
+// indeksy ciał, długość okna, krok próbkowania i ścieżka
+static bool findEvents(const Simulation& simulation, const SolarSystemBodies& scene, double span, double step, const std::string& path) {
+    EventSearchSettings settings;
+    settings.observers = { scene.earth, scene.sun };
+    settings.lightSource = scene.sun;
+    settings.step = step;
+    EventSearchStats stats;
+    double begin = simulation.time();
+    std::vector<SkyEvent> events = findSkyEvents(simulation.bodies(), simulation.ephemerisSource(), begin, begin + span, settings, &stats);
+    std::cout << "Events: " << events.size() << " found in t = " << begin << ".." << begin + span << " s, " << stats.pairs
+        << " pairs, " << stats.samples << " samples, " << stats.evaluations << " evaluations, " << stats.milliseconds
+        << " ms, " << workerCount() << " threads" << std::endl;
+
+    std::vector<std::string> names = bodyNames(scene, simulation.bodyCount());
+    size_t counts[5] = {};
+    for (const SkyEvent& event : events) {
+        ++counts[(int)event.type];
+    }
+    for (int type = 0; type < 5; ++type) {
+        std::cout << "  " << skyEventName((SkyEventType)type) << ": " << counts[type] << std::endl;
+    }
+
+    std::ofstream file(path);
+    if (!file) {
+        std::cout << "Failed to write events: " << path << std::endl;
+        return false;
+    }
+    file << "type,observer,front,back,begin,peak,end,separation,front radius,back radius,central,clipped\n" << std::setprecision(12);
+    for (const SkyEvent& event : events) {
+        file << skyEventName(event.type) << ',' << names[event.observer] << ',' << names[event.front] << ',' << names[event.back]
+            << ',' << event.begin << ',' << event.peak << ',' << event.end << ',' << event.separation << ',' << event.frontRadius
+            << ',' << event.backRadius << ',' << (event.central ? 1 : 0) << ',' << (event.clipped ? 1 : 0) << '\n';
+    }
+    return (bool)file;
+}
+
+// Funkcja zapisująca pozycje ciał i cząstek jako CSV, przyjmuje parametry: symulacja i ścieżka
+static bool writePositions(const Simulation& simulation, const std::string& path) {
+    std::ofstream file(path);
+    if (!file)
+        return false;
+    std::vector<float> bodies, particles;
+    simulation.copyPositions(bodies);
+    simulation.copyParticlePositions(particles);
+    file << "kind,index,x,y,z\n" << std::setprecision(9);
+    for (size_t i = 0; i < bodies.size() / 3; ++i) {
+        file << "body," << i << ',' << bodies[i * 3] << ',' << bodies[i * 3 + 1] << ',' << bodies[i * 3 + 2] << '\n';
+    }
+    for (size_t i = 0; i < particles.size() / 3; ++i) {
+        file << "particle," << i << ',' << particles[i * 3] << ',' << particles[i * 3 + 1] << ',' << particles[i * 3 + 2] << '\n';
+    }
+    return (bool)file;
+}
+
+int main(int argc, char** argv)
+{
+    double span = 60.0, stepSize = 1.0 / 60.0;
+    size_t debrisCount = 0;
+    double startTime = 0.0;
+    std::string ephemerisPath, hashLogPath, restorePath, checkpointPath, positionsPath, eventsPath;
+    bool gravity = false;
+    float contactFactor = 0.0f;
+    bool deterministic = false;
+    uint32_t debrisSeed = 2024;
+    Integrator integrator = Integrator::Yoshida4;
+    for (int i = 1; i < argc; ++i) {
+        std::string option = argv[i];
+        bool hasValue = optionHasValue(i, argc, argv);
+        try {
+            if (option == "--span" && hasValue) {
+                span = toNumber(argv[++i]);
+            }
+            else if (option == "--step" && hasValue) {
+                stepSize = toNumber(argv[++i]);
+            }
+            else if (option == "--threads" && hasValue) {
+                setWorkerCount((unsigned int)toCount(argv[++i]));
+            }
+            else if (option == "--debris") {
+                debrisCount = hasValue ? (size_t)toCount(argv[++i]) : 100000;
+            }
+            else if (option == "--nbody") {
+                gravity = true;
+                std::string name = hasValue ? argv[++i] : "";
+                integrator = name == "leapfrog" ? Integrator::Leapfrog : name == "block" ? Integrator::BlockLeapfrog : Integrator::Yoshida4;
+            }
+            else if (option == "--time" && hasValue) {
+                startTime = toNumber(argv[++i]);
+            }
+            else if (option == "--ephemeris" && hasValue) {
+                ephemerisPath = argv[++i];
+            }
+            else if (option == "--contacts") {
+                contactFactor = hasValue ? (float)toNumber(argv[++i]) : 3.0f;
+            }
+            else if (option == "--deterministic") {
+                deterministic = true;
+                if (hasValue)
+                    debrisSeed = (uint32_t)toCount(argv[++i]);
+            }
+            else if (option == "--hash-log" && hasValue) {
+                hashLogPath = argv[++i];
+            }
+            else if (option == "--restore" && hasValue) {
+                restorePath = argv[++i];
+            }
+            else if (option == "--checkpoint" && hasValue) {
+                checkpointPath = argv[++i];
+            }
+            else if (option == "--positions" && hasValue) {
+                positionsPath = argv[++i];
+            }
+            else if (option == "--events" && hasValue) {
+                eventsPath = argv[++i];
+            }
+            else {
+                if (option != "--help")
+                    std::cout << "Unknown option or missing value: " << option << std::endl;
+                printUsage(argv[0]);
+                return option == "--help" ? 0 : 1;
+            }
+        }
+        catch (const std::exception&) {
+            printInvalidOption(option);
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+    if (!(stepSize > 0.0) || !(span >= 0.0)) {
+        std::cout << "--step must be positive and --span non-negative" << std::endl;
+        return 1;
+    }
+
+    // Warianty SIMD różnią się zaokrągleniami (FMA), więc powtarzalność między maszynami daje tylko jądro skalarne
+    if (deterministic)
+        setOrbitKernel(OrbitKernel::Scalar);
+
+    // Ta sama scena i ta sama rodzina planetoid co w oknie, więc pliki stanu i skróty są wymienne
+    BodyStore bodies;
+    SolarSystemBodies scene = buildSolarSystem(bodies);
+    ParticleSystem debris;
+    initializeDebris(debris, debrisCount, debrisSeed);
+    Simulation simulation(bodies, debris);
+    if (!ephemerisPath.empty()) {
+        auto ephemeris = std::make_shared<Ephemeris>();
+        if (!ephemeris->open(ephemerisPath.c_str(), bodies.size())) {
+            std::cout << "Failed to open ephemeris: " << ephemerisPath << std::endl;
+            return 1;
+        }
+        simulation.setEphemeris(ephemeris);
+    }
+    if (startTime != 0.0 && !simulation.setTime(startTime))
+        std::cout << "--time is not available with debris, starting at t = 0" << std::endl;
+    bool restored = false;
+    if (!restorePath.empty()) {
+        if (!loadCheckpoint(simulation, restorePath.c_str()))
+            return 1;
+        restored = true;
+    }
+    if (gravity && !restored)
+        simulation.enableGravity(integrator);
+    if (contactFactor > 0.0f && !simulation.contactsEnabled()) {
+        ContactSettings contactSettings;
+        contactSettings.approachFactor = contactFactor;
+        simulation.enableContacts(contactSettings);
+    }
+    if (deterministic)
+        simulation.setDeterministic(true);
+
+    // Zjawiska są funkcją czasu sceny, więc szukanie zastępuje kroki
+    if (!eventsPath.empty())
+        return findEvents(simulation, scene, span, stepSize, eventsPath) ? 0 : 1;
+
+    // Skróty w formacie dziennika okna (SimulationThread::setHashLog): numer kroku, czas i skrót, wiersz 0 to stan początkowy
+    std::ofstream hashLog;
+    if (!hashLogPath.empty()) {
+        hashLog.open(hashLogPath);
+        if (!hashLog.is_open()) {
+            std::cout << "Failed to create hash log: " << hashLogPath << std::endl;
+            return 1;
+        }
+    }
+    auto logHash = [&](long long step) {
+        if (!hashLog.is_open())
+            return;
+        hashLog << step << ' ' << std::setprecision(17) << simulation.time() << ' ' << std::hex << std::setw(16)
+            << std::setfill('0') << simulation.stateHash() << std::dec << std::setfill(' ') << '\n';
+    };
+
+    long long steps = std::llround(span / stepSize);
+    size_t objects = simulation.bodyCount() + simulation.particleCount();
+    std::cout << "Scene: " << simulation.bodyCount() << " bodies, " << simulation.particleCount() << " particles, "
+        << simulation.massiveBodies().size() << " integrated, t = " << simulation.time() << " s" << std::endl;
+    std::cout << "Run: " << steps << " steps of " << stepSize << " s, " << workerCount() << " threads, "
+        << orbitKernelName(orbitKernel()) << " kernel" << (deterministic ? ", deterministic" : "") << std::endl;
+
+    // Postęp co sekundę czasu rzeczywistego, przepustowość w krokach ciał (ciała i cząstki razy kroki) na sekundę
+    logHash(0);
+    size_t contactEvents = 0;
+    auto start = std::chrono::steady_clock::now();
+    auto lastReport = start;
+    for (long long step = 1; step <= steps; ++step) {
+        simulation.step(stepSize);
+        contactEvents += simulation.contacts().size();
+        logHash(step);
+
+        auto now = std::chrono::steady_clock::now();
+        if (now - lastReport >= std::chrono::seconds(1)) {
+            double elapsed = std::chrono::duration<double>(now - start).count();
+            std::cout << "  step " << step << "/" << steps << ", t = " << simulation.time() << " s, "
+                << (double)objects * step / elapsed << " body-steps/s" << std::endl;
+            lastReport = now;
+        }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << "Done: t = " << std::setprecision(17) << simulation.time() << std::setprecision(6) << " s in "
+        << seconds << " s wall, " << (steps > 0 ? seconds * 1000.0 / steps : 0.0) << " ms/step, "
+        << (seconds > 0.0 ? (double)objects * steps / seconds : 0.0) << " body-steps/s" << std::endl;
+    std::cout << "State hash: " << std::hex << std::setw(16) << std::setfill('0') << simulation.stateHash()
+        << std::dec << std::setfill(' ') << std::endl;
+    if (simulation.contactsEnabled())
+        std::cout << "Contacts: " << contactEvents << " events" << std::endl;
+    if (simulation.gravityEnabled()) {
+        const NBodyDrift& drift = simulation.massiveBodies().drift();
+        std::cout << "Drift: energy " << drift.energy << ", angular momentum " << drift.angularMomentum << std::endl;
+    }
+
+    bool success = true;
+    if (!checkpointPath.empty() && !saveCheckpoint(simulation, checkpointPath.c_str()))
+        success = false;
+    if (!positionsPath.empty() && !writePositions(simulation, positionsPath)) {
+        std::cout << "Failed to write positions: " << positionsPath << std::endl;
+        success = false;
+    }
+    return success ? 0 : 1;
+}
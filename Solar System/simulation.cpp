@@ -0,0 +1,332 @@
+﻿#include "simulation.h"
+#include <algorithm>
+#include <cmath>
+#include <mutex>
+#include "orbit_kernel.h"
+#include "parallel.h"
+
+Simulation::Simulation(const BodyStore& bodies, const ParticleSystem& particles) : store(bodies), debris(particles) {
+    step(0.0); // Pozycje startowe z elementów orbit i przyspieszenia startowe cząstek
+}
+
+// Funkcja wykonująca jeden krok, przyjmuje parametr: długość kroku w sekundach
+void Simulation::step(double dt) {
+    // Cząstki: pół kopnięcia i przesunięcie, zanim ciała przejdą na koniec kroku. Poza widokiem cząstki robią
+    // jeden dłuższy krok co kilka kroków symulacji, a czas do niego zbiera się w particleLag
+    double particleDt = particleLag + dt;
+    bool moveParticles = !debris.empty();
+    if (moveParticles && levelOfDetail() && !particlesRelevant) {
+        double stride = std::min(lod.particleStride, lodSettings.maxParticleSteps * std::fabs(dt));
+        moveParticles = std::fabs(particleDt) >= stride;
+    }
+    if (moveParticles)
+        debris.kickDrift(particleDt);
+    particleLag = moveParticles || debris.empty() ? 0.0 : particleDt;
+
+    currentTime += dt;
+    if (gravityEnabled())
+        planets.step(dt);
+    placeBodies();
+
+    // Druga połowa kroku cząstek z przyspieszeniami od ciał już na nowych pozycjach
+    if (moveParticles) {
+        debris.kick(particleDt, store);
+        if (levelOfDetail())
+            updateParticleBounds(dt);
+    }
+    lod.particleLag = particleLag;
+    findContacts();
+}
+
+// Funkcja przestawiająca symulację na chwilę t, przyjmuje parametr: czas symulacji w sekundach
+bool Simulation::setTime(double t) {
+    if (!seekable())
+        return false;
+    currentTime = t;
+    placeBodies();
+    findContacts();
+    return true;
+}
+
+// Funkcja włączająca wykrywanie zbliżeń, przyjmuje parametr: ustawienia detektora
+void Simulation::enableContacts(const ContactSettings& settings) {
+    synchronize();
+    detectContacts = true;
+    contactDetector.settings = settings;
+    contactDetector.reset();
+    findContacts();
+}
+
+// Dopisuje bajty tablicy do skrótu FNV-1a, przyjmuje parametry: skrót, dane i liczba bajtów
+static void hashBytes(uint64_t& hash, const void* data, size_t size) {
+    const unsigned char* bytes = (const unsigned char*)data;
+    for (size_t i = 0; i < size; ++i) {
+        hash = (hash ^ bytes[i]) * 1099511628211ull;
+    }
+}
+
+template <typename T>
+static void hashArray(uint64_t& hash, const std::vector<T>& values) {
+    hashBytes(hash, values.data(), values.size() * sizeof(T));
+}
+
+uint64_t Simulation::stateHash() const {
+    uint64_t hash = 14695981039346656037ull;
+    hashBytes(hash, &currentTime, sizeof(currentTime));
+    hashArray(hash, store.positionX);
+    hashArray(hash, store.positionY);
+    hashArray(hash, store.positionZ);
+    const ParticleStore& p = debris.particles;
+    hashArray(hash, p.positionX);
+    hashArray(hash, p.positionY);
+    hashArray(hash, p.positionZ);
+    hashArray(hash, p.velocityX);
+    hashArray(hash, p.velocityY);
+    hashArray(hash, p.velocityZ);
+    hashArray(hash, planets.positionX);
+    hashArray(hash, planets.positionY);
+    hashArray(hash, planets.positionZ);
+    hashArray(hash, planets.velocityX);
+    hashArray(hash, planets.velocityY);
+    hashArray(hash, planets.velocityZ);
+    return hash;
+}
+
+void Simulation::findContacts() {
+    contactEvents.clear();
+    if (detectContacts)
+        contactDetector.update(store, debris.particles, currentTime, contactEvents);
+}
+
+// Funkcja ustawiająca pozycje ciał, przyjmuje parametr: true liczy także ciała pominięte przez poziom szczegółów
+void Simulation::placeBodies(bool all) {
+    size_t count = store.size();
+    bool skipping = !all && levelOfDetail();
+
+    // Ruch po elipsie względem rodzica, każde ciało niezależnie, kilka ciał naraz w rejestrach SIMD
+    // i kawałki po kilka tysięcy ciał na wątkach puli; tylko gdy czas się zmienił, bo pozycje lokalne są funkcją czasu.
+    // Z poziomem szczegółów liczone są tylko ciągłe odcinki ciał z istotnych układów
+    if (currentTime != evaluatedTime) {
+        auto evaluate = [&](size_t first, size_t last) {
+            parallelFor(last - first, 4096, [&](size_t begin, size_t end) {
+                begin += first;
+                end += first;
+                OrbitArrays orbits = { store.epochAnomaly.data() + begin, store.meanMotion.data() + begin,
+                    store.eccentricity.data() + begin, store.periapsisX.data() + begin, store.periapsisY.data() + begin,
+                    store.periapsisZ.data() + begin, store.minorAxisX.data() + begin, store.minorAxisY.data() + begin,
+                    store.minorAxisZ.data() + begin, store.meanAnomaly.data() + begin, store.localX.data() + begin,
+                    store.localY.data() + begin, store.localZ.data() + begin, end - begin };
+                evaluateOrbits(orbits, currentTime);
+            });
+        };
+        size_t evaluated = 0;
+        if (!skipping) {
+            evaluate(0, count);
+            evaluated = count;
+        }
+        else {
+            for (size_t first = 0; first < count;) {
+                if (!bodyEvaluated(first)) {
+                    ++first;
+                    continue;
+                }
+                size_t last = first + 1;
+                while (last < count && bodyEvaluated(last)) {
+                    ++last;
+                }
+                evaluate(first, last);
+                evaluated += last - first;
+                first = last;
+            }
+        }
+        lod.evaluatedBodies = evaluated;
+        bool fromEphemeris = ephemeris && ephemeris->evaluate(currentTime, ephemerisCache,
+            store.localX.data(), store.localY.data(), store.localZ.data());
+
+        // Ciała bez ruchu własnego (np. Słońce) zostają czyste, przesuną się tylko z przodkiem
+        for (size_t i = 0; i < count; ++i) {
+            if ((store.meanMotion[i] != 0.0 || (fromEphemeris && store.parent[i] >= 0)) && (!skipping || bodyEvaluated(i)))
+                store.localDirty[i] = 1;
+        }
+        evaluatedTime = currentTime;
+    }
+
+    // Ciała z masą w trybie grawitacyjnym: pozycje z całkowania zastępują elipsy, już w układzie świata
+    if (gravityEnabled()) {
+        for (size_t i = 0; i < count; ++i) {
+            int body = integratedBody[i];
+            if (body >= 0) {
+                store.localX[i] = (float)planets.positionX[body];
+                store.localY[i] = (float)planets.positionY[body];
+                store.localZ[i] = (float)planets.positionZ[body];
+                store.localDirty[i] = 1;
+            }
+        }
+    }
+
+    store.updateHierarchy();
+}
+
+// Funkcja ustawiająca efemerydy, przyjmuje parametr: efemerydy albo nullptr
+void Simulation::setEphemeris(std::shared_ptr<const Ephemeris> source) {
+    ephemeris = std::move(source);
+    ephemerisCache = EphemerisCache();
+    evaluatedTime = std::nan("");
+    placeBodies();
+}
+
+// Funkcja włączająca tryb grawitacyjny, przyjmuje parametr: metoda całkowania
+void Simulation::enableGravity(Integrator integrator) {
+    size_t count = store.size();
+    planets = NBodySystem();
+    planets.integrator = integrator;
+    planets.gravity.softening = 1e-3f;
+    integratedBody.assign(count, -1);
+
+    // Słońce i planety z masą; ciała są posortowane po rodzicu, więc Słońce jest dodawane pierwsze
+    for (size_t i = 0; i < count; ++i) {
+        int p = store.parent[i];
+        if (store.mass[i] <= 0.0f || (p >= 0 && store.parent[p] >= 0))
+            continue;
+        double vx = 0.0, vy = 0.0, vz = 0.0;
+        if (p >= 0) {
+            // Prędkość na elipsie: pochodna (cos E - e) aP + sin E bQ, gdzie dE/dt = n / (1 - e cos E),
+            // z ruchem średnim wynikającym z mas, a nie z prędkości kinematycznej
+            double e = store.eccentricity[i];
+            double M = store.meanAnomaly[i];
+            double E = M + e * sin(M);
+            for (int k = 0; k < 8; ++k) {
+                E -= (E - e * sin(E) - M) / (1.0 - e * cos(E));
+            }
+            double a = store.semiMajorAxis[i];
+            double n = sqrt(((double)store.mass[p] + store.mass[i]) / (a * a * a));
+            double rate = n / (1.0 - e * cos(E));
+            vx = (-sin(E) * store.periapsisX[i] + cos(E) * store.minorAxisX[i]) * rate;
+            vy = (-sin(E) * store.periapsisY[i] + cos(E) * store.minorAxisY[i]) * rate;
+            vz = (-sin(E) * store.periapsisZ[i] + cos(E) * store.minorAxisZ[i]) * rate;
+        }
+        int primary = p >= 0 ? integratedBody[p] : -1;
+        integratedBody[i] = planets.add(store.positionX[i], store.positionY[i], store.positionZ[i], vx, vy, vz, store.mass[i], primary);
+        store.worldSpace[i] = 1;
+    }
+    planets.removeMomentum();
+}
+
+// Funkcja włączająca poziom szczegółów, przyjmuje parametr: ustawienia
+void Simulation::enableLevelOfDetail(const LevelOfDetailSettings& settings) {
+    lodEnabled = true;
+    lodSettings = settings;
+
+    // Układ każdego ciała: przodek krążący wokół Słońca; rodzic ma mniejszy indeks, więc jest już przypisany
+    size_t count = store.size();
+    systemRoot.assign(count, -1);
+    systemRelevant.assign(count, 1);
+    for (size_t i = 0; i < count; ++i) {
+        int p = store.parent[i];
+        if (p >= 0 && store.parent[p] >= 0)
+            systemRoot[i] = systemRoot[p] >= 0 ? systemRoot[p] : p;
+    }
+    particlesRelevant = true;
+    lod.particleStride = 0.0;
+    if (!debris.empty())
+        updateParticleBounds(0.0);
+}
+
+void Simulation::disableLevelOfDetail() {
+    synchronize();
+    lodEnabled = false;
+}
+
+// Funkcja przełączająca układ, przyjmuje parametry: ciało krążące wokół Słońca i czy jego układ jest istotny
+void Simulation::setSystemRelevant(int body, bool relevant) {
+    if (!lodEnabled || body < 0 || (size_t)body >= systemRelevant.size() || systemRelevant[body] == (unsigned char)relevant)
+        return;
+    systemRelevant[body] = relevant;
+
+    // Pozycje na elipsach są funkcją czasu, więc przywrócone księżyce są od razu dokładne
+    if (relevant) {
+        evaluatedTime = std::nan("");
+        placeBodies();
+    }
+}
+
+// Funkcja przełączająca cząstki, przyjmuje parametr: czy są w widoku
+void Simulation::setParticlesRelevant(bool relevant) {
+    if (relevant && !particlesRelevant)
+        advanceParticles(particleLag);
+    particlesRelevant = relevant;
+}
+
+void Simulation::synchronize() {
+    if (!lodEnabled)
+        return;
+    evaluatedTime = std::nan("");
+    placeBodies(true);
+    advanceParticles(particleLag);
+}
+
+// Jeden krok żabki cząstek do chwili currentTime, ciała są już na miejscu, przyjmuje parametr: długość kroku
+void Simulation::advanceParticles(double dt) {
+    if (debris.empty() || dt == 0.0)
+        return;
+    debris.kickDrift(dt);
+    debris.kick(dt, store);
+    particleLag = 0.0;
+    lod.particleLag = 0.0;
+}
+
+// Sfera wokół cząstek i krok poza widokiem z czasu dynamicznego cząstki najbliższej Słońcu (ciało 0),
+// przyjmuje parametr: bieżący krok symulacji, który razy maxParticleSteps ogranicza krok cząstek
+void Simulation::updateParticleBounds(double dt) {
+    const ParticleStore& p = debris.particles;
+    float sunX = store.positionX[0], sunY = store.positionY[0], sunZ = store.positionZ[0];
+    float low[3] = { INFINITY, INFINITY, INFINITY }, high[3] = { -INFINITY, -INFINITY, -INFINITY };
+    float maxSpeedSquared = 0.0f, minDistanceSquared = INFINITY;
+    std::mutex mutex;
+    parallelFor(p.size(), 16384, [&](size_t begin, size_t end) {
+        float chunkLow[3] = { INFINITY, INFINITY, INFINITY }, chunkHigh[3] = { -INFINITY, -INFINITY, -INFINITY };
+        float chunkSpeed = 0.0f, chunkDistance = INFINITY;
+        for (size_t i = begin; i < end; ++i) {
+            float position[3] = { p.positionX[i], p.positionY[i], p.positionZ[i] };
+            for (int k = 0; k < 3; ++k) {
+                chunkLow[k] = std::min(chunkLow[k], position[k]);
+                chunkHigh[k] = std::max(chunkHigh[k], position[k]);
+            }
+            chunkSpeed = std::max(chunkSpeed, p.velocityX[i] * p.velocityX[i] + p.velocityY[i] * p.velocityY[i] + p.velocityZ[i] * p.velocityZ[i]);
+            float dx = position[0] - sunX, dy = position[1] - sunY, dz = position[2] - sunZ;
+            chunkDistance = std::min(chunkDistance, dx * dx + dy * dy + dz * dz);
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        for (int k = 0; k < 3; ++k) {
+            low[k] = std::min(low[k], chunkLow[k]);
+            high[k] = std::max(high[k], chunkHigh[k]);
+        }
+        maxSpeedSquared = std::max(maxSpeedSquared, chunkSpeed);
+        minDistanceSquared = std::min(minDistanceSquared, chunkDistance);
+    });
+
+    double stride = lodSettings.maxParticleSteps * std::fabs(dt);
+    if (store.mass[0] > 0.0f) {
+        double r = std::sqrt((double)minDistanceSquared);
+        double tau = std::sqrt(r * r * r / store.mass[0]);
+        stride = std::min(stride, 2.0 * tau * std::sqrt((double)lodSettings.particleTolerance));
+    }
+    lod.particleStride = stride;
+
+    BoundingSphere& bounds = lod.particleBounds;
+    bounds.x = 0.5f * (low[0] + high[0]);
+    bounds.y = 0.5f * (low[1] + high[1]);
+    bounds.z = 0.5f * (low[2] + high[2]);
+    float ex = high[0] - low[0], ey = high[1] - low[1], ez = high[2] - low[2];
+    bounds.radius = 0.5f * std::sqrt(ex * ex + ey * ey + ez * ez) + std::sqrt(maxSpeedSquared) * (float)stride;
+}
+
+void Simulation::copyPositions(std::vector<float>& out) const {
+    size_t count = store.size();
+    out.resize(count * 3);
+    for (size_t i = 0; i < count; ++i) {
+        out[i * 3 + 0] = store.positionX[i];
+        out[i * 3 + 1] = store.positionY[i];
+        out[i * 3 + 2] = store.positionZ[i];
+    }
+}
@@ -0,0 +1,145 @@
+﻿#pragma once
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "body_store.h"
+#include "contact_detector.h"
+#include "ephemeris.h"
+#include "nbody_system.h"
+#include "particle_system.h"
+
+// Poziom szczegółów symulacji
+struct LevelOfDetailSettings {
+    // Względny błąd energii cząstek przy dłuższym kroku poza widokiem. Dla żabki na orbicie o czasie dynamicznym
+    // tau = sqrt(r^3 / GM) błąd wynosi około (krok / tau)^2 / 4, więc krok to 2 tau sqrt(tolerancja)
+    // dla cząstki najbliższej Słońcu
+    float particleTolerance = 1.0e-4f;
+    int maxParticleSteps = 16; // Najwięcej kroków symulacji na jeden krok cząstek poza widokiem
+};
+
+// Sfera obejmująca zbiór punktów
+struct BoundingSphere {
+    float x = 0.0f, y = 0.0f, z = 0.0f;
+    float radius = 0.0f;
+};
+
+struct LevelOfDetailStats {
+    size_t evaluatedBodies = 0;    // Ciała, których orbity policzono przy ostatnim ustawianiu pozycji
+    double particleStride = 0.0;   // Krok cząstek poza widokiem w sekundach symulacji
+    double particleLag = 0.0;      // O ile cząstki są za czasem symulacji
+    BoundingSphere particleBounds; // Z zapasem na ruch cząstek przez particleStride
+};
+
+// Symulacja ruchu ciał, niezależna od okna i OpenGL. Ciała w magazynie są posortowane po rodzicu,
+// więc pozycje liczone są liniowymi przejściami po tablicach. Opcjonalne cząstki poruszają się
+// pod wpływem grawitacji ciał z masą i własnej (Barnes–Hut)
+class Simulation {
+public:
+    Simulation() = default;
+    explicit Simulation(const BodyStore& bodies, const ParticleSystem& particles = ParticleSystem());
+
+    // Wykonuje jeden krok symulacji, przyjmuje parametr: długość kroku w sekundach, ujemna cofa czas
+    void step(double dt);
+
+    // Przestawia symulację na chwilę t bez kroków pośrednich: pozycje na elipsach są funkcją czasu,
+    // więc koszt nie zależy od odległości skoku. Zwraca false, gdy stan zależy od historii
+    // (tryb grawitacyjny albo cząstki), przyjmuje parametr: czas symulacji w sekundach
+    bool setTime(double t);
+    bool seekable() const { return !deterministicMode && !gravityEnabled() && debris.empty(); }
+    double time() const { return currentTime; }
+
+    // Efemerydy zastępują elipsy ciał, które zawierają, w zakresie czasu pliku; poza nim ciała wracają na elipsy.
+    // Plik jest współdzielony przez kopie symulacji, każda ma własny bufor segmentów, przyjmuje parametr: efemerydy
+    void setEphemeris(std::shared_ptr<const Ephemeris> source);
+    std::shared_ptr<const Ephemeris> ephemerisSource() const { return ephemeris; }
+    const EphemerisCache& ephemerisStats() const { return ephemerisCache; }
+
+    // Tryb grawitacyjny: Słońce i planety z masą przestają krążyć po stałych elipsach i przyciągają się nawzajem.
+    // Prędkości startowe wynikają z bieżących elementów orbit i mas, księżyce dalej krążą kinematycznie wokół planet.
+    // Przyjmuje parametr: metoda całkowania
+    void enableGravity(Integrator integrator);
+    bool gravityEnabled() const { return planets.size() > 0; }
+    const NBodySystem& massiveBodies() const { return planets; }
+
+    size_t bodyCount() const { return store.size(); }
+    const BodyStore& bodies() const { return store; }
+    size_t particleCount() const { return debris.particles.size(); }
+    const ParticleSystem& particles() const { return debris; }
+
+    // Tryb deterministyczny: czas płynie tylko krokami, bez skoków setTime, więc stan zależy wyłącznie od stanu
+    // początkowego i ciągu kroków. Wszystkie sumy równoległe mają kolejność niezależną od liczby wątków;
+    // jądro SIMD trzeba ustawić osobno (setOrbitKernel), bo warianty różnią się zaokrągleniami.
+    // Przyjmuje parametr: true włącza tryb
+    void setDeterministic(bool enabled) {
+        if (enabled)
+            synchronize();
+        deterministicMode = enabled;
+    }
+    bool deterministic() const { return deterministicMode; }
+
+    // Skrót stanu: FNV-1a po bitach czasu, pozycji ciał i cząstek oraz pozycji i prędkości ciał całkowanych;
+    // dwa przebiegi o tym samym skrócie po każdym kroku mają identyczny stan
+    uint64_t stateHash() const;
+
+    // Kopiuje pozycje wszystkich ciał jako kolejne trójki xyz
+    void copyPositions(std::vector<float>& out) const;
+    void copyParticlePositions(std::vector<float>& out) const { debris.copyPositions(out); }
+
+    // Wykrywanie zbliżeń i zderzeń ciał i cząstek po każdym kroku, przyjmuje parametr: ustawienia detektora
+    void enableContacts(const ContactSettings& settings);
+    bool contactsEnabled() const { return detectContacts; }
+    // Zdarzenia z ostatniego kroku albo ustawienia czasu
+    const std::vector<ContactEvent>& contacts() const { return contactEvents; }
+    const ContactStats& contactStats() const { return contactDetector.stats(); }
+
+    // Poziom szczegółów: księżyce układów nieistotnych dla widoku nie są liczone (przesuwają się tylko z planetą),
+    // a cząstki poza widokiem robią rzadsze, dłuższe kroki. Wyłączony w trybie deterministycznym i przy wykrywaniu
+    // zbliżeń, które potrzebują wszystkich pozycji po każdym kroku. Przyjmuje parametr: ustawienia
+    void enableLevelOfDetail(const LevelOfDetailSettings& settings);
+    void disableLevelOfDetail();
+    bool levelOfDetail() const { return lodEnabled && !deterministicMode && !detectContacts; }
+    const LevelOfDetailStats& lodStats() const { return lod; }
+
+    // Czy liczone są księżyce układu ciała krążącego wokół Słońca; przywrócony układ od razu dostaje dokładne
+    // pozycje w chwili time(), przyjmuje parametry: indeks ciała i czy układ jest istotny
+    void setSystemRelevant(int body, bool relevant);
+
+    // Czy cząstki są w widoku; przywrócone są od razu doprowadzane do chwili time(), przyjmuje parametr: czy są istotne
+    void setParticlesRelevant(bool relevant);
+
+    // Doprowadza pominięte ciała i cząstki do chwili time(), np. przed zapytaniem o ciało poza widokiem albo zapisem stanu
+    void synchronize();
+
+private:
+    // Zapis i odtworzenie stanu (checkpoint.cpp) kopiują tablice magazynów wprost
+    friend struct CheckpointAccess;
+
+    // Pozycje ciał w chwili currentTime: elipsy, ciała całkowane i złożenie hierarchii
+    void placeBodies(bool all = false);
+    void findContacts();
+    bool bodyEvaluated(size_t body) const { return systemRoot[body] < 0 || systemRelevant[systemRoot[body]]; }
+    void advanceParticles(double dt);
+    void updateParticleBounds(double dt);
+
+    double currentTime = 0.0;
+    double evaluatedTime = std::nan(""); // Chwila, dla której policzono pozycje lokalne
+    std::shared_ptr<const Ephemeris> ephemeris;
+    EphemerisCache ephemerisCache;
+    BodyStore store;
+    ParticleSystem debris;
+    NBodySystem planets;
+    std::vector<int> integratedBody; // Indeks w planets dla każdego ciała albo -1 dla ciał kinematycznych
+    bool deterministicMode = false;
+    bool detectContacts = false;
+    ContactDetector contactDetector;
+    std::vector<ContactEvent> contactEvents;
+    bool lodEnabled = false;
+    LevelOfDetailSettings lodSettings;
+    LevelOfDetailStats lod;
+    std::vector<int> systemRoot;               // Ciało krążące wokół Słońca, do którego układu należy ciało, -1 dla niego samego
+    std::vector<unsigned char> systemRelevant; // Dla ciał krążących wokół Słońca: czy ich układ jest liczony
+    bool particlesRelevant = true;
+    double particleLag = 0.0;                  // Czas, o który cząstki są za currentTime
+};
@@ -0,0 +1,24 @@
+﻿#include "simulation_clock.h"
+
+// Konstruktor zegara, przyjmuje parametry: długość kroku i limit kroków na klatkę
+SimulationClock::SimulationClock(double fixedStep, int maxStepsPerFrame)
+    : step(fixedStep), maxSteps(maxStepsPerFrame) {
+}
+
+// Funkcja dodająca czas rzeczywisty, przyjmuje parametr: czas w sekundach od poprzedniej klatki
+int SimulationClock::advance(double realSeconds) {
+    if (realSeconds > 0.0)
+        accumulator += realSeconds;
+
+    int count = (int)(accumulator / step);
+    if (count > maxSteps) {
+        // Po długiej przerwie (np. przeciąganie okna) nie nadrabiamy wszystkiego, żeby nie wpaść w spiralę
+        dropped += count - maxSteps;
+        count = maxSteps;
+        accumulator = step * maxSteps;
+    }
+
+    accumulator -= count * step;
+    stepCount += count;
+    return count;
+}
@@ -0,0 +1,27 @@
+﻿#pragma once
+
+// Zegar symulacji ze stałym krokiem: czas rzeczywisty trafia do akumulatora, z którego
+// wykonywane są całe kroki, a reszta służy do interpolacji między dwoma ostatnimi stanami
+class SimulationClock {
+public:
+    // Przyjmuje parametry: długość kroku w sekundach i limit kroków nadrabianych w jednej klatce
+    explicit SimulationClock(double fixedStep = 1.0 / 60.0, int maxStepsPerFrame = 10);
+
+    // Dodaje czas rzeczywisty, który upłynął, zwraca liczbę kroków do wykonania
+    int advance(double realSeconds);
+
+    // Część kroku, która upłynęła od ostatniego stanu, 0..1
+    double alpha() const { return accumulator / step; }
+
+    // Czas symulacji podaje Simulation::time(), bo skala czasu, cofanie i skoki nie przechodzą przez zegar
+    double fixedStep() const { return step; }
+    long long steps() const { return stepCount; }
+    long long droppedSteps() const { return dropped; } // Kroki pominięte przez limit nadrabiania
+
+private:
+    double step;
+    int maxSteps;
+    double accumulator = 0.0;
+    long long stepCount = 0;
+    long long dropped = 0;
+};
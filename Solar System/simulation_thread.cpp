@@ -0,0 +1,196 @@
+﻿#include "simulation_thread.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include "checkpoint.h"
+
+SimulationThread::~SimulationThread() {
+    stop();
+}
+
+// Funkcja uruchamiająca wątek, przyjmuje parametry: symulacja i zegar ze stałym krokiem
+void SimulationThread::start(const Simulation& initial, const SimulationClock& initialClock) {
+    stop();
+    simulation = initial;
+    clock = initialClock;
+
+    // Stan początkowy widoczny od razu, zanim wątek wykona pierwszy krok
+    SimulationSnapshot& snapshot = snapshots.writeBuffer();
+    simulation.copyPositions(snapshot.positions);
+    snapshot.previousPositions = snapshot.positions;
+    snapshot.previousTime = simulation.time();
+    simulation.copyParticlePositions(snapshot.particles);
+    snapshot.previousParticles = snapshot.particles;
+    stepIndex = -1; // Stan początkowy jako wiersz 0 dziennika skrótów
+    recordStep();
+    publish();
+
+    running = true;
+    thread = std::thread(&SimulationThread::run, this);
+}
+
+void SimulationThread::stop() {
+    running = false;
+    if (thread.joinable())
+        thread.join();
+}
+
+bool SimulationThread::setHashLog(const std::string& path) {
+    hashLog.open(path);
+    return hashLog.is_open();
+}
+
+bool SimulationThread::send(const SimulationCommand& command) {
+    return commands.push(command);
+}
+
+bool SimulationThread::receiveContact(ContactEvent& event) {
+    return contactEvents.pop(event);
+}
+
+const SimulationSnapshot& SimulationThread::latest() {
+    return snapshots.read();
+}
+
+float SimulationThread::interpolationAlpha(const SimulationSnapshot& snapshot) {
+    if (snapshot.paused)
+        return 1.0f;
+    double alpha = (now() - snapshot.publishedAt) / snapshot.stepInterval;
+    return (float)std::clamp(alpha, 0.0, 1.0);
+}
+
+double SimulationThread::now() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Uzupełnia bufor zapisu o dane zegara i publikuje go
+void SimulationThread::publish() {
+    SimulationSnapshot& snapshot = snapshots.writeBuffer();
+    snapshot.time = simulation.time();
+    snapshot.seekable = simulation.seekable();
+    snapshot.publishedAt = now();
+    snapshot.stepInterval = stepInterval();
+    snapshot.steps = clock.steps();
+    snapshot.droppedSteps = clock.droppedSteps();
+    snapshot.timeScale = timeScale;
+    snapshot.paused = paused;
+    snapshot.contacts = simulation.contactsEnabled();
+    snapshot.contactStats = simulation.contactStats();
+    snapshot.droppedContacts = droppedContacts;
+    snapshot.deterministic = simulation.deterministic();
+    snapshot.stateHash = snapshot.deterministic ? simulation.stateHash() : 0;
+    snapshot.levelOfDetail = simulation.levelOfDetail();
+    snapshot.lod = simulation.lodStats();
+    snapshots.publish();
+}
+
+// Przekazuje zdarzenia z ostatniego kroku do wątku renderującego; gdy ten nie nadąża, nadmiar jest liczony i pomijany
+void SimulationThread::forwardContacts() {
+    for (const ContactEvent& event : simulation.contacts()) {
+        if (!contactEvents.push(event))
+            ++droppedContacts;
+    }
+}
+
+// Po każdym kroku: zdarzenia zbliżeń dla wątku renderującego i w trybie deterministycznym wiersz dziennika skrótów
+void SimulationThread::recordStep() {
+    ++stepIndex;
+    forwardContacts();
+    if (hashLog.is_open() && simulation.deterministic()) {
+        hashLog << stepIndex << ' ' << std::setprecision(17) << simulation.time() << ' ' << std::hex << std::setw(16)
+            << std::setfill('0') << simulation.stateHash() << std::dec << std::setfill(' ') << '\n';
+    }
+}
+
+// Czas rzeczywisty między publikowanymi stanami: takt zegara przy skokach w czasie, a przy krokach
+// całkowania krok podzielony przez skalę czasu
+double SimulationThread::stepInterval() const {
+    return simulation.seekable() ? clock.fixedStep() : clock.fixedStep() / std::fabs(timeScale);
+}
+
+// Pętla wątku symulacji
+void SimulationThread::run() {
+    double last = now();
+    while (running) {
+        bool changed = false;
+        bool jumped = false;
+        SimulationCommand command;
+        while (commands.pop(command)) {
+            if (command.type == SimulationCommandType::TogglePause)
+                paused = !paused;
+            else if (command.type == SimulationCommandType::SetTimeScale && command.value != 0.0) {
+                double limit = simulation.seekable() ? maxSeekableTimeScale : maxSteppedTimeScale;
+                timeScale = std::clamp(command.value, -limit, limit);
+            }
+            else if (command.type == SimulationCommandType::Seek) {
+                jumped = simulation.setTime(command.value);
+                forwardContacts();
+            }
+            else if (command.type == SimulationCommandType::SaveCheckpoint) {
+                // Plik dostaje pełny stan, także układów i cząstek wstrzymanych przez poziom szczegółów
+                simulation.synchronize();
+                saveCheckpoint(simulation, checkpointPath.c_str());
+            }
+            else if (command.type == SimulationCommandType::RestoreCheckpoint && loadCheckpoint(simulation, checkpointPath.c_str())) {
+                jumped = true;
+                forwardContacts();
+            }
+            else if (command.type == SimulationCommandType::SetRelevance) {
+                if (command.index < 0)
+                    simulation.setParticlesRelevant(command.value != 0.0);
+                else
+                    simulation.setSystemRelevant(command.index, command.value != 0.0);
+            }
+            changed = true;
+        }
+
+        double current = now();
+        double elapsed = current - last;
+        last = current;
+        bool seekable = simulation.seekable();
+        int steps = clock.advance(paused ? 0.0 : seekable ? elapsed : elapsed * std::fabs(timeScale));
+
+        // Po pierwszych publikacjach wektory wszystkich buforów mają już właściwy rozmiar, kopiowanie nie alokuje
+        SimulationSnapshot& snapshot = snapshots.writeBuffer();
+        if (seekable && steps > 0) {
+            // Jedno wyliczenie w nowej chwili niezależnie od liczby taktów i skali czasu
+            simulation.copyPositions(snapshot.previousPositions);
+            snapshot.previousTime = simulation.time();
+            simulation.setTime(simulation.time() + steps * clock.fixedStep() * timeScale);
+            forwardContacts();
+        }
+        else {
+            double dt = timeScale < 0.0 ? -clock.fixedStep() : clock.fixedStep();
+            for (int s = 0; s < steps; ++s) {
+                if (s == steps - 1) {
+                    simulation.copyPositions(snapshot.previousPositions);
+                    simulation.copyParticlePositions(snapshot.previousParticles);
+                    snapshot.previousTime = simulation.time();
+                }
+                simulation.step(dt);
+                recordStep();
+            }
+        }
+        if (steps > 0 || changed) {
+            simulation.copyPositions(snapshot.positions);
+            simulation.copyParticlePositions(snapshot.particles);
+            // Bez interpolacji po samej zmianie ustawień, po skoku i przy dużym przyspieszeniu,
+            // gdy między taktami księżyce obiegają planety i odcinek między pozycjami nie leży na orbicie
+            if (steps == 0 || jumped || std::fabs(timeScale) > maxSteppedTimeScale) {
+                snapshot.previousPositions = snapshot.positions;
+                snapshot.previousParticles = snapshot.particles;
+                snapshot.previousTime = simulation.time();
+            }
+            const BarnesHutStats& tree = simulation.particles().treeStats();
+            snapshot.treeMilliseconds = tree.buildMilliseconds + tree.forceMilliseconds;
+            snapshot.gravity = simulation.gravityEnabled();
+            snapshot.drift = simulation.massiveBodies().drift();
+            publish();
+        }
+
+        // Czekanie do następnego kroku, ale krótko, żeby szybko reagować na polecenia
+        double untilNextStep = paused ? 0.005 : (1.0 - clock.alpha()) * stepInterval();
+        std::this_thread::sleep_for(std::chrono::duration<double>(std::min(untilNextStep, 0.005)));
+    }
+}
@@ -0,0 +1,116 @@
+﻿#pragma once
+#include <atomic>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "simulation.h"
+#include "simulation_clock.h"
+#include "spsc_queue.h"
+#include "triple_buffer.h"
+
+// Stan symulacji opublikowany dla wątku renderującego
+struct SimulationSnapshot {
+    std::vector<float> previousPositions; // Pozycje przed ostatnim krokiem, trójki xyz
+    std::vector<float> positions;         // Pozycje po ostatnim kroku, trójki xyz
+    std::vector<float> previousParticles; // Pozycje cząstek przed i po ostatnim kroku, trójki xyz
+    std::vector<float> particles;
+    double treeMilliseconds = 0.0;        // Czas budowy drzewa i liczenia sił w ostatnim kroku
+    bool contacts = false;                // Wykrywanie zbliżeń włączone
+    ContactStats contactStats;            // Statystyki detektora zbliżeń z ostatniego kroku
+    long long droppedContacts = 0;        // Zdarzenia, które nie zmieściły się w kolejce
+    bool deterministic = false;           // Tryb deterministyczny, stateHash jest skrótem stanu positions
+    uint64_t stateHash = 0;
+    bool gravity = false;                 // Tryb grawitacyjny ciał z masą
+    NBodyDrift drift;                     // Dryf energii i momentu pędu w trybie grawitacyjnym
+    bool levelOfDetail = false;           // Poziom szczegółów działa, pominięte układy stoją w miejscu
+    LevelOfDetailStats lod;               // Policzone ciała, krok cząstek poza widokiem i sfera wokół cząstek
+    bool seekable = true;                 // Czas można przestawiać skokiem i przyspieszać do maxSeekableTimeScale
+    double time = 0.0;                    // Czas symulacji stanu positions
+    double previousTime = 0.0;            // Czas symulacji stanu previousPositions
+    double publishedAt = 0.0;             // Czas rzeczywisty publikacji, w sekundach zegara monotonicznego
+    double stepInterval = 1.0 / 60.0;     // Czas rzeczywisty między krokami przy bieżącej skali czasu
+    long long steps = 0;
+    long long droppedSteps = 0;
+    double timeScale = 1.0;               // Ujemna - czas płynie wstecz
+    bool paused = false;
+};
+
+// Polecenia sterujące symulacją wysyłane z wątku renderującego
+enum class SimulationCommandType {
+    TogglePause,
+    SetTimeScale, // value: skala czasu, ujemna cofa
+    Seek,         // value: czas symulacji, tylko gdy stan jest funkcją czasu
+    SaveCheckpoint,   // Zapis stanu do pliku ustawionego przez setCheckpointPath, między krokami
+    RestoreCheckpoint, // Odtworzenie stanu z tego pliku
+    SetRelevance       // index: ciało krążące wokół Słońca albo -1 dla cząstek, value: 1 - w widoku, 0 - poza nim
+};
+
+// Największa skala czasu, gdy stan jest funkcją czasu; przy krokach całkowania ogranicza ją limit kroków zegara
+const double maxSeekableTimeScale = 1.0e6;
+const double maxSteppedTimeScale = 64.0;
+
+struct SimulationCommand {
+    SimulationCommandType type;
+    double value = 0.0;
+    int index = -1;
+};
+
+// Symulacja na osobnym wątku: kroki wykonywane są w stałym rytmie niezależnie od renderowania,
+// stan trafia do potrójnego bufora, a polecenia przychodzą kolejką bez blokad. Gdy symulacja
+// pozwala na skoki w czasie, zegar odmierza czas rzeczywisty, a każdy takt liczy stan w nowej chwili
+// bez względu na skalę czasu
+class SimulationThread {
+public:
+    ~SimulationThread();
+
+    // Zapisuje skrót stanu po każdym kroku w trybie deterministycznym, jeden wiersz "krok czas skrót";
+    // wywoływane przed start, zwraca false, gdy pliku nie da się utworzyć, przyjmuje parametr: ścieżka pliku
+    bool setHashLog(const std::string& path);
+
+    // Plik stanu dla poleceń SaveCheckpoint i RestoreCheckpoint, wywoływane przed start, przyjmuje parametr: ścieżka
+    void setCheckpointPath(const std::string& path) { checkpointPath = path; }
+
+    // Uruchamia wątek, przyjmuje parametry: symulacja i zegar ze stałym krokiem
+    void start(const Simulation& simulation, const SimulationClock& clock);
+    void stop();
+
+    // Wysyła polecenie, zwraca false, gdy kolejka jest pełna (wywoływane z wątku renderującego)
+    bool send(const SimulationCommand& command);
+
+    // Odbiera kolejne zdarzenie zbliżenia, zwraca false, gdy kolejka jest pusta (wywoływane z wątku renderującego)
+    bool receiveContact(ContactEvent& event);
+
+    // Najnowszy opublikowany stan, nie blokuje (wywoływane z wątku renderującego). Referencja jest ważna tylko
+    // do następnego wywołania latest(), więc pobieramy stan raz na klatkę i przekazujemy go dalej
+    const SimulationSnapshot& latest();
+
+    // Część kroku do interpolacji między previousPositions i positions, 0..1
+    static float interpolationAlpha(const SimulationSnapshot& snapshot);
+
+    // Czas rzeczywisty w sekundach zegara monotonicznego
+    static double now();
+
+private:
+    void run();
+    void publish();
+    void forwardContacts();
+    void recordStep();
+    double stepInterval() const;
+
+    Simulation simulation;
+    SimulationClock clock;
+    double timeScale = 1.0;
+    bool paused = false;
+
+    std::thread thread;
+    std::atomic<bool> running{ false };
+    SpscQueue<SimulationCommand, 64> commands;
+    SpscQueue<ContactEvent, 1024> contactEvents;
+    long long droppedContacts = 0;
+    std::ofstream hashLog;
+    std::string checkpointPath;
+    long long stepIndex = 0; // Kroki wykonane od startu, numer wiersza w hashLog
+    TripleBuffer<SimulationSnapshot> snapshots;
+};
@@ -0,0 +1,34 @@
+﻿#pragma once
+#include <atomic>
+#include <cstddef>
+
+// Kolejka bez blokad dla jednego producenta i jednego konsumenta, o stałej pojemności
+template <typename T, size_t Capacity>
+class SpscQueue {
+public:
+    // Dodaje element, zwraca false, gdy kolejka jest pełna (tylko producent)
+    bool push(const T& item) {
+        size_t head = headIndex.load(std::memory_order_relaxed);
+        size_t next = (head + 1) % Capacity;
+        if (next == tailIndex.load(std::memory_order_acquire))
+            return false;
+        items[head] = item;
+        headIndex.store(next, std::memory_order_release);
+        return true;
+    }
+
+    // Pobiera element, zwraca false, gdy kolejka jest pusta (tylko konsument)
+    bool pop(T& item) {
+        size_t tail = tailIndex.load(std::memory_order_relaxed);
+        if (tail == headIndex.load(std::memory_order_acquire))
+            return false;
+        item = items[tail];
+        tailIndex.store((tail + 1) % Capacity, std::memory_order_release);
+        return true;
+    }
+
+private:
+    T items[Capacity];
+    alignas(64) std::atomic<size_t> headIndex{ 0 }; // Osobne linie cache, żeby wątki nie walczyły o nie
+    alignas(64) std::atomic<size_t> tailIndex{ 0 };
+};
@@ -0,0 +1,378 @@
+﻿#include "texture_residency.h"
+#include <glad/glad.h>
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include "stb_image.h"
+
+#ifndef M_PI
+#   define M_PI 3.1415926535897932384626433832
+#endif
+
+// Zwraca format OpenGL odpowiadający liczbie składowych obrazu
+static GLenum formatForComponents(int components) {
+    if (components == 1)
+        return GL_RED;
+    if (components == 4)
+        return GL_RGBA;
+    return GL_RGB;
+}
+
+// Zmniejsza obraz dwukrotnie filtrem pudełkowym, przyjmuje parametry: dane, szerokość, wysokość i liczba składowych
+std::vector<unsigned char> downsampleImage(const unsigned char* data, int width, int height, int components) {
+    int newWidth = std::max(1, width / 2);
+    int newHeight = std::max(1, height / 2);
+    std::vector<unsigned char> result((size_t)newWidth * newHeight * components);
+
+    for (int y = 0; y < newHeight; ++y) {
+        int y0 = std::min(y * 2, height - 1);
+        int y1 = std::min(y * 2 + 1, height - 1);
+        for (int x = 0; x < newWidth; ++x) {
+            int x0 = std::min(x * 2, width - 1);
+            int x1 = std::min(x * 2 + 1, width - 1);
+            for (int c = 0; c < components; ++c) {
+                int sum = data[((size_t)y0 * width + x0) * components + c]
+                    + data[((size_t)y0 * width + x1) * components + c]
+                    + data[((size_t)y1 * width + x0) * components + c]
+                    + data[((size_t)y1 * width + x1) * components + c];
+                result[((size_t)y * newWidth + x) * components + c] = (unsigned char)((sum + 2) / 4);
+            }
+        }
+    }
+
+    return result;
+}
+
+// Konstruktor menedżera, przyjmuje parametr: budżet VRAM w bajtach
+TextureResidency::TextureResidency(size_t budgetBytes) {
+    statistics.budgetBytes = budgetBytes;
+}
+
+// Funkcja do ładowania tekstury, przyjmuje parametr: ścieżka do pliku tekstury
+unsigned int TextureResidency::load(const char* path) {
+    unsigned int textureID;
+    glGenTextures(1, &textureID);
+
+    std::unique_ptr<PendingLoad> pending(new PendingLoad());
+    pending->textureID = textureID;
+    pending->path = path;
+
+    // Dekodowanie i zmniejszanie na CPU w tle, wątek OpenGL tylko wysyła gotowe poziomy
+    PendingLoad* load = pending.get();
+    int tail = tailSize;
+    load->task = submitTask([load, tail]() {
+        int width, height, nrComponents;
+        stbi_set_flip_vertically_on_load_thread(true);
+        unsigned char* data = stbi_load(load->path.c_str(), &width, &height, &nrComponents, 0);
+        if (!data)
+            return;
+
+        int levelCount = 1 + (int)std::floor(std::log2((double)std::max(width, height)));
+
+        // Ogon mipmap: pierwszy poziom mieszczący się w tailSize x tailSize
+        int tailLevel = 0;
+        while (tailLevel < levelCount - 1 && std::max(width >> tailLevel, height >> tailLevel) > tail) {
+            ++tailLevel;
+        }
+
+        std::vector<unsigned char> level;
+        const unsigned char* pixels = data;
+        int w = width, h = height;
+        for (int i = 0; i < levelCount; ++i) {
+            if (i >= tailLevel)
+                load->tail.emplace_back(pixels, pixels + (size_t)w * h * nrComponents);
+            if (i + 1 < levelCount) {
+                level = downsampleImage(pixels, w, h, nrComponents);
+                pixels = level.data();
+                w = std::max(1, w / 2);
+                h = std::max(1, h / 2);
+            }
+        }
+        stbi_image_free(data);
+
+        load->height = height;
+        load->components = nrComponents;
+        load->levelCount = levelCount;
+        load->tailLevel = tailLevel;
+        load->width = width;
+    });
+    pendingLoads.push_back(std::move(pending));
+
+    return textureID;
+}
+
+void TextureResidency::finishLoads() {
+    uploadLoads(true);
+}
+
+// Wysyła zdekodowane tekstury, przyjmuje parametr: czy czekać na niedokończone dekodowania
+void TextureResidency::uploadLoads(bool wait) {
+    size_t kept = 0;
+    for (size_t i = 0; i < pendingLoads.size(); ++i) {
+        if (wait)
+            waitTask(pendingLoads[i]->task);
+        if (taskDone(pendingLoads[i]->task))
+            finishLoad(*pendingLoads[i]);
+        else
+            pendingLoads[kept++] = std::move(pendingLoads[i]);
+    }
+    pendingLoads.resize(kept);
+}
+
+// Wysyła ogon mipmap zdekodowanej tekstury i zaczyna nią zarządzać, przyjmuje parametr: zakończone ładowanie
+void TextureResidency::finishLoad(PendingLoad& pending) {
+    if (pending.width == 0) {
+        std::cout << "Failed to load texture: " << pending.path << std::endl;
+        return;
+    }
+
+    Entry entry;
+    entry.path = pending.path;
+    entry.width = pending.width;
+    entry.height = pending.height;
+    entry.components = pending.components;
+    entry.levelCount = pending.levelCount;
+    entry.tailLevel = pending.tailLevel;
+    entry.residentLevel = entry.tailLevel;
+    entry.wantedLevel = entry.tailLevel;
+    entry.targetLevel = entry.tailLevel;
+
+    unsigned int textureID = pending.textureID;
+    GLenum format = formatForComponents(entry.components);
+    glBindTexture(GL_TEXTURE_2D, textureID);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    for (int i = entry.tailLevel; i < entry.levelCount; ++i) {
+        int w = std::max(1, entry.width >> i);
+        int h = std::max(1, entry.height >> i);
+        glTexImage2D(GL_TEXTURE_2D, i, format, w, h, 0, format, GL_UNSIGNED_BYTE, pending.tail[i - entry.tailLevel].data());
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, entry.tailLevel);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, entry.levelCount - 1);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    statistics.residentBytes += bytesFromLevel(entry, entry.tailLevel);
+    statistics.peakResidentBytes = std::max(statistics.peakResidentBytes, statistics.residentBytes);
+    entries[textureID] = entry;
+    statistics.textureCount = entries.size();
+}
+
+// Szacowany rozmiar jednego poziomu w VRAM, tekstury RGB sterowniki zwykle trzymają jako RGBA
+size_t TextureResidency::levelBytes(const Entry& entry, int level) const {
+    size_t w = (size_t)std::max(1, entry.width >> level);
+    size_t h = (size_t)std::max(1, entry.height >> level);
+    size_t texelBytes = entry.components == 3 ? 4 : (size_t)entry.components;
+    return w * h * texelBytes;
+}
+
+// Rozmiar wszystkich poziomów od level do najgrubszego
+size_t TextureResidency::bytesFromLevel(const Entry& entry, int level) const {
+    size_t bytes = 0;
+    for (int i = level; i < entry.levelCount; ++i)
+        bytes += levelBytes(entry, i);
+    return bytes;
+}
+
+void TextureResidency::beginFrame() {
+    ++frame;
+    for (auto& pair : entries) {
+        pair.second.wantedLevel = pair.second.tailLevel;
+        pair.second.priority = 0.0f;
+    }
+}
+
+// Zgłoszenie zapotrzebowania, przyjmuje parametry: ID tekstury i rzutowana średnica ciała w pikselach
+void TextureResidency::request(unsigned int textureID, float projectedDiameterPx) {
+    auto it = entries.find(textureID);
+    if (it == entries.end() || projectedDiameterPx <= 0.0f)
+        return;
+
+    Entry& entry = it->second;
+
+    // Widoczna półkula pokazuje połowę szerokości tekstury na średnicy, stąd około pi * średnica tekseli
+    float neededTexels = (float)M_PI * projectedDiameterPx;
+    int level = (int)std::floor(std::log2(entry.width / neededTexels) + mipBias);
+    level = std::max(0, std::min(level, entry.tailLevel));
+
+    entry.wantedLevel = std::min(entry.wantedLevel, level);
+    entry.priority = std::max(entry.priority, projectedDiameterPx);
+    if (level < entry.tailLevel)
+        entry.lastNeededFrame = frame;
+}
+
+void TextureResidency::update() {
+    uploadLoads(false);
+    uploadStreams();
+
+    // Kolejność według priorytetu: największe na ekranie ciała dostają budżet jako pierwsze
+    std::vector<std::pair<float, unsigned int>> order;
+    order.reserve(entries.size());
+    size_t used = 0;
+    for (auto& pair : entries) {
+        order.push_back({ pair.second.priority, pair.first });
+        used += bytesFromLevel(pair.second, pair.second.tailLevel); // Ogon jest zawsze rezydentny
+    }
+    std::sort(order.begin(), order.end(), [](const auto& a, const auto& b) { return a.first > b.first; });
+
+    // Przydział budżetu poziom po poziomie
+    for (const auto& item : order) {
+        Entry& entry = entries[item.second];
+        int level = entry.tailLevel;
+        while (level > entry.wantedLevel) {
+            size_t extra = levelBytes(entry, level - 1);
+            if (used + extra > statistics.budgetBytes)
+                break;
+            used += extra;
+            --level;
+        }
+        entry.targetLevel = level;
+    }
+
+    // Niedawno potrzebne drobne poziomy zostają w pamięci, jeśli budżet na to pozwala
+    for (const auto& item : order) {
+        Entry& entry = entries[item.second];
+        if (entry.residentLevel >= entry.targetLevel || frame - entry.lastNeededFrame > (unsigned int)evictionDelayFrames)
+            continue;
+
+        size_t extra = 0;
+        for (int i = entry.residentLevel; i < entry.targetLevel; ++i)
+            extra += levelBytes(entry, i);
+        if (used + extra <= statistics.budgetBytes) {
+            used += extra;
+            entry.targetLevel = entry.residentLevel;
+        }
+    }
+
+    // Najpierw zwalnianie pamięci, potem doładowywanie
+    for (auto& pair : entries) {
+        if (pair.second.targetLevel > pair.second.residentLevel)
+            evictTo(pair.first, pair.second, pair.second.targetLevel);
+    }
+
+    int uploads = 0;
+    for (const auto& item : order) {
+        if (uploads >= maxUploadsPerFrame)
+            break;
+        Entry& entry = entries[item.second];
+        if (entry.targetLevel < entry.residentLevel && !entry.streaming) {
+            streamIn(item.second, entry, entry.targetLevel);
+            ++uploads;
+        }
+    }
+}
+
+// Usuwa z VRAM poziomy drobniejsze niż level
+void TextureResidency::evictTo(unsigned int textureID, Entry& entry, int level) {
+    GLenum format = formatForComponents(entry.components);
+    glBindTexture(GL_TEXTURE_2D, textureID);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level);
+    for (int i = entry.residentLevel; i < level; ++i) {
+        glTexImage2D(GL_TEXTURE_2D, i, format, 0, 0, 0, format, GL_UNSIGNED_BYTE, NULL); // Pusty poziom zwalnia pamięć
+        statistics.evictedBytes += levelBytes(entry, i);
+        statistics.residentBytes -= levelBytes(entry, i);
+    }
+    entry.residentLevel = level;
+    ++statistics.evictions;
+}
+
+// Zaczyna doładowanie poziomów od level do aktualnie rezydentnego: plik jest dekodowany ponownie w tle na puli
+// wątków, a do zakończenia zadania tekstura zostaje przy dotychczasowych poziomach
+void TextureResidency::streamIn(unsigned int textureID, Entry& entry, int level) {
+    std::unique_ptr<PendingStream> pending(new PendingStream());
+    pending->textureID = textureID;
+    pending->path = entry.path;
+    pending->components = entry.components;
+    pending->first = level;
+    pending->last = entry.residentLevel - 1;
+    entry.streaming = true;
+
+    PendingStream* stream = pending.get();
+    stream->task = submitTask([stream]() {
+        int width, height, nrComponents;
+        stbi_set_flip_vertically_on_load_thread(true);
+        unsigned char* data = stbi_load(stream->path.c_str(), &width, &height, &nrComponents, stream->components);
+        if (!data) {
+            stream->failed = true;
+            return;
+        }
+
+        std::vector<unsigned char> level;
+        const unsigned char* pixels = data;
+        for (int i = 0; i <= stream->last; ++i) {
+            if (i >= stream->first)
+                stream->levels.emplace_back(pixels, pixels + (size_t)width * height * stream->components);
+            if (i < stream->last) {
+                level = downsampleImage(pixels, width, height, stream->components);
+                pixels = level.data();
+                width = std::max(1, width / 2);
+                height = std::max(1, height / 2);
+            }
+        }
+        stbi_image_free(data);
+    });
+    pendingStreams.push_back(std::move(pending));
+}
+
+// Wysyła poziomy z zakończonych dekodowań, bez czekania na pozostałe. Pula z jednym wątkiem nie ma wątków
+// w tle, więc wtedy dekodowanie wykonuje się tutaj, jak przed przeniesieniem go na pulę
+void TextureResidency::uploadStreams() {
+    bool wait = workerCount() < 2;
+    size_t kept = 0;
+    for (size_t i = 0; i < pendingStreams.size(); ++i) {
+        if (wait)
+            waitTask(pendingStreams[i]->task);
+        if (taskDone(pendingStreams[i]->task))
+            finishStream(*pendingStreams[i]);
+        else
+            pendingStreams[kept++] = std::move(pendingStreams[i]);
+    }
+    pendingStreams.resize(kept);
+}
+
+// Wysyła doładowane poziomy, przyjmuje parametr: zakończone dekodowanie. Gdy w międzyczasie tekstura straciła
+// poziomy (budżet) albo już ich nie potrzebuje, wynik jest odrzucany, a update() w razie potrzeby zacznie od nowa
+void TextureResidency::finishStream(PendingStream& pending) {
+    Entry& entry = entries[pending.textureID];
+    entry.streaming = false;
+    if (pending.failed) {
+        std::cout << "Failed to stream texture: " << pending.path << std::endl;
+        return;
+    }
+    if (entry.residentLevel != pending.last + 1 || entry.targetLevel > pending.last)
+        return;
+
+    // Poziomy grubsze niż obecny cel nie są wysyłane, żeby nie przekroczyć budżetu
+    int first = std::max(pending.first, entry.targetLevel);
+    GLenum format = formatForComponents(entry.components);
+    glBindTexture(GL_TEXTURE_2D, pending.textureID);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1); // Poziomy mipmap mają dowolne szerokości
+    for (int i = first; i <= pending.last; ++i) {
+        int w = std::max(1, entry.width >> i);
+        int h = std::max(1, entry.height >> i);
+        glTexImage2D(GL_TEXTURE_2D, i, format, w, h, 0, format, GL_UNSIGNED_BYTE, pending.levels[i - pending.first].data());
+        statistics.streamedInBytes += levelBytes(entry, i);
+        statistics.residentBytes += levelBytes(entry, i);
+        ++statistics.streamedInLevels;
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, first);
+    statistics.peakResidentBytes = std::max(statistics.peakResidentBytes, statistics.residentBytes);
+    entry.residentLevel = first;
+}
+
+void TextureResidency::setBudget(size_t budgetBytes) {
+    statistics.budgetBytes = budgetBytes;
+}
+
+void TextureResidency::printStats() const {
+    const double mb = 1024.0 * 1024.0;
+    std::cout << "Textures: " << statistics.textureCount
+        << ", resident " << statistics.residentBytes / mb << " MB / budget " << statistics.budgetBytes / mb << " MB"
+        << ", peak " << statistics.peakResidentBytes / mb << " MB"
+        << ", streamed in " << statistics.streamedInLevels << " levels (" << statistics.streamedInBytes / mb << " MB)"
+        << ", evictions " << statistics.evictions << " (" << statistics.evictedBytes / mb << " MB)" << std::endl;
+}
@@ -0,0 +1,113 @@
+﻿#pragma once
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "parallel.h"
+
+// Statystyki menedżera rezydencji tekstur
+struct TextureResidencyStats {
+    size_t budgetBytes = 0;       // Budżet pamięci VRAM na tekstury
+    size_t residentBytes = 0;     // Bajty aktualnie zajęte przez wszystkie rezydentne poziomy mipmap
+    size_t peakResidentBytes = 0; // Największa zajętość od startu
+    size_t streamedInBytes = 0;   // Łączna liczba bajtów doładowanych do VRAM
+    size_t evictedBytes = 0;      // Łączna liczba bajtów zwolnionych z VRAM
+    size_t streamedInLevels = 0;  // Łączna liczba doładowanych poziomów mipmap
+    size_t evictions = 0;         // Liczba zdarzeń usunięcia drobnych poziomów z tekstury
+    size_t textureCount = 0;      // Liczba zarządzanych tekstur
+};
+
+// Menedżer rezydencji tekstur: śledzi najdrobniejszy poziom mipmapy potrzebny każdej teksturze
+// na podstawie rzutowanego rozmiaru ciał i doładowuje / usuwa poziomy w ramach budżetu VRAM
+class TextureResidency {
+public:
+    explicit TextureResidency(size_t budgetBytes);
+
+    // Ładuje teksturę z pliku, na start rezydentne są tylko grube poziomy (ogon mipmap). Identyfikator jest
+    // zwracany od razu, dekodowanie i liczenie ogona odbywa się w tle na puli wątków, a wysyłka do VRAM
+    // w update() albo finishLoads()
+    unsigned int load(const char* path);
+
+    // Czeka na wszystkie rozpoczęte dekodowania i wysyła ich ogony mipmap do VRAM
+    void finishLoads();
+
+    // Rozpoczyna nową klatkę, zeruje zapotrzebowanie zebrane w poprzedniej
+    void beginFrame();
+
+    // Zgłasza, że ciało z daną teksturą zajmuje na ekranie średnicę projectedDiameterPx pikseli
+    void request(unsigned int textureID, float projectedDiameterPx);
+
+    // Wyznacza docelowe poziomy w ramach budżetu, usuwa zbędne i doładowuje brakujące poziomy
+    void update();
+
+    void setBudget(size_t budgetBytes);
+    const TextureResidencyStats& stats() const { return statistics; }
+    void printStats() const;
+
+    // Parametry strumieniowania
+    int tailSize = 256;           // Poziomy nie większe niż tailSize x tailSize są zawsze rezydentne
+    int maxUploadsPerFrame = 1;   // Ile tekstur może zacząć doładowanie w jednej klatce
+    int evictionDelayFrames = 120; // Po ilu klatkach bez potrzeby zwolnić drobne poziomy, gdy budżet nie jest przekroczony
+    float mipBias = 0.0f;         // Dodatnie wartości wybierają grubsze poziomy
+
+private:
+    struct Entry {
+        std::string path;
+        int width = 0;
+        int height = 0;
+        int components = 0;
+        int levelCount = 0;
+        int tailLevel = 0;        // Najdrobniejszy poziom ogona, zawsze rezydentny
+        int residentLevel = 0;    // Najdrobniejszy poziom aktualnie w VRAM
+        int wantedLevel = 0;      // Najdrobniejszy poziom potrzebny w tej klatce
+        int targetLevel = 0;      // Poziom wybrany po uwzględnieniu budżetu
+        float priority = 0.0f;    // Największa rzutowana średnica w tej klatce
+        unsigned int lastNeededFrame = 0;
+        bool streaming = false;   // Drobniejsze poziomy są dekodowane w tle
+    };
+
+    // Plik dekodowany w tle: zadanie wypełnia wymiary i poziomy ogona, resztę robi wątek OpenGL
+    struct PendingLoad {
+        unsigned int textureID = 0;
+        std::string path;
+        TaskHandle task;
+        int width = 0;            // 0, gdy plik się nie wczytał
+        int height = 0;
+        int components = 0;
+        int levelCount = 0;
+        int tailLevel = 0;
+        std::vector<std::vector<unsigned char>> tail; // Poziomy od tailLevel do najgrubszego
+    };
+
+    // Drobniejsze poziomy dekodowane w tle: zadanie dekoduje plik i liczy poziomy od first do last,
+    // wątek OpenGL wysyła je w update(), jeśli tekstura nadal ich potrzebuje
+    struct PendingStream {
+        unsigned int textureID = 0;
+        std::string path;
+        int components = 0;
+        int first = 0;
+        int last = 0;
+        TaskHandle task;
+        bool failed = false;
+        std::vector<std::vector<unsigned char>> levels; // Poziomy od first do last
+    };
+
+    void uploadLoads(bool wait);
+    void uploadStreams();
+    void finishLoad(PendingLoad& pending);
+    size_t levelBytes(const Entry& entry, int level) const;
+    size_t bytesFromLevel(const Entry& entry, int level) const;
+    void evictTo(unsigned int textureID, Entry& entry, int level);
+    void streamIn(unsigned int textureID, Entry& entry, int level);
+    void finishStream(PendingStream& pending);
+
+    std::unordered_map<unsigned int, Entry> entries;
+    std::vector<std::unique_ptr<PendingLoad>> pendingLoads;
+    std::vector<std::unique_ptr<PendingStream>> pendingStreams;
+    TextureResidencyStats statistics;
+    unsigned int frame = 0;
+};
+
+// Zmniejsza obraz dwukrotnie filtrem pudełkowym, przyjmuje parametry: dane, szerokość, wysokość i liczba składowych
+std::vector<unsigned char> downsampleImage(const unsigned char* data, int width, int height, int components);
@@ -0,0 +1,36 @@
+﻿#pragma once
+#include <atomic>
+
+// Potrójny bufor bez blokad: producent zawsze ma wolny bufor do zapisu, konsument zawsze czyta
+// najnowszy kompletny stan, a środkowy bufor jest wymieniany atomowo między nimi
+template <typename T>
+class TripleBuffer {
+public:
+    // Bufor, do którego producent zapisuje następny stan
+    T& writeBuffer() { return buffers[back]; }
+
+    // Publikuje zapisany stan i bierze do zapisu poprzedni środkowy bufor
+    void publish() {
+        unsigned char previous = middle.exchange((unsigned char)(back | freshBit), std::memory_order_acq_rel);
+        back = previous & indexMask;
+    }
+
+    // Zwraca najnowszy opublikowany stan, nigdy nie czeka na producenta. Referencja jest ważna tylko do następnego
+    // read(): kolejne wywołanie może oddać ten bufor producentowi, więc konsument czyta raz na klatkę
+    const T& read() {
+        if (middle.load(std::memory_order_acquire) & freshBit) {
+            unsigned char previous = middle.exchange(front, std::memory_order_acq_rel);
+            front = previous & indexMask;
+        }
+        return buffers[front];
+    }
+
+private:
+    static constexpr unsigned char freshBit = 4;  // Środkowy bufor zawiera stan jeszcze nieprzeczytany
+    static constexpr unsigned char indexMask = 3;
+
+    T buffers[3];
+    std::atomic<unsigned char> middle{ 1 };
+    unsigned char back = 0;  // Używany tylko przez producenta
+    unsigned char front = 2; // Używany tylko przez konsumenta
+};
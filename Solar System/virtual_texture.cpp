@@ -0,0 +1,518 @@
+﻿#include "virtual_texture.h"
+#include <glad/glad.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include "shader.h"
+#include "stb_image.h"
+#include "texture_residency.h"
+
+// Fragment shader przebiegu feedback - zapisuje kafel, poziom i identyfikator tekstury wirtualnej
+static const char* feedbackFragmentShaderSource = R"(
+    #version 330 core
+    in vec2 TexCoords;
+
+    out vec4 FragColor;
+
+    uniform float vtID;
+    uniform vec2 vtSize;
+    uniform float vtTileSize;
+    uniform float vtMaxLevel;
+    uniform float vtFeedbackBias;
+
+    void main() {
+        if (vtID < 0.5) {
+            FragColor = vec4(0.0);
+            return;
+        }
+
+        vec2 uv = clamp(TexCoords, 0.0, 0.99999);
+        vec2 texel = uv * vtSize;
+        vec2 dx = dFdx(texel);
+        vec2 dy = dFdy(texel);
+        float mip = 0.5 * log2(max(max(dot(dx, dx), dot(dy, dy)), 1e-8)) + vtFeedbackBias;
+        float level = clamp(floor(mip), 0.0, vtMaxLevel);
+        vec2 tile = floor(uv * vtSize / exp2(level) / vtTileSize);
+
+        FragColor = vec4(tile, level, vtID) / 255.0;
+    }
+)";
+
+// Otwiera plik, na MSVC przez fopen_s (fopen jest oznaczone jako przestarzałe przy /sdl)
+static FILE* openFile(const char* path, const char* mode) {
+#ifdef _MSC_VER
+    FILE* file = nullptr;
+    if (fopen_s(&file, path, mode) != 0)
+        return nullptr;
+    return file;
+#else
+    return fopen(path, mode);
+#endif
+}
+
+// Przesunięcie w pliku większym niż 2 GB
+static int seekFile(FILE* file, uint64_t offset) {
+#ifdef _WIN32
+    return _fseeki64(file, (long long)offset, SEEK_SET);
+#else
+    return fseeko(file, (off_t)offset, SEEK_SET);
+#endif
+}
+
+bool VirtualTextureSystem::initialize(const char* vertexShaderSource) {
+    feedbackProgram = createProgram(vertexShaderSource, feedbackFragmentShaderSource);
+    bindFrameUniforms(feedbackProgram);
+
+    // Fizyczny cache kafli, każdy slot ma kafel z ramką
+    int cacheSize = slotsPerSide * (tileSize + 2 * border);
+    glGenTextures(1, &physicalTexture);
+    glBindTexture(GL_TEXTURE_2D, physicalTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, cacheSize, cacheSize, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    statistics.cacheBytes = (size_t)cacheSize * cacheSize * 4;
+
+    slots.assign((size_t)slotsPerSide * slotsPerSide, Slot());
+
+    glGenFramebuffers(1, &feedbackFBO);
+    glGenTextures(1, &feedbackColor);
+    glGenRenderbuffers(1, &feedbackDepth);
+    glGenBuffers(2, feedbackPBO);
+    return true;
+}
+
+void VirtualTextureSystem::release() {
+    for (Texture& texture : textures) {
+        if (texture.file)
+            fclose(texture.file);
+        glDeleteTextures(1, &texture.indirectionTexture);
+    }
+    textures.clear();
+    slots.clear();
+    slotByKey.clear();
+    requests.clear();
+
+    glDeleteProgram(feedbackProgram);
+    glDeleteTextures(1, &physicalTexture);
+    glDeleteFramebuffers(1, &feedbackFBO);
+    glDeleteTextures(1, &feedbackColor);
+    glDeleteRenderbuffers(1, &feedbackDepth);
+    glDeleteBuffers(2, feedbackPBO);
+    feedbackProgram = physicalTexture = feedbackFBO = feedbackColor = feedbackDepth = 0;
+    feedbackPBO[0] = feedbackPBO[1] = 0;
+    feedbackWidth = feedbackHeight = 0;
+    pboWidth[0] = pboWidth[1] = pboHeight[0] = pboHeight[1] = 0;
+    statistics = VirtualTextureStats();
+}
+
+uint64_t VirtualTextureSystem::tileKey(int id, int level, int x, int y) {
+    return ((uint64_t)id << 40) | ((uint64_t)level << 32) | ((uint64_t)y << 16) | (uint64_t)x;
+}
+
+// Funkcja do otwierania tekstury wirtualnej, przyjmuje parametr: ścieżka do pliku .vt
+int VirtualTextureSystem::open(const char* path) {
+    FILE* file = openFile(path, "rb");
+    if (!file)
+        return 0; // Tekstura wirtualna jest opcjonalna
+
+    Texture texture;
+    texture.path = path;
+    texture.file = file;
+    if (fread(&texture.header, sizeof(VirtualTextureHeader), 1, file) != 1
+        || memcmp(texture.header.magic, "SSVT", 4) != 0 || texture.header.version != 1) {
+        std::cout << "Invalid virtual texture: " << path << std::endl;
+        fclose(file);
+        return 0;
+    }
+    if ((int)texture.header.tileSize != tileSize || (int)texture.header.border != border || textures.size() >= 255) {
+        std::cout << "Unsupported virtual texture layout: " << path << std::endl;
+        fclose(file);
+        return 0;
+    }
+
+    // Liczba kafli na każdym poziomie
+    int tileCount = 0;
+    for (uint32_t level = 0; level < texture.header.levelCount; ++level) {
+        int levelWidth = std::max(1u, texture.header.width >> level);
+        int levelHeight = std::max(1u, texture.header.height >> level);
+        texture.levelFirstTile.push_back(tileCount);
+        texture.levelTilesX.push_back((levelWidth + tileSize - 1) / tileSize);
+        texture.levelTilesY.push_back((levelHeight + tileSize - 1) / tileSize);
+        tileCount += texture.levelTilesX.back() * texture.levelTilesY.back();
+    }
+    texture.tileOffsets.resize(tileCount);
+    if (fread(texture.tileOffsets.data(), sizeof(uint64_t), tileCount, file) != (size_t)tileCount) {
+        std::cout << "Invalid virtual texture: " << path << std::endl;
+        fclose(file);
+        return 0;
+    }
+    texture.residentSlot.assign(tileCount, -1);
+
+    // Tablica pośrednia: jeden teksel na kafel na każdym poziomie
+    glGenTextures(1, &texture.indirectionTexture);
+    glBindTexture(GL_TEXTURE_2D, texture.indirectionTexture);
+    for (uint32_t level = 0; level < texture.header.levelCount; ++level) {
+        glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA8UI, texture.levelTilesX[level], texture.levelTilesY[level],
+            0, GL_RGBA_INTEGER, GL_UNSIGNED_BYTE, NULL);
+    }
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, texture.header.levelCount - 1);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+    textures.push_back(texture);
+    int id = (int)textures.size();
+
+    // Najgrubszy kafel jest zawsze rezydentny i służy jako zapas dla brakujących kafli
+    if (!loadTile(tileKey(id, texture.header.levelCount - 1, 0, 0), true)) {
+        std::cout << "Virtual texture cache is full: " << path << std::endl;
+    }
+    rebuildIndirection(textures.back());
+
+    return id;
+}
+
+void VirtualTextureSystem::beginFeedback(int screenWidth, int screenHeight) {
+    ++frame;
+    int width = std::max(1, screenWidth / feedbackScale);
+    int height = std::max(1, screenHeight / feedbackScale);
+
+    // Zmiana rozmiaru bufora feedback razem z oknem
+    if (width != feedbackWidth || height != feedbackHeight) {
+        feedbackWidth = width;
+        feedbackHeight = height;
+
+        glBindTexture(GL_TEXTURE_2D, feedbackColor);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glBindRenderbuffer(GL_RENDERBUFFER, feedbackDepth);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+
+        glBindFramebuffer(GL_FRAMEBUFFER, feedbackFBO);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, feedbackColor, 0);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, feedbackDepth);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+            std::cout << "ERROR::FRAMEBUFFER::FEEDBACK_INCOMPLETE" << std::endl;
+        }
+    }
+
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    glBindFramebuffer(GL_FRAMEBUFFER, feedbackFBO);
+    glViewport(0, 0, width, height);
+    glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    glUseProgram(feedbackProgram);
+    glUniform1f(glGetUniformLocation(feedbackProgram, "vtFeedbackBias"), -std::log2((float)feedbackScale));
+}
+
+// Ustawia teksturę wirtualną rysowanego ciała w przebiegu feedback, przyjmuje parametr: identyfikator tekstury
+void VirtualTextureSystem::setFeedbackTexture(int id) {
+    glUniform1f(glGetUniformLocation(feedbackProgram, "vtID"), (float)id);
+    if (id == 0)
+        return;
+
+    const VirtualTextureHeader& header = textures[id - 1].header;
+    glUniform2f(glGetUniformLocation(feedbackProgram, "vtSize"), (float)header.width, (float)header.height);
+    glUniform1f(glGetUniformLocation(feedbackProgram, "vtTileSize"), (float)tileSize);
+    glUniform1f(glGetUniformLocation(feedbackProgram, "vtMaxLevel"), (float)(header.levelCount - 1));
+}
+
+void VirtualTextureSystem::endFeedback() {
+    // Asynchroniczny odczyt bieżącej klatki, przetwarzamy wynik poprzedniej, żeby nie czekać na GPU
+    int current = frame % 2;
+    int previous = 1 - current;
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, feedbackPBO[current]);
+    if (pboWidth[current] != feedbackWidth || pboHeight[current] != feedbackHeight) {
+        glBufferData(GL_PIXEL_PACK_BUFFER, (size_t)feedbackWidth * feedbackHeight * 4, NULL, GL_STREAM_READ);
+        pboWidth[current] = feedbackWidth;
+        pboHeight[current] = feedbackHeight;
+    }
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, feedbackWidth, feedbackHeight, GL_RGBA, GL_UNSIGNED_BYTE, (void*)0);
+
+    if (pboWidth[previous] > 0) {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, feedbackPBO[previous]);
+        const unsigned char* pixels = (const unsigned char*)glMapBuffer(GL_PIXEL_PACK_BUFFER, GL_READ_ONLY);
+        if (pixels) {
+            size_t pixelCount = (size_t)pboWidth[previous] * pboHeight[previous];
+            for (size_t i = 0; i < pixelCount; ++i) {
+                const unsigned char* p = pixels + i * 4;
+                int id = p[3];
+                if (id == 0 || id > (int)textures.size())
+                    continue;
+
+                // Zgłaszamy kafel i wszystkich jego przodków, żeby zapasowe kafle nie zostały usunięte
+                const Texture& texture = textures[id - 1];
+                int x = p[0], y = p[1];
+                for (int level = p[2]; level < (int)texture.header.levelCount; ++level, x /= 2, y /= 2) {
+                    if (x >= texture.levelTilesX[level] || y >= texture.levelTilesY[level])
+                        break;
+                    requests.push_back(tileKey(id, level, x, y));
+                }
+            }
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        }
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+}
+
+void VirtualTextureSystem::update() {
+    std::sort(requests.begin(), requests.end());
+    requests.erase(std::unique(requests.begin(), requests.end()), requests.end());
+    statistics.requestedTiles = requests.size();
+
+    // Rezydentne kafle oznaczamy jako używane, brakujące wczytujemy od najgrubszych
+    std::vector<uint64_t> missing;
+    for (uint64_t key : requests) {
+        auto it = slotByKey.find(key);
+        if (it != slotByKey.end())
+            slots[it->second].lastUsedFrame = frame;
+        else
+            missing.push_back(key);
+    }
+    std::sort(missing.begin(), missing.end(), [](uint64_t a, uint64_t b) {
+        return ((a >> 32) & 0xFF) > ((b >> 32) & 0xFF);
+    });
+
+    size_t loads = 0;
+    for (uint64_t key : missing) {
+        if ((int)loads >= maxTileLoadsPerFrame || !loadTile(key, false))
+            break;
+        ++loads;
+    }
+    statistics.pendingTiles = missing.size() - loads;
+    requests.clear();
+
+    for (auto& texture : textures) {
+        if (texture.indirectionDirty)
+            rebuildIndirection(texture);
+    }
+}
+
+// Wolny slot albo najdawniej używany kafel, który nie był potrzebny w tej klatce
+int VirtualTextureSystem::findFreeSlot() {
+    int best = -1;
+    for (int i = 0; i < (int)slots.size(); ++i) {
+        if (slots[i].key == 0)
+            return i;
+        if (slots[i].pinned || slots[i].lastUsedFrame >= frame)
+            continue;
+        if (best < 0 || slots[i].lastUsedFrame < slots[best].lastUsedFrame)
+            best = i;
+    }
+    return best;
+}
+
+// Wczytuje kafel z dysku do fizycznego cache, przyjmuje parametry: klucz kafla i czy kafel jest przypięty
+bool VirtualTextureSystem::loadTile(uint64_t key, bool pinned) {
+    int id = (int)(key >> 40);
+    int level = (int)((key >> 32) & 0xFF);
+    int y = (int)((key >> 16) & 0xFFFF);
+    int x = (int)(key & 0xFFFF);
+
+    int slot = findFreeSlot();
+    if (slot < 0)
+        return false;
+
+    // Usunięcie poprzedniego kafla ze slotu
+    if (slots[slot].key != 0) {
+        uint64_t oldKey = slots[slot].key;
+        Texture& oldTexture = textures[(oldKey >> 40) - 1];
+        int oldLevel = (int)((oldKey >> 32) & 0xFF);
+        int oldIndex = oldTexture.levelFirstTile[oldLevel]
+            + (int)((oldKey >> 16) & 0xFFFF) * oldTexture.levelTilesX[oldLevel] + (int)(oldKey & 0xFFFF);
+        oldTexture.residentSlot[oldIndex] = -1;
+        oldTexture.indirectionDirty = true;
+        slotByKey.erase(oldKey);
+        slots[slot].key = 0;
+        ++statistics.evictedTiles;
+        --statistics.residentTiles;
+    }
+
+    Texture& texture = textures[id - 1];
+    int tileIndex = texture.levelFirstTile[level] + y * texture.levelTilesX[level] + x;
+    int slotSize = tileSize + 2 * border;
+    std::vector<unsigned char> pixels((size_t)slotSize * slotSize * 4);
+    if (seekFile(texture.file, texture.tileOffsets[tileIndex]) != 0
+        || fread(pixels.data(), 1, pixels.size(), texture.file) != pixels.size()) {
+        std::cout << "Failed to read virtual texture tile: " << texture.path << std::endl;
+        return false;
+    }
+
+    glBindTexture(GL_TEXTURE_2D, physicalTexture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, (slot % slotsPerSide) * slotSize, (slot / slotsPerSide) * slotSize,
+        slotSize, slotSize, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    slots[slot].key = key;
+    slots[slot].lastUsedFrame = frame;
+    slots[slot].pinned = pinned;
+    slotByKey[key] = slot;
+    texture.residentSlot[tileIndex] = slot;
+    texture.indirectionDirty = true;
+    ++statistics.loadedTiles;
+    ++statistics.residentTiles;
+    return true;
+}
+
+// Odbudowuje tablicę pośrednią: brakujące kafle wskazują na najbliższego rezydentnego przodka
+void VirtualTextureSystem::rebuildIndirection(Texture& texture) {
+    int levelCount = (int)texture.header.levelCount;
+    std::vector<std::vector<unsigned char>> entries(levelCount);
+
+    glBindTexture(GL_TEXTURE_2D, texture.indirectionTexture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    for (int level = levelCount - 1; level >= 0; --level) {
+        int tilesX = texture.levelTilesX[level];
+        int tilesY = texture.levelTilesY[level];
+        entries[level].resize((size_t)tilesX * tilesY * 4);
+
+        for (int y = 0; y < tilesY; ++y) {
+            for (int x = 0; x < tilesX; ++x) {
+                unsigned char* entry = &entries[level][((size_t)y * tilesX + x) * 4];
+                int slot = texture.residentSlot[texture.levelFirstTile[level] + y * tilesX + x];
+                if (slot >= 0) {
+                    entry[0] = (unsigned char)(slot % slotsPerSide);
+                    entry[1] = (unsigned char)(slot / slotsPerSide);
+                    entry[2] = (unsigned char)level;
+                    entry[3] = 255;
+                }
+                else if (level + 1 < levelCount) {
+                    int parentTilesX = texture.levelTilesX[level + 1];
+                    const unsigned char* parent = &entries[level + 1][((size_t)(y / 2) * parentTilesX + x / 2) * 4];
+                    memcpy(entry, parent, 4);
+                }
+                else {
+                    memset(entry, 0, 4);
+                }
+            }
+        }
+
+        glTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, tilesX, tilesY, GL_RGBA_INTEGER, GL_UNSIGNED_BYTE, entries[level].data());
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    texture.indirectionDirty = false;
+}
+
+// Funkcja ustawiająca teksturę wirtualną w programie shaderów, przyjmuje parametry: identyfikator tekstury i program
+void VirtualTextureSystem::bind(int id, unsigned int shaderProgram) const {
+    if (id == 0)
+        return;
+
+    const Texture& texture = textures[id - 1];
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, physicalTexture);
+    glActiveTexture(GL_TEXTURE2);
+    glBindTexture(GL_TEXTURE_2D, texture.indirectionTexture);
+    glActiveTexture(GL_TEXTURE0);
+
+    glUniform2f(glGetUniformLocation(shaderProgram, "vtSize"), (float)texture.header.width, (float)texture.header.height);
+    glUniform1f(glGetUniformLocation(shaderProgram, "vtTileSize"), (float)tileSize);
+    glUniform1f(glGetUniformLocation(shaderProgram, "vtBorder"), (float)border);
+    glUniform1f(glGetUniformLocation(shaderProgram, "vtCacheSize"), (float)(slotsPerSide * (tileSize + 2 * border)));
+    glUniform1f(glGetUniformLocation(shaderProgram, "vtMaxLevel"), (float)(texture.header.levelCount - 1));
+}
+
+void VirtualTextureSystem::printStats() const {
+    std::cout << "Virtual textures: " << textures.size()
+        << ", requested " << statistics.requestedTiles << " tiles"
+        << ", resident " << statistics.residentTiles << "/" << slots.size()
+        << ", pending " << statistics.pendingTiles
+        << ", loaded " << statistics.loadedTiles
+        << ", evicted " << statistics.evictedTiles
+        << ", cache " << statistics.cacheBytes / (1024.0 * 1024.0) << " MB" << std::endl;
+}
+
+// Funkcja tnąca obraz na kafle, przyjmuje parametry: ścieżka obrazu źródłowego, ścieżka wyjściowa, rozmiar kafla i ramki
+bool buildVirtualTexture(const char* sourcePath, const char* outputPath, int tileSize, int border) {
+    int width, height, nrComponents;
+    stbi_set_flip_vertically_on_load(true); // Tak samo jak zwykłe tekstury, żeby współrzędne UV się zgadzały
+    unsigned char* data = stbi_load(sourcePath, &width, &height, &nrComponents, 4);
+    if (!data) {
+        std::cout << "Failed to load texture: " << sourcePath << std::endl;
+        return false;
+    }
+    if ((width & (width - 1)) != 0 || (height & (height - 1)) != 0 || width < tileSize || height < tileSize) {
+        std::cout << "Virtual texture source must have power-of-two dimensions not smaller than the tile: " << sourcePath << std::endl;
+        stbi_image_free(data);
+        return false;
+    }
+
+    // Wszystkie poziomy aż do jednego kafla
+    std::vector<std::vector<unsigned char>> levels;
+    std::vector<int> levelWidth, levelHeight;
+    levels.emplace_back(data, data + (size_t)width * height * 4);
+    levelWidth.push_back(width);
+    levelHeight.push_back(height);
+    stbi_image_free(data);
+    while (levelWidth.back() > tileSize || levelHeight.back() > tileSize) {
+        levels.push_back(downsampleImage(levels.back().data(), levelWidth.back(), levelHeight.back(), 4));
+        levelWidth.push_back(std::max(1, levelWidth.back() / 2));
+        levelHeight.push_back(std::max(1, levelHeight.back() / 2));
+    }
+
+    VirtualTextureHeader header = {};
+    memcpy(header.magic, "SSVT", 4);
+    header.version = 1;
+    header.width = width;
+    header.height = height;
+    header.tileSize = tileSize;
+    header.border = border;
+    header.levelCount = (uint32_t)levels.size();
+
+    int slotSize = tileSize + 2 * border;
+    size_t tileBytes = (size_t)slotSize * slotSize * 4;
+    size_t tileCount = 0;
+    for (size_t level = 0; level < levels.size(); ++level) {
+        tileCount += (size_t)((levelWidth[level] + tileSize - 1) / tileSize) * ((levelHeight[level] + tileSize - 1) / tileSize);
+    }
+
+    std::vector<uint64_t> offsets(tileCount);
+    uint64_t dataStart = sizeof(VirtualTextureHeader) + tileCount * sizeof(uint64_t);
+    for (size_t i = 0; i < tileCount; ++i)
+        offsets[i] = dataStart + i * tileBytes;
+
+    FILE* file = openFile(outputPath, "wb");
+    if (!file) {
+        std::cout << "Failed to create virtual texture: " << outputPath << std::endl;
+        return false;
+    }
+    fwrite(&header, sizeof(header), 1, file);
+    fwrite(offsets.data(), sizeof(uint64_t), tileCount, file);
+
+    // Kafle z ramką: w poziomie zawijanie (długość geograficzna), w pionie przycięcie do krawędzi
+    std::vector<unsigned char> tile(tileBytes);
+    for (size_t level = 0; level < levels.size(); ++level) {
+        int w = levelWidth[level], h = levelHeight[level];
+        int tilesX = (w + tileSize - 1) / tileSize;
+        int tilesY = (h + tileSize - 1) / tileSize;
+        for (int ty = 0; ty < tilesY; ++ty) {
+            for (int tx = 0; tx < tilesX; ++tx) {
+                for (int y = 0; y < slotSize; ++y) {
+                    int sy = std::max(0, std::min(ty * tileSize + y - border, h - 1));
+                    for (int x = 0; x < slotSize; ++x) {
+                        int sx = ((tx * tileSize + x - border) % w + w) % w;
+                        memcpy(&tile[((size_t)y * slotSize + x) * 4], &levels[level][((size_t)sy * w + sx) * 4], 4);
+                    }
+                }
+                fwrite(tile.data(), 1, tileBytes, file);
+            }
+        }
+    }
+
+    bool ok = ferror(file) == 0;
+    fclose(file);
+    std::cout << "Virtual texture " << outputPath << ": " << width << "x" << height << ", "
+        << levels.size() << " levels, " << tileCount << " tiles" << std::endl;
+    return ok;
+}
@@ -0,0 +1,108 @@
+﻿#pragma once
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Nagłówek pliku z pociętą na kafle teksturą wirtualną (.vt)
+struct VirtualTextureHeader {
+    char magic[4];          // "SSVT"
+    uint32_t version;
+    uint32_t width;         // Rozmiar poziomu 0 w tekselach, potęgi dwójki
+    uint32_t height;
+    uint32_t tileSize;      // Rozmiar kafla bez ramki
+    uint32_t border;        // Ramka wokół kafla dla filtrowania dwuliniowego
+    uint32_t levelCount;    // Liczba poziomów, ostatni ma jeden kafel
+    uint32_t reserved;
+    // Dalej: tablica uint64_t z przesunięciami wszystkich kafli (poziom, y, x) i dane RGBA8 kafli
+};
+
+// Statystyki systemu tekstur wirtualnych
+struct VirtualTextureStats {
+    size_t requestedTiles = 0;  // Unikalne kafle zgłoszone przez ostatni przebieg feedback
+    size_t residentTiles = 0;   // Kafle w fizycznym cache
+    size_t loadedTiles = 0;     // Łączna liczba wczytanych kafli
+    size_t evictedTiles = 0;    // Łączna liczba kafli usuniętych z cache
+    size_t pendingTiles = 0;    // Kafle czekające na wczytanie w ostatniej klatce
+    size_t cacheBytes = 0;      // Rozmiar fizycznego cache w VRAM
+};
+
+// System tekstur wirtualnych: przebieg feedback w niskiej rozdzielczości wyznacza potrzebne kafle,
+// które są doładowywane do fizycznego cache, a tablica pośrednia mapuje kafle wirtualne na fizyczne
+class VirtualTextureSystem {
+public:
+    // Tworzy fizyczny cache, bufory feedback i program feedback, przyjmuje parametr: źródło vertex shadera
+    bool initialize(const char* vertexShaderSource);
+
+    // Zamyka pliki .vt i usuwa cache, tablice pośrednie i bufory feedback
+    void release();
+
+    // Otwiera plik .vt, zwraca identyfikator tekstury wirtualnej albo 0, gdy pliku nie ma
+    int open(const char* path);
+    bool empty() const { return textures.empty(); }
+
+    // Przebieg feedback: renderowanie do małego bufora, z którego odczytujemy potrzebne kafle
+    void beginFeedback(int screenWidth, int screenHeight);
+    void setFeedbackTexture(int id); // 0 oznacza ciało bez tekstury wirtualnej
+    void endFeedback();
+
+    // Przetwarza zgłoszenia, wczytuje brakujące kafle i aktualizuje tablice pośrednie
+    void update();
+
+    // Ustawia uniformy i tekstury do próbkowania tekstury wirtualnej w programie shaderów
+    void bind(int id, unsigned int shaderProgram) const;
+
+    unsigned int feedbackProgram = 0;
+    int slotsPerSide = 32;          // Fizyczny cache ma slotsPerSide x slotsPerSide kafli
+    int feedbackScale = 8;          // Bufor feedback jest feedbackScale razy mniejszy od ekranu
+    int maxTileLoadsPerFrame = 16;
+
+    const VirtualTextureStats& stats() const { return statistics; }
+    void printStats() const;
+
+private:
+    struct Texture {
+        std::string path;
+        FILE* file = nullptr;
+        VirtualTextureHeader header = {};
+        std::vector<uint64_t> tileOffsets;
+        std::vector<int> levelTilesX;     // Liczba kafli w poziomie na każdym poziomie
+        std::vector<int> levelTilesY;
+        std::vector<int> levelFirstTile;  // Indeks pierwszego kafla poziomu w tablicy przesunięć
+        std::vector<int> residentSlot;    // Slot w cache dla każdego kafla albo -1
+        unsigned int indirectionTexture = 0;
+        bool indirectionDirty = true;
+    };
+
+    struct Slot {
+        uint64_t key = 0;          // Klucz kafla, 0 oznacza wolny slot
+        unsigned int lastUsedFrame = 0;
+        bool pinned = false;       // Kafle najgrubszego poziomu nigdy nie są usuwane
+    };
+
+    static uint64_t tileKey(int id, int level, int x, int y);
+    bool loadTile(uint64_t key, bool pinned);
+    int findFreeSlot();
+    void rebuildIndirection(Texture& texture);
+
+    std::vector<Texture> textures; // Identyfikator tekstury to indeks + 1
+    std::vector<Slot> slots;
+    std::unordered_map<uint64_t, int> slotByKey;
+    std::vector<uint64_t> requests;
+
+    unsigned int physicalTexture = 0;
+    unsigned int feedbackFBO = 0, feedbackColor = 0, feedbackDepth = 0;
+    unsigned int feedbackPBO[2] = { 0, 0 };
+    int feedbackWidth = 0, feedbackHeight = 0;
+    int pboWidth[2] = { 0, 0 }, pboHeight[2] = { 0, 0 };
+    int viewport[4] = { 0, 0, 0, 0 };
+    int tileSize = 128;
+    int border = 1;
+    unsigned int frame = 0;
+    VirtualTextureStats statistics;
+};
+
+// Tnie obraz źródłowy na kafle wszystkich poziomów i zapisuje plik .vt,
+// przyjmuje parametry: ścieżka obrazu źródłowego, ścieżka wyjściowa, rozmiar kafla i ramki
+bool buildVirtualTexture(const char* sourcePath, const char* outputPath, int tileSize = 128, int border = 1);